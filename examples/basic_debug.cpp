@@ -13,7 +13,9 @@
  * 4. Try changing DEBUG=0 in platformio.ini to disable all output
  */
 
+#if defined(ARDUINO)
 #include <Arduino.h>
+#endif
 #include <debug.h>
 
 void setup() {
@@ -35,7 +37,6 @@ void setup() {
   debugf("Integer: %d\n", 42);
   debugf("Float: %.2f\n", 3.14159);
   debugf("Hex: 0x%X\n", 255);
-  debugf("Binary: %b\n", 0b1010);
 
   debugln("");
   debugln("--- Multiple Arguments (Variadic) ---");
@@ -83,6 +84,13 @@ void setup() {
   debug_bin(0b11001100);
   debugln("");
 
+  debug("Padded binary: ");
+  debug_binw(0x2C, 12);  // "0000 0010 1100"
+  debugln("");
+
+  // Decode a control register: EN bit 0, MODE bits 1-3, IRQ bits 4-7
+  debug_bits(value, "EN:1,MODE:3,IRQ:4");  // "EN=1 MODE=101 IRQ=1010"
+
   debugln("");
   debugln("=== Test Complete ===");
 }
@@ -92,3 +100,13 @@ void loop() {
   delay(5000);
   debugf("Loop iteration at: %lu ms\n", millis());
 }
+
+#if !defined(ARDUINO)
+// Host-native build (see README "Host-Native Builds"): run one pass
+int main() {
+  Serial.echo(true);
+  setup();
+  loop();
+  return 0;
+}
+#endif
@@ -3,6 +3,7 @@
  *
  * This example demonstrates advanced debug features:
  * - debug_if() - conditional debug output
+ * - debug_ratelimit() - per-site rate limiting for repeated warnings
  * - debug_assert() - assert with halt
  * - debug_tag() - categorized output
  * - debug_array() - hex dump
@@ -13,7 +14,9 @@
  * 3. Watch conditional output based on sensor values
  */
 
+#if defined(ARDUINO)
 #include <Arduino.h>
+#endif
 #include <debug.h>
 
 // Simulated sensor values
@@ -75,8 +78,10 @@ void readSensors(SensorData& data) {
          data.temperature, data.humidity, data.pressure);
 
   // Conditional warnings
-  debug_if(data.temperature > 30.0,
-           "  ⚠️ WARNING: High temperature: %.1f°C", data.temperature);
+  if (data.temperature > 30.0) {
+    // Stays true while it is hot: at most 3 lines, then one per second
+    debug_ratelimit(1, 3, "  ⚠️ WARNING: High temperature: %.1f°C", data.temperature);
+  }
 
   debug_if(data.temperature < 15.0,
            "  ⚠️ WARNING: Low temperature: %.1f°C", data.temperature);
@@ -179,7 +184,7 @@ void loop() {
  * [CAN] Frame received
  *   Length: 8 bytes
  *   Data: 42 12 34 56 78 9A BC DE
- * [STACK] ~8192 bytes free
+ * [STACK] 5432 bytes free (task minimum)
  * Uptime: 5234 ms
  *
  * === Iteration 2 ===
@@ -188,8 +193,18 @@ void loop() {
  * [CAN] Frame received
  *   Length: 8 bytes
  *   Data: 42 12 34 56 78 9A BC DE
- * [STACK] ~8192 bytes free
+ * [STACK] 5432 bytes free (task minimum)
  * Uptime: 10456 ms
  *
  * When DEBUG=0 in platformio.ini, ALL debug output is compiled away!
  */
+
+#if !defined(ARDUINO)
+// Host-native build (see README "Host-Native Builds"): run one pass
+int main() {
+  Serial.echo(true);
+  setup();
+  loop();
+  return 0;
+}
+#endif
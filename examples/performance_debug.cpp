@@ -5,6 +5,8 @@
  * - debug_micros() - capture timestamp
  * - debug_elapsed() - print elapsed time
  * - debug_stack() - show free stack space
+ * - DEBUG_SCOPE() - scoped cycle-counter timers aggregated into a table
+ * - DEBUG_SCOPE_HISTOGRAM() - latency percentiles without per-sample output
  *
  * Instructions:
  * 1. Build and upload to ESP32
@@ -12,7 +14,9 @@
  * 3. Watch timing measurements
  */
 
+#if defined(ARDUINO)
 #include <Arduino.h>
+#endif
 #include <debug.h>
 
 // Simulate various operations
@@ -28,6 +32,18 @@ void expensiveOperation() {
   delay(200);
 }
 
+// Scoped timers record on every exit path, including early returns
+bool scopedOperation(int i) {
+  DEBUG_SCOPE("scopedOperation");
+  simpleOperation();
+  if (i % 2) return false;
+  {
+    DEBUG_SCOPE("evenIterations");
+    delay(5);
+  }
+  return true;
+}
+
 void setup() {
   Serial.begin(115200);
   delay(100);
@@ -67,6 +83,16 @@ void setup() {
 
   debugln("");
 
+  // ========== SCOPED PROFILING ==========
+  debugln("--- Scoped Profiling (aggregated) ---");
+
+  for (int i = 0; i < 10; i++) {
+    scopedOperation(i);
+  }
+  debug_profile_report();  // One table instead of one line per call
+
+  debugln("");
+
   // ========== STACK PROFILING ==========
   debugln("--- Stack Usage ---");
 
@@ -90,7 +116,18 @@ void setup() {
   debugln("Note: All debug output disabled when DEBUG=0 in platformio.ini");
 }
 
+// Simulated control step with an occasional slow iteration
+void controlStep(int i) {
+  DEBUG_SCOPE_HISTOGRAM("controlStep");
+  delayMicroseconds(i % 500 == 0 ? 900 : 50);
+  debug_sample(5000, "controlStep i=%d", i);  // Runs ~10k/s; log 1 in 5000
+}
+
 void loop() {
+  static int step = 0;
+  controlStep(step++);
+  debug_histogram_report_every(10000);  // p50/p99/p99.9 every 10 seconds
+
   // Periodic profiling example
   static unsigned long last_profile = 0;
 
@@ -106,3 +143,13 @@ void loop() {
   // Your main application code here
   delay(1000);
 }
+
+#if !defined(ARDUINO)
+// Host-native build (see README "Host-Native Builds"): run one pass
+int main() {
+  Serial.echo(true);
+  setup();
+  loop();
+  return 0;
+}
+#endif
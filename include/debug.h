@@ -15,13 +15,20 @@
  *   debugf("X=%d, Y=%d, Z=%d", x, y, z);     // Multiple arguments
  *   debug_hex(0xFF);                          // Print as hex
  *   debug_array(data, 8);                     // Print 8-byte array
+ *
+ * Output goes to DEBUG_OUT (Serial by default, or the async ring buffer
+ * when DEBUG_ASYNC=1).
  */
 
 #ifndef DEBUG_H
 #define DEBUG_H
 
 #pragma once
+#if defined(ARDUINO)
 #include <Arduino.h>
+#else
+#include "debug_native.h"  // Host build: Print/Serial/micros shim
+#endif
 
 // ============================================================================
 // DEBUG FLAG - Set to 1 to enable debug output, 0 to disable
@@ -30,6 +37,224 @@
 #define DEBUG 1  // Can be overridden via compiler flags or platformio.ini
 #endif
 
+// ============================================================================
+// LOG LEVELS - Compile-time threshold for debug_error() ... debug_trace()
+// ============================================================================
+
+#define DEBUG_LEVEL_NONE 0
+#define DEBUG_LEVEL_ERROR 1
+#define DEBUG_LEVEL_WARN 2
+#define DEBUG_LEVEL_INFO 3
+#define DEBUG_LEVEL_DEBUG 4
+#define DEBUG_LEVEL_TRACE 5
+
+/**
+ * Level macros above the threshold compile to (void)0 exactly like the
+ * DEBUG=0 branch. Independent of DEBUG, so a release build can keep
+ * errors: -DDEBUG=0 -DDEBUG_LEVEL=DEBUG_LEVEL_ERROR
+ */
+#ifndef DEBUG_LEVEL
+#if DEBUG == 1
+#define DEBUG_LEVEL DEBUG_LEVEL_TRACE
+#else
+#define DEBUG_LEVEL DEBUG_LEVEL_NONE
+#endif
+#endif
+
+// True when any macro can produce output (backend must be compiled in)
+#define DEBUG_OUTPUT_ENABLED (DEBUG == 1 || DEBUG_LEVEL > DEBUG_LEVEL_NONE)
+
+// ============================================================================
+// OUTPUT BACKEND - Where the macros write
+// ============================================================================
+
+/**
+ * DEBUG_SINKS=1 makes DEBUG_OUT a dispatcher that formats each record once
+ * and hands the bytes to every registered sink (UART, RAM ring, flash,
+ * file, network ...) whose level threshold admits it (see debug_sink.h).
+ * Output outside the level macros counts as DEBUG_SINK_DEFAULT_LEVEL.
+ */
+#ifndef DEBUG_SINKS
+#define DEBUG_SINKS 0
+#endif
+
+#ifndef DEBUG_SINK_DEFAULT_LEVEL
+#define DEBUG_SINK_DEFAULT_LEVEL DEBUG_LEVEL_DEBUG
+#endif
+
+#if DEBUG_SINKS == 1
+#include "debug_sink.h"
+#ifndef DEBUG_FLASH_ECHO
+#define DEBUG_FLASH_ECHO 0  // Serial is a sink of its own
+#endif
+#endif
+
+#if DEBUG_OUTPUT_ENABLED && DEBUG_SINKS == 1
+#ifndef DEBUG_OUT
+#define DEBUG_OUT debug_sinks()
+#endif
+#define DEBUG_OUT_AT(level) debug_sinks().at(level)
+#define DEBUG_OUT_WANTS(level) debug_sinks().wants(level)
+#else
+#define DEBUG_OUT_AT(level) DEBUG_OUT
+#define DEBUG_OUT_WANTS(level) true
+#endif
+
+/**
+ * DEBUG_ASYNC=1 formats into a RAM ring buffer drained by a background task
+ * (see debug_async.h); call debug_async_begin() after Serial.begin().
+ * DEBUG_OUT can also be pointed at any other Print object (e.g. Serial1).
+ */
+#ifndef DEBUG_ASYNC
+#define DEBUG_ASYNC 0
+#endif
+
+/**
+ * DEBUG_FLASH=1 appends the output to a flash partition in CRC-checked
+ * blocks from a background task, echoing it to Serial (see debug_flash.h);
+ * call debug_flash_begin() in setup(), debug_flash_dump(Serial) to replay.
+ */
+#ifndef DEBUG_FLASH
+#define DEBUG_FLASH 0
+#endif
+
+#if DEBUG_OUTPUT_ENABLED && DEBUG_ASYNC == 1
+#include "debug_async.h"
+#ifndef DEBUG_OUT
+#define DEBUG_OUT debug_async_output()
+#endif
+#else
+#define debug_async_begin(...) ((void)0)
+#define debug_async_dropped() 0
+#endif
+
+#if DEBUG_OUTPUT_ENABLED && DEBUG_FLASH == 1
+#include "debug_flash.h"
+#ifndef DEBUG_OUT
+#define DEBUG_OUT debug_flash_output()
+#endif
+#else
+#define debug_flash_begin(...) ((void)0)
+#define debug_flash_dump(out) ((void)0)
+#endif
+
+#ifndef DEBUG_OUT
+#define DEBUG_OUT Serial
+#endif
+
+/**
+ * DEBUG_DEFERRED=1 makes debugf/debugfln/debug_if emit binary frames
+ * (format address + raw args) instead of formatting on the ESP32.
+ * Decode the capture on the host with tools/debug_decode.cpp.
+ */
+#ifndef DEBUG_DEFERRED
+#define DEBUG_DEFERRED 0
+#endif
+
+/**
+ * DEBUG_TOKENIZE=1 goes further: format literals are hashed at compile time
+ * and kept out of the flash image; only a 32-bit token plus varint-encoded
+ * args are sent (see debug_token.h). Takes precedence over DEBUG_DEFERRED.
+ */
+#ifndef DEBUG_TOKENIZE
+#define DEBUG_TOKENIZE 0
+#endif
+
+#if DEBUG_OUTPUT_ENABLED && DEBUG_TOKENIZE == 1
+#include "debug_token.h"
+#elif DEBUG_OUTPUT_ENABLED && DEBUG_DEFERRED == 1
+#include "debug_deferred.h"
+#endif
+
+/**
+ * DEBUG_COLLAPSE=1 replaces runs of identical lines (same format and
+ * argument values) with "[last message repeated N times]"; repeats are
+ * detected from a hash of the arguments, before anything is formatted
+ * (see debug_collapse.h). Any other macro output (debug, debugf, debug_val
+ * ...) ends the run; writes straight to DEBUG_OUT are not seen.
+ */
+#ifndef DEBUG_COLLAPSE
+#define DEBUG_COLLAPSE 0
+#endif
+
+/**
+ * DEBUG_FAST_FORMAT=1 renders debugf/debugfln/debug_if and the level macros
+ * with a variadic-template formatter instead of vsnprintf (text mode only;
+ * see debug_formatter.h). The format is parsed at compile time, so it must
+ * be a string literal.
+ */
+#ifndef DEBUG_FAST_FORMAT
+#define DEBUG_FAST_FORMAT 0
+#endif
+
+#if DEBUG_OUTPUT_ENABLED && DEBUG_FAST_FORMAT == 1 && DEBUG_TOKENIZE == 0 && DEBUG_DEFERRED == 0
+#include "debug_formatter.h"
+#endif
+
+/**
+ * DEBUG_FMT_CHECK=1 validates every debugf/debugfln/debug_if/debugf_isr/
+ * level-macro format literal against its argument types at compile time
+ * (see debug_format.h). Formats must then be string literals.
+ *
+ * Default: on for the backends that already need literal formats and get
+ * no -Wformat help (DEBUG_DEFERRED, DEBUG_TOKENIZE, DEBUG_FAST_FORMAT); off
+ * for plain printf output, so existing debugf(buffer) calls still compile.
+ *
+ * Integer conversions are matched by size, not signedness: %u given an
+ * int passes.
+ */
+#ifndef DEBUG_FMT_CHECK
+#if DEBUG_DEFERRED == 1 || DEBUG_TOKENIZE == 1 || DEBUG_FAST_FORMAT == 1
+#define DEBUG_FMT_CHECK 1
+#else
+#define DEBUG_FMT_CHECK 0
+#endif
+#endif
+
+#if DEBUG_OUTPUT_ENABLED && DEBUG_FMT_CHECK == 1
+#include "debug_format.h"
+#else
+#undef DEBUG_FMT_ASSERT  // debug_formatter.h includes debug_format.h for its parser
+#undef DEBUG_FMT_ASSERT_ISR
+#define DEBUG_FMT_ASSERT(fmt, ...) (void)0
+#define DEBUG_FMT_ASSERT_ISR(fmt) (void)0
+#endif
+
+#if DEBUG_OUTPUT_ENABLED && DEBUG_COLLAPSE == 1
+#include "debug_collapse.h"
+#if DEBUG_TOKENIZE == 1
+#define DEBUG_COLLAPSE_ID(fmt) std::integral_constant<uint32_t, debug_token_hash(fmt)>::value
+#else
+#define DEBUG_COLLAPSE_ID(fmt) ((uint32_t)(uintptr_t)(fmt))
+#endif
+#define DEBUG_COLLAPSE_IF(fmt, ...) if (debug_collapse_pass(DEBUG_OUT, DEBUG_COLLAPSE_ID(fmt), ##__VA_ARGS__))
+#define DEBUG_COLLAPSE_BREAK() debug_collapse_break(DEBUG_OUT)
+#define debug_collapse_poll() debug_collapse_flush(DEBUG_OUT, DEBUG_COLLAPSE_TIMEOUT_MS)
+#else
+#define DEBUG_COLLAPSE_IF(fmt, ...)
+#define DEBUG_COLLAPSE_BREAK() (void)0
+#define debug_collapse_poll() (void)0
+#endif
+
+/**
+ * DEBUG_CRASHLOG=1 mirrors log calls as binary records (no formatting) into
+ * RTC memory that survives panics and resets; debug_crashlog_begin() in
+ * setup() prints what the previous boot left behind (see debug_crashlog.h).
+ * Ignored with DEBUG_TOKENIZE=1.
+ */
+#ifndef DEBUG_CRASHLOG
+#define DEBUG_CRASHLOG 0
+#endif
+
+#if DEBUG_OUTPUT_ENABLED && DEBUG_CRASHLOG == 1 && DEBUG_TOKENIZE == 0
+#include "debug_crashlog.h"
+#define DEBUG_CRASHLOG_MIRROR(line, fmt, ...) debug_crashlog_log(line, fmt, ##__VA_ARGS__)
+#define debug_crashlog_begin() debug_crashlog_dump(DEBUG_OUT, DEBUG_CRASHLOG_KEEP)
+#else
+#define DEBUG_CRASHLOG_MIRROR(line, fmt, ...) (void)0
+#define debug_crashlog_begin() (void)0
+#endif
+
 // ============================================================================
 // CORE DEBUG MACROS
 // ============================================================================
@@ -40,67 +265,161 @@
  * Print single value (no newline)
  * Supports: char, int, float, String, const char*, etc.
  */
-#define debug(x) Serial.print(x)
+#define debug(x) (DEBUG_COLLAPSE_BREAK(), DEBUG_OUT.print(x))
 
 /**
  * Print single value with newline
  */
-#define debugln(x) Serial.println(x)
+#define debugln(x) (DEBUG_COLLAPSE_BREAK(), DEBUG_OUT.println(x))
+
+#if DEBUG_TOKENIZE == 1
+
+// Tokenized mode: compile-time token + varint args, literal kept out of flash
+#define debugf(fmt, ...) do { \
+  DEBUG_FMT_ASSERT(fmt, ##__VA_ARGS__); \
+  DEBUG_COLLAPSE_BREAK(); \
+  DEBUG_TOKEN_LOG(DEBUG_FRAME_TOKEN, fmt, ##__VA_ARGS__); \
+} while(0)
+#define debugfln(fmt, ...) do { \
+  DEBUG_FMT_ASSERT(fmt, ##__VA_ARGS__); \
+  DEBUG_COLLAPSE_IF(fmt, ##__VA_ARGS__) DEBUG_TOKEN_LOG(DEBUG_FRAME_TOKEN_LN, fmt, ##__VA_ARGS__); \
+} while(0)
+
+#elif DEBUG_DEFERRED == 1
+
+// Deferred mode: record format address + raw args, format on the host
+#define debugf(fmt, ...) do { \
+  DEBUG_FMT_ASSERT(fmt, ##__VA_ARGS__); \
+  DEBUG_COLLAPSE_BREAK(); \
+  DEBUG_CRASHLOG_MIRROR(false, fmt, ##__VA_ARGS__); \
+  debug_deferred_log(DEBUG_OUT, DEBUG_FRAME_DEFERRED, fmt, ##__VA_ARGS__); \
+} while(0)
+#define debugfln(fmt, ...) do { \
+  DEBUG_FMT_ASSERT(fmt, ##__VA_ARGS__); \
+  DEBUG_COLLAPSE_IF(fmt, ##__VA_ARGS__) { \
+    DEBUG_CRASHLOG_MIRROR(true, fmt, ##__VA_ARGS__); \
+    debug_deferred_log(DEBUG_OUT, DEBUG_FRAME_DEFERRED_LN, fmt, ##__VA_ARGS__); \
+  } \
+} while(0)
+
+#elif DEBUG_FAST_FORMAT == 1
+
+// Template formatter: no vsnprintf, one write per line (see debug_formatter.h)
+#define debugf(fmt, ...) do { \
+  DEBUG_FMT_ASSERT(fmt, ##__VA_ARGS__); \
+  DEBUG_COLLAPSE_BREAK(); \
+  DEBUG_CRASHLOG_MIRROR(false, fmt, ##__VA_ARGS__); \
+  DEBUG_FORMAT_TO(DEBUG_OUT, fmt, ##__VA_ARGS__); \
+} while(0)
+#define debugfln(fmt, ...) do { \
+  DEBUG_FMT_ASSERT(fmt, ##__VA_ARGS__); \
+  DEBUG_COLLAPSE_IF(fmt, ##__VA_ARGS__) { \
+    DEBUG_CRASHLOG_MIRROR(true, fmt, ##__VA_ARGS__); \
+    DEBUG_FORMAT_TO(DEBUG_OUT, fmt "\r\n", ##__VA_ARGS__); \
+  } \
+} while(0)
+
+#else
 
 /**
  * Printf-style formatted output with variadic arguments
  * Supports any number of format arguments
  * Example: debugf("X=%d, Y=%d", x, y)
  */
-#define debugf(...) Serial.printf(__VA_ARGS__)
+#define debugf(fmt, ...) do { \
+  DEBUG_FMT_ASSERT(fmt, ##__VA_ARGS__); \
+  DEBUG_COLLAPSE_BREAK(); \
+  DEBUG_CRASHLOG_MIRROR(false, fmt, ##__VA_ARGS__); \
+  DEBUG_OUT.printf(fmt, ##__VA_ARGS__); \
+} while(0)
 
 /**
  * Printf-style with newline
  */
-#define debugfln(fmt, ...) do { Serial.printf(fmt, ##__VA_ARGS__); Serial.println(); } while(0)
+#define debugfln(fmt, ...) do { \
+  DEBUG_FMT_ASSERT(fmt, ##__VA_ARGS__); \
+  DEBUG_COLLAPSE_IF(fmt, ##__VA_ARGS__) { \
+    DEBUG_CRASHLOG_MIRROR(true, fmt, ##__VA_ARGS__); \
+    DEBUG_OUT.printf(fmt, ##__VA_ARGS__); \
+    DEBUG_OUT.println(); \
+  } \
+} while(0)
+
+#endif  // DEBUG_TOKENIZE / DEBUG_DEFERRED / DEBUG_FAST_FORMAT
 
 /**
- * Print hex value with optional prefix
+ * Print hex value: upper case, at least two digits, no printf
+ * (conversion kernels in debug_conv.h)
  * Example: debug_hex(0xFF) outputs "FF"
  */
-#define debug_hex(val) Serial.printf("%02X", (uint32_t)(val))
+#include "debug_conv.h"
+#define debug_hex(val) (DEBUG_COLLAPSE_BREAK(), debug_conv_print_hex(DEBUG_OUT, (uint32_t)(val)))
 
 /**
- * Print binary value
+ * Print binary value without leading zeros
  * Example: debug_bin(0b1010) outputs "1010"
  */
-#define debug_bin(val) Serial.printf("%b", (uint32_t)(val))
+#define debug_bin(val) (DEBUG_COLLAPSE_BREAK(), debug_conv_print_bin(DEBUG_OUT, (uint32_t)(val)))
 
 /**
- * Print memory dump of byte array
- * Example: debug_array(buffer, 16) - prints 16 bytes in hex
+ * Print binary value zero-padded to `bits` digits (1-32; wider is clamped), grouped every
+ * DEBUG_BIN_GROUP digits (default 4, separator DEBUG_BIN_SEPARATOR)
+ * Example: debug_binw(0x2C, 8) outputs "0010 1100"
  */
-#define debug_array(data, len) do { \
-  for (size_t _i = 0; _i < (len); _i++) { \
-    Serial.printf("%02X ", ((uint8_t*)(data))[_i]); \
-    if ((_i + 1) % 16 == 0) Serial.println(); \
-  } \
-  Serial.println(); \
+#define debug_binw(val, bits) (DEBUG_COLLAPSE_BREAK(), debug_conv_print_binw(DEBUG_OUT, (uint32_t)(val), (bits)))
+
+/**
+ * Decode a register into named bitfields, listed from bit 0 upward; the
+ * layout literal is parsed once per call site (see debug_bits.h)
+ * Example: debug_bits(0xAB, "EN:1,MODE:3,IRQ:4") outputs "EN=1 MODE=101 IRQ=1010"
+ */
+#include "debug_bits.h"
+#define debug_bits(reg, layout) do { \
+  static const DebugBitsLayout debug_bits_layout_(layout); \
+  DEBUG_COLLAPSE_BREAK(); \
+  debug_bits_print(DEBUG_OUT, debug_bits_layout_, (uint32_t)(reg)); \
 } while(0)
 
 /**
- * Print labeled value for debugging
+ * Print memory dump of byte array: offset, 16 hex bytes and ASCII per row,
+ * each row emitted with a single write (see debug_hexdump.h)
+ * Example: debug_array(buffer, 16)
+ *   0000: 42 12 34 56 78 9A BC DE 48 65 6C 6C 6F 00 01 02  |B.4Vx...Hello...|
+ */
+#include "debug_hexdump.h"
+#define debug_array(data, len) (DEBUG_COLLAPSE_BREAK(), debug_hexdump(DEBUG_OUT, (data), (len)))
+
+/**
+ * Print labeled value for debugging: integers exactly (no int cast),
+ * floats with DEBUG_VAL_DECIMALS decimals
  * Example: debug_val("count", count) outputs "count=42"
+ *          debug_val("temp", 21.5f) outputs "temp=21.50"
  */
-#define debug_val(name, val) Serial.printf("%s=%d\n", name, (int)(val))
+#define debug_val(name, val) (DEBUG_COLLAPSE_BREAK(), debug_conv_print_val(DEBUG_OUT, name, val))
 
 /**
  * Print with category prefix
  * Example: debug_tag("[CAN]", "Message received")
  */
-#define debug_tag(tag, msg) Serial.printf("%s %s\n", tag, msg)
+#if DEBUG_TOKENIZE == 1
+#define debug_tag(tag, msg) do { \
+  DEBUG_COLLAPSE_IF("%s %s", tag, msg) DEBUG_TOKEN_LOG(DEBUG_FRAME_TOKEN_LN, "%s %s", tag, msg); \
+} while(0)
+#else
+#define debug_tag(tag, msg) do { \
+  DEBUG_COLLAPSE_IF("%s %s\n", tag, msg) { \
+    DEBUG_CRASHLOG_MIRROR(true, "%s %s\n", tag, msg); \
+    DEBUG_OUT.printf("%s %s\n", tag, msg); \
+  } \
+} while(0)
+#endif
 
 /**
  * Conditional debug output
  * Example: debug_if(error, "Error occurred: %d", error_code)
  */
-#define debug_if(condition, ...) do { \
-  if (condition) { Serial.printf(__VA_ARGS__); Serial.println(); } \
+#define debug_if(condition, fmt, ...) do { \
+  if (condition) { debugfln(fmt, ##__VA_ARGS__); } \
 } while(0)
 
 /**
@@ -109,7 +428,10 @@
  */
 #define debug_assert(condition, msg) do { \
   if (!(condition)) { \
-    Serial.printf("[ASSERT] %s\n", msg); \
+    DEBUG_COLLAPSE_BREAK(); \
+    DEBUG_CRASHLOG_MIRROR(true, "[ASSERT] %s\n", msg); \
+    DEBUG_OUT.printf("[ASSERT] %s\n", msg); \
+    DEBUG_OUT.flush(); \
     while(1);  /* Halt for debugging */ \
   } \
 } while(0)
@@ -125,27 +447,39 @@
  */
 #define debug_elapsed(start_time, label) do { \
   unsigned long elapsed = micros() - (start_time); \
-  Serial.printf("[PERF] %s: %lu µs\n", label, elapsed); \
+  DEBUG_COLLAPSE_BREAK(); \
+  DEBUG_OUT.printf("[PERF] %s: %lu µs\n", label, elapsed); \
 } while(0)
 
 /**
- * Stack usage estimation
+ * Stack usage estimation. On the ESP32 this is the current task's
+ * high-water mark: the fewest bytes of stack that have been left free.
  */
+#if defined(ESP_PLATFORM)
+#define debug_stack() (DEBUG_COLLAPSE_BREAK(), \
+  DEBUG_OUT.printf("[STACK] %u bytes free (task minimum)\n", (unsigned)uxTaskGetStackHighWaterMark(NULL)))
+#elif defined(ARDUINO)
 #define debug_stack() do { \
   extern int __bss_end, __data_start; \
   int stack_ptr; \
-  Serial.printf("[STACK] ~%d bytes free\n", (int)&stack_ptr - __bss_end); \
+  DEBUG_COLLAPSE_BREAK(); \
+  DEBUG_OUT.printf("[STACK] ~%d bytes free\n", (int)&stack_ptr - __bss_end); \
 } while(0)
+#else
+#define debug_stack() (DEBUG_COLLAPSE_BREAK(), DEBUG_OUT.printf("[STACK] not available on host\n"))
+#endif
 
 #else  // DEBUG == 0 - All debug output compiled away
 
 // Completely remove all debug code with zero overhead
 #define debug(x) (void)0
 #define debugln(x) (void)0
-#define debugf(...) (void)0
-#define debugfln(...) (void)0
+#define debugf(fmt, ...) (void)0
+#define debugfln(fmt, ...) (void)0
 #define debug_hex(val) (void)0
 #define debug_bin(val) (void)0
+#define debug_binw(val, bits) (void)0
+#define debug_bits(reg, layout) (void)0
 #define debug_array(data, len) (void)0
 #define debug_val(name, val) (void)0
 #define debug_tag(tag, msg) (void)0
@@ -157,12 +491,298 @@
 
 #endif  // DEBUG
 
+// ============================================================================
+// LEVELED LOGGING - Removed at compile time below DEBUG_LEVEL
+// ============================================================================
+
+/**
+ * Emit one "[L] message" line at a level in the active output mode; with
+ * DEBUG_SINKS=1 nothing is formatted unless some sink accepts the level.
+ * fmt must be a string literal (the level prefix is concatenated to it).
+ */
+#if DEBUG_TOKENIZE == 1
+#define DEBUG_LOG_EMIT_AT(level, prefix, fmt, ...) do { \
+  DEBUG_FMT_ASSERT(prefix fmt, ##__VA_ARGS__); \
+  if (!DEBUG_OUT_WANTS(level)) break; \
+  DEBUG_COLLAPSE_IF(prefix fmt, ##__VA_ARGS__) DEBUG_TOKEN_LOG_TO(DEBUG_OUT_AT(level), DEBUG_FRAME_TOKEN_LN, prefix fmt, ##__VA_ARGS__); \
+} while(0)
+#elif DEBUG_DEFERRED == 1
+#define DEBUG_LOG_EMIT_AT(level, prefix, fmt, ...) do { \
+  DEBUG_FMT_ASSERT(prefix fmt, ##__VA_ARGS__); \
+  if (!DEBUG_OUT_WANTS(level)) break; \
+  DEBUG_COLLAPSE_IF(prefix fmt, ##__VA_ARGS__) { \
+    DEBUG_CRASHLOG_MIRROR(true, prefix fmt, ##__VA_ARGS__); \
+    debug_deferred_log(DEBUG_OUT_AT(level), DEBUG_FRAME_DEFERRED_LN, prefix fmt, ##__VA_ARGS__); \
+  } \
+} while(0)
+#elif DEBUG_FAST_FORMAT == 1
+#define DEBUG_LOG_EMIT_AT(level, prefix, fmt, ...) do { \
+  DEBUG_FMT_ASSERT(prefix fmt, ##__VA_ARGS__); \
+  if (!DEBUG_OUT_WANTS(level)) break; \
+  DEBUG_COLLAPSE_IF(prefix fmt, ##__VA_ARGS__) { \
+    DEBUG_CRASHLOG_MIRROR(true, prefix fmt "\n", ##__VA_ARGS__); \
+    DEBUG_FORMAT_TO(DEBUG_OUT_AT(level), prefix fmt "\n", ##__VA_ARGS__); \
+  } \
+} while(0)
+#else
+#define DEBUG_LOG_EMIT_AT(level, prefix, fmt, ...) do { \
+  DEBUG_FMT_ASSERT(prefix fmt, ##__VA_ARGS__); \
+  if (!DEBUG_OUT_WANTS(level)) break; \
+  DEBUG_COLLAPSE_IF(prefix fmt, ##__VA_ARGS__) { \
+    DEBUG_CRASHLOG_MIRROR(true, prefix fmt "\n", ##__VA_ARGS__); \
+    DEBUG_OUT_AT(level).printf(prefix fmt "\n", ##__VA_ARGS__); \
+  } \
+} while(0)
+#endif
+
+/**
+ * Same at DEBUG_SINK_DEFAULT_LEVEL (tags, rate limiting, sampling)
+ */
+#define DEBUG_LOG_EMIT(prefix, fmt, ...) DEBUG_LOG_EMIT_AT(DEBUG_SINK_DEFAULT_LEVEL, prefix, fmt, ##__VA_ARGS__)
+
+/**
+ * Leveled printf-style output with automatic newline
+ * Example: debug_warn("CAN bus-off, tec=%d", tec) outputs "[W] CAN bus-off, tec=128"
+ */
+#if DEBUG_LEVEL >= DEBUG_LEVEL_ERROR
+#define debug_error(fmt, ...) DEBUG_LOG_EMIT_AT(DEBUG_LEVEL_ERROR, "[E] ", fmt, ##__VA_ARGS__)
+#else
+#define debug_error(fmt, ...) (void)0
+#endif
+
+#if DEBUG_LEVEL >= DEBUG_LEVEL_WARN
+#define debug_warn(fmt, ...) DEBUG_LOG_EMIT_AT(DEBUG_LEVEL_WARN, "[W] ", fmt, ##__VA_ARGS__)
+#else
+#define debug_warn(fmt, ...) (void)0
+#endif
+
+#if DEBUG_LEVEL >= DEBUG_LEVEL_INFO
+#define debug_info(fmt, ...) DEBUG_LOG_EMIT_AT(DEBUG_LEVEL_INFO, "[I] ", fmt, ##__VA_ARGS__)
+#else
+#define debug_info(fmt, ...) (void)0
+#endif
+
+#if DEBUG_LEVEL >= DEBUG_LEVEL_DEBUG
+#define debug_debug(fmt, ...) DEBUG_LOG_EMIT_AT(DEBUG_LEVEL_DEBUG, "[D] ", fmt, ##__VA_ARGS__)
+#else
+#define debug_debug(fmt, ...) (void)0
+#endif
+
+#if DEBUG_LEVEL >= DEBUG_LEVEL_TRACE
+#define debug_trace(fmt, ...) DEBUG_LOG_EMIT_AT(DEBUG_LEVEL_TRACE, "[T] ", fmt, ##__VA_ARGS__)
+#else
+#define debug_trace(fmt, ...) (void)0
+#endif
+
+// ============================================================================
+// TAG FILTERING - Compile-time tag IDs, runtime enable mask
+// ============================================================================
+
+#if DEBUG == 1
+
+#include "debug_tags.h"
+
+/**
+ * Tagged printf-style output with automatic newline, printed only while the
+ * tag is enabled. Tags come from DEBUG_TAG_LIST (see debug_tags.h).
+ * Example: debug_tagf(CAN, "RX id=0x%X", id) outputs "[CAN] RX id=0x123"
+ */
+#define debug_tagf(tag, fmt, ...) do { \
+  if (debug_tag_enabled(DEBUG_TAG_##tag)) { DEBUG_LOG_EMIT("[" #tag "] ", fmt, ##__VA_ARGS__); } \
+} while(0)
+
+#else
+
+#define debug_tagf(tag, fmt, ...) (void)0
+#define debug_tag_enable(id, on) (void)0
+#define debug_tag_command(cmd) false
+#define debug_tag_poll(stream) (void)0
+
+#endif  // DEBUG
+
+// ============================================================================
+// RATE LIMITING - Per-call-site token bucket, suppressed calls never format
+// ============================================================================
+
+#if DEBUG == 1
+
+#include "debug_ratelimit.h"
+
+/**
+ * Printf-style output with automatic newline, limited to `rate` lines per
+ * second with bursts of up to `burst` lines at this call site. Dropped
+ * calls are counted and reported as "[RATELIMIT] N suppressed" before the
+ * next line that gets through.
+ * Example: debug_ratelimit(1, 3, "Sensor out of range: %d", raw)
+ */
+#define debug_ratelimit(rate, burst, fmt, ...) do { \
+  static DebugRateLimit debug_rl_site_; \
+  uint32_t debug_rl_suppressed_; \
+  if (debug_ratelimit_allow(debug_rl_site_, (rate), (burst), &debug_rl_suppressed_)) { \
+    if (debug_rl_suppressed_) { \
+      DEBUG_LOG_EMIT("[RATELIMIT] ", "%lu suppressed", (unsigned long)debug_rl_suppressed_); \
+    } \
+    DEBUG_LOG_EMIT("", fmt, ##__VA_ARGS__); \
+  } \
+} while(0)
+
+#else
+
+#define debug_ratelimit(rate, burst, fmt, ...) (void)0
+
+#endif  // DEBUG
+
+// ============================================================================
+// SAMPLING - Log a fixed fraction of a high-frequency call site
+// ============================================================================
+
+#if DEBUG == 1
+
+#include "debug_sample.h"
+
+/**
+ * Printf-style output with automatic newline for 1 in every n calls of
+ * this call site, prefixed with the emitted/total counts
+ * Example: debug_sample(1000, "pid err=%d out=%d", err, out)
+ *   outputs "[SAMPLE 3/2001] pid err=-4 out=512"
+ */
+#define debug_sample(n, fmt, ...) do { \
+  static DebugSample debug_sample_site_; \
+  if (debug_sample_every(debug_sample_site_, (n))) { \
+    DEBUG_LOG_EMIT("[SAMPLE %lu/%lu] ", fmt, (unsigned long)debug_sample_site_.emitted, \
+                   (unsigned long)debug_sample_site_.total, ##__VA_ARGS__); \
+  } \
+} while(0)
+
+/**
+ * Like debug_sample(), but each call is logged with probability 1/n
+ * (xorshift32), so sampling cannot lock onto a periodic pattern
+ */
+#define debug_sample_random(n, fmt, ...) do { \
+  static DebugSample debug_sample_site_; \
+  if (debug_sample_chance(debug_sample_site_, (n))) { \
+    DEBUG_LOG_EMIT("[SAMPLE %lu/%lu] ", fmt, (unsigned long)debug_sample_site_.emitted, \
+                   (unsigned long)debug_sample_site_.total, ##__VA_ARGS__); \
+  } \
+} while(0)
+
+#else
+
+#define debug_sample(n, fmt, ...) (void)0
+#define debug_sample_random(n, fmt, ...) (void)0
+
+#endif  // DEBUG
+
+// ============================================================================
+// SCOPED PROFILING - RAII cycle-counter timers aggregated in a table
+// ============================================================================
+
+#if DEBUG == 1
+
+#include "debug_profile.h"
+
+/**
+ * DEBUG_SCOPE("name") times the rest of the enclosing block; results are
+ * aggregated (calls/total/avg/min/max) and printed by debug_profile_report()
+ * Example:
+ *   void loop() { DEBUG_SCOPE("loop"); ... }
+ */
+#define debug_profile_report() (DEBUG_COLLAPSE_BREAK(), debug_profile_print(DEBUG_OUT))
+
+/**
+ * DEBUG_SCOPE_HISTOGRAM("name") also keeps a latency histogram;
+ * debug_histogram_report() prints min/mean/p50/p99/p99.9/max per scope
+ * Example: debug_histogram_report_every(10000);  // in loop(), every 10 s
+ */
+#define debug_histogram_report() (DEBUG_COLLAPSE_BREAK(), debug_histogram_print(DEBUG_OUT))
+#define debug_histogram_report_every(ms) debug_histogram_print_every(DEBUG_OUT, ms)
+
+/**
+ * With DEBUG_TRACE=1, write the span buffer as binary frames for
+ * tools/debug_trace.cpp (Chrome Trace JSON for Perfetto)
+ */
+#if DEBUG_TRACE == 1
+#define debug_trace_dump() (DEBUG_COLLAPSE_BREAK(), debug_trace_print(DEBUG_OUT))
+#else
+#define debug_trace_dump() (void)0
+#endif
+
+#else
+
+#define DEBUG_SCOPE(name) (void)0
+#define DEBUG_SCOPE_HISTOGRAM(name) (void)0
+#define debug_histogram_report() (void)0
+#define debug_histogram_report_every(ms) (void)0
+#define debug_trace_dump() (void)0
+#define debug_profile_report() (void)0
+#define debug_profile_reset() (void)0
+
+#endif  // DEBUG
+
+// ============================================================================
+// HEAP TRACKING - Per-call-site allocation statistics (opt-in)
+// ============================================================================
+
+/**
+ * DEBUG_HEAP=1 hooks malloc/calloc/realloc/free and operator new/delete
+ * and keeps live bytes, peak and counts per caller address (see
+ * debug_heap.h). The ESP32 build also needs
+ *   -Wl,--wrap=malloc,--wrap=free,--wrap=calloc,--wrap=realloc
+ * Example: debug_heap_report();   // e.g. every few minutes in a soak test
+ */
+#ifndef DEBUG_HEAP
+#define DEBUG_HEAP 0
+#endif
+
+#if DEBUG == 1 && DEBUG_HEAP == 1
+#include "debug_heap.h"
+#define debug_heap_report() (DEBUG_COLLAPSE_BREAK(), debug_heap_print(DEBUG_OUT))
+#define debug_heap_reset_peak() debug_heap_table().reset_peak()
+#else
+#define debug_heap_report() (void)0
+#define debug_heap_reset_peak() (void)0
+#endif
+
+// ============================================================================
+// ISR-SAFE LOGGING - Binary records from interrupt handlers, formatted later
+// ============================================================================
+
+#if DEBUG == 1
+
+#include "debug_isr.h"
+
+/**
+ * Log from an ISR: copies the format pointer and up to four integer (32-bit
+ * at most) or pointer arguments into a per-core, per-interrupt-level ring. Nothing is
+ * formatted until debug_isr_drain() runs in task context.
+ * Example:
+ *   void IRAM_ATTR onPulse() { debugf_isr("pulse gpio=%d", pin); }
+ *   void loop() { debug_isr_drain(); }
+ */
+#define debug_isr(msg) debug_isr_write(msg)
+#define debugf_isr(fmt, ...) do { \
+  DEBUG_FMT_ASSERT(fmt, ##__VA_ARGS__); \
+  DEBUG_FMT_ASSERT_ISR(fmt); \
+  debug_isr_write(fmt, ##__VA_ARGS__); \
+} while(0)
+#define debug_isr_drain() (DEBUG_COLLAPSE_BREAK(), debug_isr_print(DEBUG_OUT))
+#define debug_isr_report() (DEBUG_COLLAPSE_BREAK(), debug_isr_stats(DEBUG_OUT))
+
+#else
+
+#define debug_isr(msg) (void)0
+#define debugf_isr(fmt, ...) (void)0
+#define debug_isr_drain() (void)0
+#define debug_isr_report() (void)0
+
+#endif  // DEBUG
+
 // ============================================================================
 // LEGACY SUPPORT - For backwards compatibility with existing code
 // ============================================================================
 
 #if DEBUG == 1
-  #define debugg(x, y, z) Serial.printf(x, y, z)
+  #define debugg(x, y, z) (DEBUG_COLLAPSE_BREAK(), DEBUG_OUT.printf(x, y, z))
 #else
   #define debugg(x, y, z) (void)0
 #endif
@@ -0,0 +1,254 @@
+/**
+ * @file debug_async.h
+ * @brief Asynchronous output backend for the debug macros
+ *
+ * When DEBUG_ASYNC=1, debug.h routes every macro to a Print object that
+ * formats into a statically allocated ring buffer instead of the UART.
+ * A low-priority drain task moves the buffered bytes to Serial, so the
+ * caller only pays for formatting and a memcpy.
+ *
+ * Usage (platformio.ini):
+ *   build_flags = -DDEBUG_ASYNC=1 -DDEBUG_ASYNC_BUFFER_SIZE=8192
+ *
+ *   void setup() {
+ *     Serial.begin(115200);
+ *     debug_async_begin();                // start the drain task
+ *   }
+ */
+
+#ifndef DEBUG_ASYNC_H
+#define DEBUG_ASYNC_H
+
+#pragma once
+#include <stdarg.h>
+#include <stdio.h>
+#include "debug_ring.h"
+
+#if !defined(ESP_PLATFORM)
+#include <chrono>
+#include <functional>
+#include <thread>
+#endif
+
+// ============================================================================
+// CONFIGURATION - Override via compiler flags or platformio.ini
+// ============================================================================
+
+#ifndef DEBUG_ASYNC_BUFFER_SIZE
+#define DEBUG_ASYNC_BUFFER_SIZE 4096  // Total bytes, split evenly across the per-core rings
+#endif
+
+#ifndef DEBUG_ASYNC_POLICY
+#define DEBUG_ASYNC_POLICY DEBUG_DROP_NEWEST
+#endif
+
+#ifndef DEBUG_ASYNC_LINE_MAX
+#define DEBUG_ASYNC_LINE_MAX 128  // Longest single formatted write (truncated beyond)
+#endif
+
+#ifndef DEBUG_ASYNC_CHUNK
+#define DEBUG_ASYNC_CHUNK 128  // Bytes handed to the UART per drain step
+#endif
+
+#ifndef DEBUG_ASYNC_DRAIN_MS
+#define DEBUG_ASYNC_DRAIN_MS 5  // Drain task sleep when the ring is empty (at least one tick)
+#endif
+
+#ifndef DEBUG_ASYNC_TASK_STACK
+#define DEBUG_ASYNC_TASK_STACK 3072
+#endif
+
+#ifndef DEBUG_ASYNC_UART
+#define DEBUG_ASYNC_UART Serial  // Where the drain task writes
+#endif
+
+#ifndef DEBUG_ASYNC_CORES
+#if defined(ESP_PLATFORM)
+#define DEBUG_ASYNC_CORES portNUM_PROCESSORS
+#else
+#define DEBUG_ASYNC_CORES 1  // Host: set >1 to spread threads over several rings
+#endif
+#endif
+
+/**
+ * Index of the ring the caller writes to: the current core on ESP32, a
+ * per-thread hash on the host
+ */
+inline int debug_async_core() {
+#if defined(ESP_PLATFORM)
+  return (int)xPortGetCoreID();
+#else
+  return DEBUG_ASYNC_CORES == 1
+             ? 0
+             : (int)(std::hash<std::thread::id>()(std::this_thread::get_id()) % DEBUG_ASYNC_CORES);
+#endif
+}
+
+// ============================================================================
+// ASYNC PRINT OBJECT
+// ============================================================================
+
+/**
+ * Print implementation backed by one DebugRing per CPU core.
+ * A write() goes to the ring of the core it runs on, so the two cores never
+ * touch the same indices; within a core it is one lock-free record, so
+ * tasks never interleave inside a line. Records carry a microsecond stamp
+ * and drain() merges the per-core rings oldest first.
+ * print()/println() of any type go through Print and end up in write();
+ * printf() is shadowed so formatting uses a fixed stack buffer and never
+ * allocates (Print::printf falls back to malloc for long lines).
+ */
+class DebugAsyncOutput : public Print {
+  typedef DebugRing<DEBUG_ASYNC_BUFFER_SIZE / DEBUG_ASYNC_CORES> Ring;
+
+ public:
+  DebugAsyncOutput() {
+    draining_.clear();
+    for (int c = 0; c < DEBUG_ASYNC_CORES; c++) pending_len_[c] = -1;
+  }
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+
+  size_t write(const uint8_t* data, size_t len) override {
+    return rings_[debug_async_core()].write(data, len, DEBUG_ASYNC_POLICY, (uint32_t)micros());
+  }
+  using Print::write;
+
+  size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+    va_list args;
+    va_start(args, fmt);
+    size_t n = vprintf(fmt, args);
+    va_end(args);
+    return n;
+  }
+
+  size_t vprintf(const char* fmt, va_list args) {
+    char line[DEBUG_ASYNC_LINE_MAX];
+    size_t cut;
+    size_t n = debug_vformat_line(line, sizeof(line), fmt, args, &cut);
+    Ring& ring = rings_[debug_async_core()];
+    if (cut) ring.discard(cut);
+    return n ? ring.write((const uint8_t*)line, n, DEBUG_ASYNC_POLICY, (uint32_t)micros()) : 0;
+  }
+
+  /**
+   * Move up to one chunk of records to out, merging the per-core rings by
+   * timestamp (k-way merge holding the next record of each core). Order is
+   * exact for records already committed when the merge runs. Returns bytes
+   * moved; returns 0 if another task is draining.
+   */
+  size_t drain(Print& out) {
+    if (draining_.test_and_set(std::memory_order_acquire)) return 0;
+    uint8_t chunk[DEBUG_ASYNC_CHUNK > Ring::record_max() ? DEBUG_ASYNC_CHUNK : Ring::record_max()];
+    size_t n = 0;
+    for (;;) {
+      int next = -1;
+      for (int c = 0; c < DEBUG_ASYNC_CORES; c++) {
+        if (pending_len_[c] < 0) {
+          pending_len_[c] = rings_[c].pop(pending_[c], sizeof(pending_[c]), &pending_stamp_[c]);
+        }
+        if (pending_len_[c] >= 0 &&
+            (next < 0 || (int32_t)(pending_stamp_[c] - pending_stamp_[next]) < 0)) {
+          next = c;
+        }
+      }
+      if (next < 0 || n + pending_len_[next] > sizeof(chunk)) break;
+      memcpy(chunk + n, pending_[next], pending_len_[next]);
+      n += pending_len_[next];
+      pending_len_[next] = -1;
+    }
+    if (n) out.write(chunk, n);
+    draining_.clear(std::memory_order_release);
+    return n;
+  }
+
+  /**
+   * Synchronously empty the rings into the UART (used by debug_assert and
+   * before sleep/restart so buffered output is not lost)
+   */
+  void flush() override {
+    while (drain(DEBUG_ASYNC_UART)) {
+    }
+    DEBUG_ASYNC_UART.flush();
+  }
+
+  size_t buffered() {
+    size_t n = 0;
+    for (int c = 0; c < DEBUG_ASYNC_CORES; c++) n += rings_[c].used();
+    return n;
+  }
+
+  uint32_t dropped() const {
+    uint32_t n = 0;
+    for (int c = 0; c < DEBUG_ASYNC_CORES; c++) n += rings_[c].dropped();
+    return n;
+  }
+
+ private:
+  Ring rings_[DEBUG_ASYNC_CORES];
+  uint8_t pending_[DEBUG_ASYNC_CORES][Ring::record_max()];  // Merge heads (drain only)
+  int pending_len_[DEBUG_ASYNC_CORES];
+  uint32_t pending_stamp_[DEBUG_ASYNC_CORES];
+  std::atomic_flag draining_;
+};
+
+/**
+ * The single async output instance (statically allocated on first use)
+ */
+inline DebugAsyncOutput& debug_async_output() {
+  static DebugAsyncOutput out;
+  return out;
+}
+
+/**
+ * Bytes discarded because the ring was full (DEBUG_DROP_* policies) or
+ * cut from writes longer than one record (Ring::record_max()) or from
+ * printf lines longer than DEBUG_ASYNC_LINE_MAX - 1
+ */
+inline uint32_t debug_async_dropped() { return debug_async_output().dropped(); }
+
+// ============================================================================
+// DRAIN TASK
+// ============================================================================
+
+#if defined(ESP_PLATFORM)
+
+inline void debug_async_drain_task(void*) {
+  const TickType_t idle = pdMS_TO_TICKS(DEBUG_ASYNC_DRAIN_MS) ? pdMS_TO_TICKS(DEBUG_ASYNC_DRAIN_MS) : 1;  // 0 would spin
+  for (;;) {
+    if (!debug_async_output().drain(DEBUG_ASYNC_UART)) {
+      vTaskDelay(idle);
+    }
+  }
+}
+
+/**
+ * Start the drain task. Call once after Serial.begin().
+ * Priority 1 keeps it below typical application tasks.
+ */
+inline bool debug_async_begin(UBaseType_t priority = 1, BaseType_t core = tskNO_AFFINITY) {
+  static TaskHandle_t handle = NULL;
+  if (handle) return true;
+  return xTaskCreatePinnedToCore(debug_async_drain_task, "debug_drain", DEBUG_ASYNC_TASK_STACK,
+                                 NULL, priority, &handle, core) == pdPASS;
+}
+
+#else  // Host build - drain from a detached std::thread
+
+inline bool debug_async_begin() {
+  static bool started = false;
+  if (started) return true;
+  started = true;
+  std::thread([] {
+    for (;;) {
+      if (!debug_async_output().drain(DEBUG_ASYNC_UART)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(DEBUG_ASYNC_DRAIN_MS));
+      }
+    }
+  }).detach();
+  return true;
+}
+
+#endif  // ESP_PLATFORM
+
+#endif  // DEBUG_ASYNC_H
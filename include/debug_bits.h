@@ -0,0 +1,95 @@
+/**
+ * @file debug_bits.h
+ * @brief Named register bitfield decoding for debug_bits()
+ *
+ *   debug_bits(ctrl, "EN:1,MODE:3,IRQ:4");
+ *   // ctrl = 0xAB  ->  "EN=1 MODE=101 IRQ=1010"
+ *
+ * Fields are listed from bit 0 upward as NAME:WIDTH; an empty name
+ * (":2") skips reserved bits. Single-bit fields print as 0/1, wider ones
+ * as WIDTH binary digits via the table kernels in debug_conv.h.
+ *
+ * The layout string is parsed once per call site into a DebugBitsLayout
+ * (function-local static), so a call in a loop costs one shift/mask and
+ * one table expansion per field plus a single write.
+ */
+
+#ifndef DEBUG_BITS_H
+#define DEBUG_BITS_H
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "debug_conv.h"
+
+#ifndef DEBUG_BITS_MAX_FIELDS
+#define DEBUG_BITS_MAX_FIELDS 16  // Fields per layout; extra fields are ignored
+#endif
+
+struct DebugBitsField {
+  const char* name;  // Points into the layout literal
+  uint8_t name_len;  // 0 for reserved (skipped) bits
+  uint8_t shift;
+  uint8_t width;
+};
+
+struct DebugBitsLayout {
+  DebugBitsField fields[DEBUG_BITS_MAX_FIELDS];
+  uint8_t count;
+
+  /**
+   * Parse "NAME:WIDTH,..." - stops at the first malformed field or when
+   * the widths pass 32 bits
+   */
+  explicit DebugBitsLayout(const char* layout) : count(0) {
+    const char* p = layout;
+    unsigned shift = 0;
+    while (*p && count < DEBUG_BITS_MAX_FIELDS) {
+      while (*p == ' ' || *p == ',') p++;
+      const char* name = p;
+      while (*p && *p != ':' && *p != ',') p++;
+      if (*p != ':') break;
+      size_t name_len = (size_t)(p - name);
+      while (name_len && name[name_len - 1] == ' ') name_len--;
+      unsigned width = 0;
+      p++;
+      while (*p == ' ') p++;
+      for (; *p >= '0' && *p <= '9'; p++) width = width * 10 + (unsigned)(*p - '0');
+      if (width == 0 || shift + width > 32) break;
+      DebugBitsField& f = fields[count++];
+      f.name = name;
+      f.name_len = (uint8_t)(name_len > 32 ? 32 : name_len);
+      f.shift = (uint8_t)shift;
+      f.width = (uint8_t)width;
+      shift += width;
+    }
+  }
+};
+
+/**
+ * Print "NAME=bits NAME=bits ...\n" for value, written once per 128 bytes
+ */
+template <typename Out>
+inline void debug_bits_print(Out& out, const DebugBitsLayout& layout, uint32_t value) {
+  char buf[128];
+  size_t n = 0;
+  for (uint8_t i = 0; i < layout.count; i++) {
+    const DebugBitsField& f = layout.fields[i];
+    if (!f.name_len) continue;
+    if (n + f.name_len + 34 > sizeof(buf)) {  // Name, ' ', '=', 32 digits
+      out.write((const uint8_t*)buf, n);
+      n = 0;
+    }
+    if (n) buf[n++] = ' ';
+    memcpy(buf + n, f.name, f.name_len);
+    n += f.name_len;
+    buf[n++] = '=';
+    uint32_t bits = f.width == 32 ? value : (value >> f.shift) & ((1u << f.width) - 1);
+    n += debug_conv_bin(buf + n, bits, f.width);
+  }
+  buf[n++] = '\n';
+  out.write((const uint8_t*)buf, n);
+}
+
+#endif  // DEBUG_BITS_H
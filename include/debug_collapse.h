@@ -0,0 +1,189 @@
+/**
+ * @file debug_collapse.h
+ * @brief Collapse consecutive identical log lines (DEBUG_COLLAPSE=1)
+ *
+ * Line-oriented macros (debugfln, debug_if, debug_tag, the level macros and
+ * everything built on them) identify a record by its format (string address,
+ * or token in DEBUG_TOKENIZE mode) plus the argument values. A
+ * record identical to the previous one is counted instead of formatted;
+ * the count is printed as "[last message repeated N times]" when a
+ * different record arrives, or every DEBUG_COLLAPSE_TIMEOUT_MS while the
+ * repetition lasts. debug_collapse_poll() in loop() flushes a pending count
+ * once the timeout has passed even if nothing else is logged.
+ *
+ * String arguments are compared by content, everything else by value. Any
+ * other output through the debug macros ends a run (debug_collapse_break),
+ * so a repeat separated by an unrelated line is printed again and the
+ * count lands before that line.
+ */
+
+#ifndef DEBUG_COLLAPSE_H
+#define DEBUG_COLLAPSE_H
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "debug_ring.h"
+
+#ifndef DEBUG_COLLAPSE_TIMEOUT_MS
+#define DEBUG_COLLAPSE_TIMEOUT_MS 5000  // Longest a repeat count is held back
+#endif
+
+#ifndef DEBUG_COLLAPSE_KEY_BYTES
+#define DEBUG_COLLAPSE_KEY_BYTES 32  // Argument bytes compared verbatim
+#endif
+
+// ============================================================================
+// RECORD KEY - FNV-1a over argument values, plus the leading bytes verbatim
+// ============================================================================
+
+/**
+ * Two records are identical when format ID, argument length, hash and the
+ * first DEBUG_COLLAPSE_KEY_BYTES argument bytes all match; a hash collision
+ * alone can no longer swallow a different line.
+ */
+struct DebugCollapseKey {
+  uint32_t hash;
+  uint32_t len;  // Argument bytes seen, including those past bytes[]
+  uint8_t bytes[DEBUG_COLLAPSE_KEY_BYTES];
+
+  DebugCollapseKey() : hash(2166136261u), len(0) {}
+
+  void add(uint8_t b) {
+    hash = (hash ^ b) * 16777619u;
+    if (len < DEBUG_COLLAPSE_KEY_BYTES) bytes[len] = b;
+    len++;
+  }
+
+  void add(const void* data, size_t n) {
+    const uint8_t* p = (const uint8_t*)data;
+    while (n--) add(*p++);
+  }
+
+  bool operator==(const DebugCollapseKey& o) const {
+    return hash == o.hash && len == o.len &&
+           memcmp(bytes, o.bytes, len < DEBUG_COLLAPSE_KEY_BYTES ? len : DEBUG_COLLAPSE_KEY_BYTES) == 0;
+  }
+};
+
+inline void debug_collapse_arg(DebugCollapseKey& key, const char* s) {
+  if (!s) return key.add(&s, sizeof(s));
+  while (*s) key.add((uint8_t)*s++);
+  key.add((uint8_t)0);  // Terminator, so ("ab","c") != ("a","bc")
+}
+
+inline void debug_collapse_arg(DebugCollapseKey& key, char* s) {
+  debug_collapse_arg(key, (const char*)s);
+}
+
+template <typename T>
+inline void debug_collapse_arg(DebugCollapseKey& key, const T& value) {
+  key.add(&value, sizeof(value));
+}
+
+inline void debug_collapse_key(DebugCollapseKey&) {}
+
+template <typename T, typename... Rest>
+inline void debug_collapse_key(DebugCollapseKey& key, const T& first, const Rest&... rest) {
+  debug_collapse_arg(key, first);
+  debug_collapse_key(key, rest...);
+}
+
+// ============================================================================
+// REPEAT TRACKING
+// ============================================================================
+
+struct DebugCollapseState {
+  uint32_t id;
+  DebugCollapseKey key;
+  uint32_t repeats;  // Identical records swallowed since since_ms
+  uint32_t since_ms;
+  bool valid;
+  DebugSpinLock lock;
+};
+
+inline DebugCollapseState& debug_collapse_state() {
+  static DebugCollapseState state;
+  return state;
+}
+
+/**
+ * Returns true if the record (id, key) should be emitted. Prints the
+ * pending repeat count first when the record differs from the previous one.
+ */
+template <typename Out>
+inline bool debug_collapse_check(Out& out, uint32_t id, const DebugCollapseKey& key) {
+  DebugCollapseState& s = debug_collapse_state();
+  uint32_t now = (uint32_t)millis();
+  uint32_t repeats = 0;
+  bool emit;
+
+  s.lock.lock();
+  if (s.valid && id == s.id && key == s.key) {
+    emit = false;
+    s.repeats++;
+    if (now - s.since_ms >= DEBUG_COLLAPSE_TIMEOUT_MS) {
+      repeats = s.repeats;
+      s.repeats = 0;
+      s.since_ms = now;
+    }
+  } else {
+    emit = true;
+    repeats = s.repeats;
+    s.id = id;
+    s.key = key;
+    s.repeats = 0;
+    s.since_ms = now;
+    s.valid = true;
+  }
+  s.lock.unlock();
+
+  if (repeats) out.printf("[last message repeated %lu times]\n", (unsigned long)repeats);
+  return emit;
+}
+
+template <typename Out, typename... Args>
+inline bool debug_collapse_pass(Out& out, uint32_t id, const Args&... args) {
+  DebugCollapseKey key;
+  debug_collapse_key(key, args...);
+  return debug_collapse_check(out, id, key);
+}
+
+/**
+ * Output that bypasses collapse (debug, debugf, debug_val, debug_array ...)
+ * ends the current run: the pending count is printed ahead of it and the
+ * next line is emitted even if it repeats the one before
+ */
+template <typename Out>
+inline void debug_collapse_break(Out& out) {
+  DebugCollapseState& s = debug_collapse_state();
+  uint32_t repeats;
+  s.lock.lock();
+  repeats = s.repeats;
+  s.repeats = 0;
+  s.valid = false;
+  s.lock.unlock();
+  if (repeats) out.printf("[last message repeated %lu times]\n", (unsigned long)repeats);
+}
+
+/**
+ * Print a pending repeat count that is at least min_age_ms old
+ * (0 flushes unconditionally, e.g. before deep sleep)
+ */
+template <typename Out>
+inline void debug_collapse_flush(Out& out, uint32_t min_age_ms) {
+  DebugCollapseState& s = debug_collapse_state();
+  uint32_t now = (uint32_t)millis();
+  uint32_t repeats = 0;
+  s.lock.lock();
+  if (s.repeats && now - s.since_ms >= min_age_ms) {
+    repeats = s.repeats;
+    s.repeats = 0;
+    s.since_ms = now;
+  }
+  s.lock.unlock();
+  if (repeats) out.printf("[last message repeated %lu times]\n", (unsigned long)repeats);
+}
+
+#endif  // DEBUG_COLLAPSE_H
@@ -0,0 +1,330 @@
+/**
+ * @file debug_conv.h
+ * @brief Number-to-text kernels used by debug_val, debug_hex, debug_bin
+ *        and the template formatter (debug_formatter.h)
+ *
+ * - Decimal: two digits per division via a 200-byte digit-pair table
+ * - Hex: branchless nibble-to-ASCII (no table, no compare)
+ * - Binary: a byte at a time, two 4-character lookups from a 16-entry table
+ * - Float: single-precision only (no double arithmetic, which the ESP32
+ *   FPU cannot do in hardware), bounded to DEBUG_CONV_FLOAT_DIGITS decimals
+ *
+ * All kernels write into a caller buffer and never allocate.
+ */
+
+#ifndef DEBUG_CONV_H
+#define DEBUG_CONV_H
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+#ifndef DEBUG_CONV_FLOAT_DIGITS
+#define DEBUG_CONV_FLOAT_DIGITS 7  // Max decimals; float carries ~7 significant digits
+#endif
+
+#ifndef DEBUG_BIN_GROUP
+#define DEBUG_BIN_GROUP 4  // debug_binw() digits per group; 0 disables grouping
+#endif
+
+#ifndef DEBUG_BIN_SEPARATOR
+#define DEBUG_BIN_SEPARATOR ' '
+#endif
+
+#ifndef DEBUG_VAL_DECIMALS
+#define DEBUG_VAL_DECIMALS 2  // debug_val() float decimals, as Serial.print(float)
+#endif
+
+// ============================================================================
+// DECIMAL
+// ============================================================================
+
+static const char debug_conv_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/**
+ * Write v in decimal ending just before end; returns the first digit
+ */
+inline char* debug_conv_u32(char* end, uint32_t v) {
+  while (v >= 100) {
+    uint32_t r = v % 100;
+    v /= 100;
+    end -= 2;
+    memcpy(end, debug_conv_pairs + r * 2, 2);
+  }
+  if (v >= 10) {
+    end -= 2;
+    memcpy(end, debug_conv_pairs + v * 2, 2);
+  } else {
+    *--end = (char)('0' + v);
+  }
+  return end;
+}
+
+/**
+ * 64-bit variant: 64-bit division only while the value exceeds 32 bits
+ */
+inline char* debug_conv_u64(char* end, uint64_t v) {
+  while (v > 0xFFFFFFFFu) {
+    uint32_t r = (uint32_t)(v % 100);
+    v /= 100;
+    end -= 2;
+    memcpy(end, debug_conv_pairs + r * 2, 2);
+  }
+  return debug_conv_u32(end, (uint32_t)v);
+}
+
+/**
+ * Signed decimal into out (at least 12 bytes); returns the length
+ */
+inline size_t debug_conv_i32(char* out, int32_t v) {
+  char buf[12];
+  char* end = buf + sizeof(buf);
+  char* p = debug_conv_u32(end, v < 0 ? 0u - (uint32_t)v : (uint32_t)v);
+  if (v < 0) *--p = '-';
+  size_t n = (size_t)(end - p);
+  memcpy(out, p, n);
+  return n;
+}
+
+// ============================================================================
+// HEX
+// ============================================================================
+
+/**
+ * 0..15 to '0'..'9','A'..'F' without a branch or table:
+ * (9 - n) is negative only for n >= 10, so the shift yields the 7-step
+ * gap between '9' and 'A' exactly then
+ */
+inline char debug_conv_nibble(uint32_t n) {
+  return (char)('0' + n + (((9 - (int32_t)n) >> 31) & 7));
+}
+
+/**
+ * Upper-case hex of v using at least min_digits digits (1-8) into out;
+ * returns the length
+ */
+inline size_t debug_conv_hex(char* out, uint32_t v, int min_digits) {
+  int digits = 8;
+  while (digits > min_digits && !(v >> ((digits - 1) * 4))) digits--;
+  for (int i = 0; i < digits; i++) {
+    out[i] = debug_conv_nibble((v >> ((digits - 1 - i) * 4)) & 0xF);
+  }
+  return (size_t)digits;
+}
+
+// ============================================================================
+// BINARY
+// ============================================================================
+
+static const char debug_conv_bits4[16][4] = {
+    {'0', '0', '0', '0'}, {'0', '0', '0', '1'}, {'0', '0', '1', '0'}, {'0', '0', '1', '1'},
+    {'0', '1', '0', '0'}, {'0', '1', '0', '1'}, {'0', '1', '1', '0'}, {'0', '1', '1', '1'},
+    {'1', '0', '0', '0'}, {'1', '0', '0', '1'}, {'1', '0', '1', '0'}, {'1', '0', '1', '1'},
+    {'1', '1', '0', '0'}, {'1', '1', '0', '1'}, {'1', '1', '1', '0'}, {'1', '1', '1', '1'}};
+
+/**
+ * Eight characters for one byte, most significant bit first
+ */
+inline void debug_conv_byte_bits(char* out, uint8_t b) {
+  memcpy(out, debug_conv_bits4[b >> 4], 4);
+  memcpy(out + 4, debug_conv_bits4[b & 0xF], 4);
+}
+
+/**
+ * The low `bits` bits of v (1-32), most significant first, into out;
+ * returns bits. bits == 0 means "no leading zeros" (at least one digit);
+ * widths above 32 are clamped to 32, so out never needs more than 32 bytes.
+ */
+inline size_t debug_conv_bin(char* out, uint32_t v, int bits) {
+  if (bits <= 0) {
+    bits = 1;
+    while (bits < 32 && (v >> bits)) bits++;
+  } else if (bits > 32) {
+    bits = 32;
+  }
+  char tmp[32];
+  debug_conv_byte_bits(tmp, (uint8_t)(v >> 24));
+  debug_conv_byte_bits(tmp + 8, (uint8_t)(v >> 16));
+  debug_conv_byte_bits(tmp + 16, (uint8_t)(v >> 8));
+  debug_conv_byte_bits(tmp + 24, (uint8_t)v);
+  memcpy(out, tmp + 32 - bits, (size_t)bits);
+  return (size_t)bits;
+}
+
+/**
+ * Like debug_conv_bin with a separator every `group` bits counted from
+ * bit 0 (group 4: "1 0101 1100"); group 0 disables grouping. out holds
+ * at least 64 bytes. Groups are copied whole, not bit by bit.
+ */
+inline size_t debug_conv_bin_grouped(char* out, uint32_t v, int bits, int group, char sep) {
+  char tmp[32];
+  size_t len = debug_conv_bin(tmp, v, bits);
+  if (group <= 0 || (int)len <= group) {
+    memcpy(out, tmp, len);
+    return len;
+  }
+  size_t chunk = len % group ? len % group : (size_t)group;
+  size_t n = 0;
+  for (size_t i = 0; i < len; i += chunk, chunk = (size_t)group) {
+    if (i) out[n++] = sep;
+    memcpy(out + n, tmp + i, chunk);
+    n += chunk;
+  }
+  return n;
+}
+
+// ============================================================================
+// FLOAT - Single precision only
+// ============================================================================
+
+/**
+ * Fixed-point text for v with `decimals` fraction digits (clamped to
+ * DEBUG_CONV_FLOAT_DIGITS) into out (at least 24 bytes); returns the length.
+ * Uses only float and 32-bit integer arithmetic. Values beyond the 32-bit
+ * integer range print as d.ddde+NN.
+ */
+inline size_t debug_conv_float(char* out, float v, int decimals) {
+  static const float pow10[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f};
+  size_t n = 0;
+  if (v != v) {
+    memcpy(out, "nan", 3);
+    return 3;
+  }
+  if (v < 0 || (v == 0 && 1 / v < 0)) {
+    out[n++] = '-';
+    v = -v;
+  }
+  if (v > 3.4028235e38f) {
+    memcpy(out + n, "inf", 3);
+    return n + 3;
+  }
+  if (decimals < 0) decimals = 0;
+  if (decimals > DEBUG_CONV_FLOAT_DIGITS) decimals = DEBUG_CONV_FLOAT_DIGITS;
+
+  int exp10 = 0;
+  if (v >= 4294967040.0f) {  // Largest float below 2^32
+    while (v >= 10.0f) {
+      v /= 10.0f;
+      exp10++;
+    }
+  }
+
+  uint32_t whole = (uint32_t)v;
+  uint32_t scale = (uint32_t)pow10[decimals];
+  float scaled = (v - (float)whole) * pow10[decimals];
+  uint32_t frac = (uint32_t)scaled;
+  if (scaled - (float)frac >= 0.5f) frac++;
+  if (frac >= scale) {
+    frac -= scale;
+    whole++;
+    if (whole == 10 && exp10) {  // 9.99..e+N rounded up: renormalize to 1.00..e+(N+1)
+      whole = 1;
+      exp10++;
+    }
+  }
+
+  char buf[12];
+  char* end = buf + sizeof(buf);
+  char* p = debug_conv_u32(end, whole);
+  memcpy(out + n, p, (size_t)(end - p));
+  n += (size_t)(end - p);
+  if (decimals) {
+    out[n++] = '.';
+    for (int i = decimals - 1; i >= 0; i--) {
+      out[n + i] = (char)('0' + frac % 10);
+      frac /= 10;
+    }
+    n += decimals;
+  }
+  if (exp10) {
+    out[n++] = 'e';
+    out[n++] = '+';
+    memcpy(out + n, debug_conv_pairs + exp10 * 2, 2);
+    n += 2;
+  }
+  return n;
+}
+
+// ============================================================================
+// MACRO BACKENDS - debug_hex, debug_bin, debug_val
+// ============================================================================
+
+template <typename Out>
+inline void debug_conv_print_hex(Out& out, uint32_t v) {
+  char buf[8];
+  out.write((const uint8_t*)buf, debug_conv_hex(buf, v, 2));
+}
+
+template <typename Out>
+inline void debug_conv_print_bin(Out& out, uint32_t v) {
+  char buf[32];
+  out.write((const uint8_t*)buf, debug_conv_bin(buf, v, 0));
+}
+
+/** Fixed width (1-32 bits, wider clamps to 32, 0 = no leading zeros), grouped per DEBUG_BIN_GROUP */
+template <typename Out>
+inline void debug_conv_print_binw(Out& out, uint32_t v, int bits) {
+  char buf[64];
+  out.write((const uint8_t*)buf, debug_conv_bin_grouped(buf, v, bits, DEBUG_BIN_GROUP, DEBUG_BIN_SEPARATOR));
+}
+
+/** Value text for debug_val(); out holds at least 24 bytes */
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, size_t>::type
+debug_conv_value(char* out, T v) {
+  char buf[24];
+  char* end = buf + sizeof(buf);
+  char* p = debug_conv_u64(end, v < 0 ? 0ull - (unsigned long long)v : (unsigned long long)v);
+  if (v < 0) *--p = '-';
+  memcpy(out, p, (size_t)(end - p));
+  return (size_t)(end - p);
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value, size_t>::type
+debug_conv_value(char* out, T v) {
+  char buf[24];
+  char* end = buf + sizeof(buf);
+  char* p = debug_conv_u64(end, v);
+  memcpy(out, p, (size_t)(end - p));
+  return (size_t)(end - p);
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_enum<T>::value, size_t>::type debug_conv_value(char* out, T v) {
+  return debug_conv_value(out, (long long)v);
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_floating_point<T>::value, size_t>::type
+debug_conv_value(char* out, T v) {
+  return debug_conv_float(out, (float)v, DEBUG_VAL_DECIMALS);
+}
+
+/**
+ * Print "name=value\n" with a single write when it fits. Integers print
+ * exactly (64-bit included), floats with DEBUG_VAL_DECIMALS decimals.
+ */
+template <typename Out, typename T>
+inline void debug_conv_print_val(Out& out, const char* name, T v) {
+  char buf[64];
+  size_t name_len = strlen(name);
+  size_t n = 0;
+  if (name_len > sizeof(buf) - 26) {  // Room for '=', 24-byte value, '\n'
+    out.write((const uint8_t*)name, name_len);
+  } else {
+    memcpy(buf, name, name_len);
+    n = name_len;
+  }
+  buf[n++] = '=';
+  n += debug_conv_value(buf + n, v);
+  buf[n++] = '\n';
+  out.write((const uint8_t*)buf, n);
+}
+
+#endif  // DEBUG_CONV_H
@@ -0,0 +1,409 @@
+/**
+ * @file debug_crashlog.h
+ * @brief Crash log in RTC slow memory that survives resets (DEBUG_CRASHLOG=1)
+ *
+ * debugf, debugfln, debug_if, debug_tag, debug_assert and the level macros
+ * also append a binary record (format pointer + raw arguments, encoded as
+ * in debug_deferred.h, nothing formatted) to a small circular region in
+ * RTC_NOINIT memory. That memory keeps its contents across panics,
+ * watchdog and software resets, so debug_crashlog_begin() in setup() can
+ * print the last lines before the reset even when no Serial monitor was
+ * attached at the time.
+ *
+ * Region layout:
+ *   header : magic, version/size, firmware image ID, CRC-32 of the above
+ *   data   : records, 4-byte aligned, written circularly
+ *   record : [0xC5][flags][u16 payload len][u32 seq][u32 ms][u32 CRC-32]
+ *            [format pointer][tagged args ...]
+ *
+ * Boot validation: a bad header (power-on garbage, other layout) resets the
+ * region. Records are found by scanning for a mark with a matching CRC, so
+ * a record torn by a reset mid-write, or the remains of an overwritten one,
+ * are skipped rather than ending the dump. Records print oldest first, by
+ * sequence number. Format pointers are only followed when the image ID
+ * matches the running firmware; records from another build are hex-dumped.
+ *
+ * Not available with DEBUG_TOKENIZE=1 (format literals are not in flash).
+ */
+
+#ifndef DEBUG_CRASHLOG_H
+#define DEBUG_CRASHLOG_H
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "debug_crc.h"
+#include "debug_deferred.h"
+#include "debug_hexdump.h"
+#include "debug_ring.h"
+
+#if defined(ESP_PLATFORM)
+#include <esp_attr.h>
+#include <esp_system.h>
+#if __has_include(<esp_app_desc.h>)
+#include <esp_app_desc.h>
+#define DEBUG_CRASHLOG_APP_DESC() esp_app_get_description()
+#else
+#include <esp_ota_ops.h>
+#define DEBUG_CRASHLOG_APP_DESC() esp_ota_get_app_description()
+#endif
+#define DEBUG_CRASHLOG_ATTR RTC_NOINIT_ATTR
+#else
+#define DEBUG_CRASHLOG_ATTR
+#endif
+
+#ifndef DEBUG_CRASHLOG_SIZE
+#define DEBUG_CRASHLOG_SIZE 2048  // Record bytes in RTC slow memory (8 KB total on ESP32)
+#endif
+
+#ifndef DEBUG_CRASHLOG_RECORD_MAX
+#define DEBUG_CRASHLOG_RECORD_MAX 64  // Max payload bytes per record (args beyond are dropped)
+#endif
+
+#ifndef DEBUG_CRASHLOG_KEEP
+#define DEBUG_CRASHLOG_KEEP 0  // 1: debug_crashlog_begin() appends after the dumped records
+#endif
+
+#define DEBUG_CRASHLOG_MAGIC 0x474C5243u  // "CRLG"
+#define DEBUG_CRASHLOG_VERSION 1
+#define DEBUG_CRASHLOG_MARK 0xC5
+#define DEBUG_CRASHLOG_RECORD_HEADER 16
+
+static_assert(DEBUG_CRASHLOG_SIZE % 4 == 0 && DEBUG_CRASHLOG_SIZE < (1 << 24),
+              "DEBUG_CRASHLOG_SIZE must be a multiple of 4 below 16 MB");
+static_assert(DEBUG_CRASHLOG_RECORD_MAX <= 0xFFFF, "DEBUG_CRASHLOG_RECORD_MAX must fit in 16 bits");
+
+// ============================================================================
+// REGION - Lives in RTC_NOINIT memory on the ESP32
+// ============================================================================
+
+struct DebugCrashHeader {
+  uint32_t magic;
+  uint32_t layout;  // Version << 24 | data size
+  uint32_t image;   // Firmware ID: format pointers are only valid in the same build
+  uint32_t crc;     // CRC-32 of the fields above
+};
+
+struct DebugCrashRegion {
+  DebugCrashHeader header;
+  uint32_t data[DEBUG_CRASHLOG_SIZE / 4];  // uint32_t for alignment
+};
+
+inline DebugCrashRegion& debug_crashlog_region() {
+  static DebugCrashRegion region DEBUG_CRASHLOG_ATTR;
+  return region;
+}
+
+/** Write position and sequence; RAM only, rebuilt from the region at boot */
+struct DebugCrashState {
+  uint32_t head;
+  uint32_t seq;
+  bool ready;  // Records are ignored until debug_crashlog_begin()
+  DebugSpinLock lock;
+};
+
+inline DebugCrashState& debug_crashlog_state() {
+  static DebugCrashState state;
+  return state;
+}
+
+inline uint32_t debug_crashlog_image() {
+#if defined(ESP_PLATFORM)
+  const uint8_t* sha = DEBUG_CRASHLOG_APP_DESC()->app_elf_sha256;
+  return (uint32_t)sha[0] | (uint32_t)sha[1] << 8 | (uint32_t)sha[2] << 16 | (uint32_t)sha[3] << 24;
+#else
+  return (uint32_t)(uintptr_t)&debug_crashlog_image;
+#endif
+}
+
+inline uint32_t debug_crashlog_header_crc(const DebugCrashHeader& h) {
+  return debug_crc32(0, &h, offsetof(DebugCrashHeader, crc));
+}
+
+// ============================================================================
+// RECORDS
+// ============================================================================
+
+struct DebugCrashRecord {
+  uint8_t flags;  // Bit 0: line macro (newline implied)
+  uint16_t len;   // Payload bytes
+  uint32_t seq;
+  uint32_t ms;
+  const uint8_t* payload;
+  uint32_t size;  // Header + payload, rounded up to 4
+};
+
+/**
+ * Parse the record at byte offset pos; false if there is no intact record
+ */
+inline bool debug_crashlog_parse(const DebugCrashRegion& region, uint32_t pos, DebugCrashRecord& r) {
+  const uint8_t* data = (const uint8_t*)region.data;
+  if (pos + DEBUG_CRASHLOG_RECORD_HEADER > DEBUG_CRASHLOG_SIZE || data[pos] != DEBUG_CRASHLOG_MARK) {
+    return false;
+  }
+  const uint8_t* p = data + pos;
+  r.flags = p[1];
+  memcpy(&r.len, p + 2, 2);
+  memcpy(&r.seq, p + 4, 4);
+  memcpy(&r.ms, p + 8, 4);
+  r.size = (DEBUG_CRASHLOG_RECORD_HEADER + r.len + 3u) & ~3u;
+  if (r.len < sizeof(const char*) || r.len > DEBUG_CRASHLOG_RECORD_MAX || pos + r.size > DEBUG_CRASHLOG_SIZE) {
+    return false;
+  }
+  uint32_t crc;
+  memcpy(&crc, p + 12, 4);
+  r.payload = p + DEBUG_CRASHLOG_RECORD_HEADER;
+  return debug_crc32(debug_crc32(0, p, 12), r.payload, r.len) == crc;
+}
+
+/**
+ * Append an encoded record (header bytes 0-3 and payload filled in by the
+ * caller; seq, ms and CRC are set here)
+ */
+inline void debug_crashlog_commit(uint8_t* rec, uint16_t len) {
+  DebugCrashState& st = debug_crashlog_state();
+  uint8_t* data = (uint8_t*)debug_crashlog_region().data;
+  uint32_t size = (DEBUG_CRASHLOG_RECORD_HEADER + len + 3u) & ~3u;
+  uint32_t ms = (uint32_t)millis();
+  memcpy(rec + 8, &ms, 4);
+
+  st.lock.lock();
+  if (!st.ready) {
+    st.lock.unlock();
+    return;
+  }
+  if (st.head + size > DEBUG_CRASHLOG_SIZE) {  // No record straddles the end
+    memset(data + st.head, 0, DEBUG_CRASHLOG_SIZE - st.head);
+    st.head = 0;
+  }
+  uint32_t seq = st.seq++;
+  memcpy(rec + 4, &seq, 4);
+  uint32_t crc = debug_crc32(debug_crc32(0, rec, 12), rec + DEBUG_CRASHLOG_RECORD_HEADER, len);
+  memcpy(rec + 12, &crc, 4);
+  memcpy(data + st.head, rec, DEBUG_CRASHLOG_RECORD_HEADER + len);
+  st.head += size;
+  st.lock.unlock();
+}
+
+/**
+ * Mirror one log call: format pointer + raw arguments, no formatting
+ */
+template <typename... Args>
+inline void debug_crashlog_log(bool line, const char* fmt, Args... args) {
+  if (!debug_crashlog_state().ready) return;
+  uint8_t rec[DEBUG_CRASHLOG_RECORD_HEADER + DEBUG_CRASHLOG_RECORD_MAX];
+  DebugEncoder e(rec + DEBUG_CRASHLOG_RECORD_HEADER, rec + sizeof(rec));
+  e.put(&fmt, sizeof(fmt));
+  debug_encode_args(e, args...);
+  uint16_t len = (uint16_t)(e.pos - (rec + DEBUG_CRASHLOG_RECORD_HEADER));
+  rec[0] = DEBUG_CRASHLOG_MARK;
+  rec[1] = line ? 1 : 0;
+  memcpy(rec + 2, &len, 2);
+  debug_crashlog_commit(rec, len);
+}
+
+// ============================================================================
+// BOOT DUMP
+// ============================================================================
+
+/**
+ * Render a record's format with its stored arguments into line (one
+ * snprintf per conversion); returns the length
+ */
+inline size_t debug_crashlog_render(const char* fmt, const uint8_t* arg, const uint8_t* end, char* line,
+                                    size_t max) {
+  size_t n = 0;
+  while (*fmt && n + 1 < max) {
+    if (*fmt != '%' || fmt[1] == '%') {
+      line[n++] = *fmt;
+      fmt += *fmt == '%' ? 2 : 1;
+      continue;
+    }
+    char spec[24];  // The spec without length modifiers, '*' resolved
+    size_t s = 0;
+    spec[s++] = *fmt++;
+    while (*fmt && !strchr("diouxXcsfFeEgGaAp", *fmt)) {
+      if (*fmt == '*' && arg + 5 <= end && *arg == DEBUG_ARG_I32 && s + 16 < sizeof(spec)) {
+        int32_t v;
+        memcpy(&v, arg + 1, 4);
+        arg += 5;
+        s += (size_t)snprintf(spec + s, 12, "%ld", (long)v);
+      } else if (!strchr("hlLzjt*", *fmt) && s + 5 < sizeof(spec)) {
+        spec[s++] = *fmt;
+      }
+      fmt++;
+    }
+    char conv = *fmt ? *fmt++ : 'd';
+    bool is_int = strchr("diouxXcp", conv) != NULL;
+    bool is_float = strchr("fFeEgGaA", conv) != NULL;
+    if (conv == 'p') {
+      if (n + 3 < max) {
+        line[n++] = '0';
+        line[n++] = 'x';
+      }
+      conv = 'x';
+    }
+    int w;
+    if (arg + 5 <= end && *arg == DEBUG_ARG_I32 && is_int) {
+      int32_t v;
+      memcpy(&v, arg + 1, 4);
+      arg += 5;
+      spec[s++] = conv;
+      spec[s] = 0;
+      w = snprintf(line + n, max - n, spec, (int)v);
+    } else if (arg + 9 <= end && *arg == DEBUG_ARG_I64 && is_int) {
+      long long v;
+      memcpy(&v, arg + 1, 8);
+      arg += 9;
+      spec[s++] = 'l';
+      spec[s++] = 'l';
+      spec[s++] = conv;
+      spec[s] = 0;
+      w = snprintf(line + n, max - n, spec, v);
+    } else if (arg + 5 <= end && *arg == DEBUG_ARG_F32 && is_float) {
+      float v;
+      memcpy(&v, arg + 1, 4);
+      arg += 5;
+      spec[s++] = conv;
+      spec[s] = 0;
+      w = snprintf(line + n, max - n, spec, (double)v);
+    } else if (arg + 9 <= end && *arg == DEBUG_ARG_F64 && is_float) {
+      double v;
+      memcpy(&v, arg + 1, 8);
+      arg += 9;
+      spec[s++] = conv;
+      spec[s] = 0;
+      w = snprintf(line + n, max - n, spec, v);
+    } else if (arg + 2 <= end && *arg == DEBUG_ARG_STR && conv == 's' && arg + 2 + arg[1] <= end) {
+      char str[256];
+      memcpy(str, arg + 2, arg[1]);
+      str[arg[1]] = 0;
+      arg += 2 + arg[1];
+      spec[s++] = 's';
+      spec[s] = 0;
+      w = snprintf(line + n, max - n, spec, str);
+    } else {
+      arg = end;  // Missing or mismatched: stop consuming arguments
+      w = snprintf(line + n, max - n, "<?>");
+    }
+    if (w > 0) n += (size_t)w < max - n ? (size_t)w : max - n - 1;
+  }
+  return n;
+}
+
+template <typename Out>
+inline void debug_crashlog_print(Out& out, const DebugCrashRecord& r, bool same_image) {
+  char line[192];
+  size_t n = (size_t)snprintf(line, sizeof(line), "[CRASHLOG #%lu @%lu] ", (unsigned long)r.seq,
+                              (unsigned long)r.ms);
+  const char* fmt;
+  memcpy(&fmt, r.payload, sizeof(fmt));
+  if (!same_image) {
+    n += (size_t)snprintf(line + n, sizeof(line) - n, "format@%p (other firmware)\n", (const void*)fmt);
+    out.write((const uint8_t*)line, n);
+    debug_hexdump(out, r.payload + sizeof(fmt), r.len - sizeof(fmt));
+    return;
+  }
+  n += debug_crashlog_render(fmt, r.payload + sizeof(fmt), r.payload + r.len, line + n, sizeof(line) - n - 1);
+  if (line[n - 1] != '\n') line[n++] = '\n';
+  out.write((const uint8_t*)line, n);
+}
+
+/**
+ * Reset the region (header, empty data) and start recording at seq
+ */
+inline void debug_crashlog_reset(uint32_t seq) {
+  DebugCrashRegion& region = debug_crashlog_region();
+  DebugCrashState& st = debug_crashlog_state();
+  st.lock.lock();
+  memset(region.data, 0, sizeof(region.data));
+  region.header.magic = DEBUG_CRASHLOG_MAGIC;
+  region.header.layout = (uint32_t)DEBUG_CRASHLOG_VERSION << 24 | DEBUG_CRASHLOG_SIZE;
+  region.header.image = debug_crashlog_image();
+  region.header.crc = debug_crashlog_header_crc(region.header);
+  st.head = 0;
+  st.seq = seq;
+  st.ready = true;
+  st.lock.unlock();
+}
+
+/**
+ * Call once early in setup(): validates the region, prints the records
+ * left by the previous boot to out (oldest first) and starts recording.
+ * keep = false clears the dumped records; keep = true appends after them.
+ * Returns the number of records printed.
+ */
+template <typename Out>
+inline uint32_t debug_crashlog_dump(Out& out, bool keep) {
+  DebugCrashRegion& region = debug_crashlog_region();
+  DebugCrashState& st = debug_crashlog_state();
+  st.ready = false;
+
+  const DebugCrashHeader& h = region.header;
+  if (h.magic != DEBUG_CRASHLOG_MAGIC || h.crc != debug_crashlog_header_crc(h) ||
+      h.layout != ((uint32_t)DEBUG_CRASHLOG_VERSION << 24 | DEBUG_CRASHLOG_SIZE)) {
+    debug_crashlog_reset(0);  // Power-on or different layout
+    return 0;
+  }
+
+  // Pass 1: find the oldest and newest intact records
+  DebugCrashRecord r;
+  uint32_t count = 0, oldest_pos = 0, oldest_seq = 0, newest_seq = 0, newest_end = 0;
+  for (uint32_t pos = 0; pos < DEBUG_CRASHLOG_SIZE;) {
+    if (!debug_crashlog_parse(region, pos, r)) {
+      pos += 4;  // Resync on the next aligned word
+      continue;
+    }
+    if (!count || (int32_t)(r.seq - oldest_seq) < 0) {
+      oldest_seq = r.seq;
+      oldest_pos = pos;
+    }
+    if (!count || (int32_t)(r.seq - newest_seq) > 0) {
+      newest_seq = r.seq;
+      newest_end = pos + r.size;
+    }
+    count++;
+    pos += r.size;
+  }
+
+  if (count) {
+    bool same_image = h.image == debug_crashlog_image();
+    char line[96];
+    int n;
+#if defined(ESP_PLATFORM)
+    n = snprintf(line, sizeof(line), "[CRASHLOG] %lu records from previous boot (reset reason %d)\n",
+                 (unsigned long)count, (int)esp_reset_reason());
+#else
+    n = snprintf(line, sizeof(line), "[CRASHLOG] %lu records from previous boot\n", (unsigned long)count);
+#endif
+    out.write((const uint8_t*)line, (size_t)n);
+
+    // Pass 2: walk the ring once starting at the oldest record
+    for (uint32_t walked = 0, pos = oldest_pos; walked < DEBUG_CRASHLOG_SIZE;) {
+      if (debug_crashlog_parse(region, pos, r)) {
+        debug_crashlog_print(out, r, same_image);
+        walked += r.size;
+        pos += r.size;
+      } else {
+        walked += 4;
+        pos += 4;
+      }
+      if (pos >= DEBUG_CRASHLOG_SIZE) pos = 0;
+    }
+  }
+
+  if (keep && count && h.image == debug_crashlog_image()) {
+    st.lock.lock();
+    st.head = newest_end;
+    st.seq = newest_seq + 1;
+    st.ready = true;
+    st.lock.unlock();
+  } else {
+    debug_crashlog_reset(count ? newest_seq + 1 : 0);
+  }
+  return count;
+}
+
+#endif  // DEBUG_CRASHLOG_H
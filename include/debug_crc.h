@@ -0,0 +1,30 @@
+/**
+ * @file debug_crc.h
+ * @brief CRC-32 (IEEE, reflected) for the persistent logs
+ *
+ * Nibble-table variant: 64 bytes of table instead of 1 KB, two lookups
+ * per byte. Used by debug_crashlog.h and debug_flash.h.
+ */
+
+#ifndef DEBUG_CRC_H
+#define DEBUG_CRC_H
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+inline uint32_t debug_crc32(uint32_t crc, const void* data, size_t len) {
+  static const uint32_t table[16] = {
+      0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+      0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+  const uint8_t* p = (const uint8_t*)data;
+  crc = ~crc;
+  while (len--) {
+    crc ^= *p++;
+    crc = (crc >> 4) ^ table[crc & 0xF];
+    crc = (crc >> 4) ^ table[crc & 0xF];
+  }
+  return ~crc;
+}
+
+#endif  // DEBUG_CRC_H
@@ -0,0 +1,93 @@
+/**
+ * @file debug_datagram.h
+ * @brief Datagram format of network log streaming (debug_net.h), shared
+ *        with the host receiver (tools/debug_netrecv.cpp)
+ *
+ *   datagram : [u32 magic "DNET"][u32 boot][u32 seq][u32 dropped]
+ *              [record][record]...
+ *   record   : [u16 len][u32 device ms][len bytes of output]
+ *
+ * boot is random per device start, so the receiver can tell a reboot from
+ * loss. seq counts datagrams from 0 within one boot; a jump means lost
+ * datagrams. dropped is the running count of records (macro writes) the
+ * device discarded before sending (RAM ring full). Record bytes are whatever
+ * the macros wrote - text, or deferred/tokenized frames for debug_decode.
+ *
+ * Over TCP each datagram is preceded by its u16 length. All fields are
+ * little-endian.
+ */
+
+#ifndef DEBUG_DATAGRAM_H
+#define DEBUG_DATAGRAM_H
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define DEBUG_DGRAM_MAGIC 0x54454E44u  // "DNET" as little-endian bytes
+#define DEBUG_DGRAM_HEADER 16
+#define DEBUG_DGRAM_RECORD_HEADER 6
+
+struct DebugDgramHeader {
+  uint32_t boot;
+  uint32_t seq;
+  uint32_t dropped;
+};
+
+inline void debug_dgram_put_header(uint8_t* out, const DebugDgramHeader& h) {
+  uint32_t magic = DEBUG_DGRAM_MAGIC;
+  memcpy(out, &magic, 4);
+  memcpy(out + 4, &h.boot, 4);
+  memcpy(out + 8, &h.seq, 4);
+  memcpy(out + 12, &h.dropped, 4);
+}
+
+/**
+ * Append one record at out; returns its encoded size
+ */
+inline size_t debug_dgram_put_record(uint8_t* out, uint32_t ms, const uint8_t* data, size_t len) {
+  uint16_t l = (uint16_t)len;
+  memcpy(out, &l, 2);
+  memcpy(out + 2, &ms, 4);
+  memcpy(out + DEBUG_DGRAM_RECORD_HEADER, data, len);
+  return DEBUG_DGRAM_RECORD_HEADER + len;
+}
+
+/**
+ * Check magic and size and read the header; false for anything else
+ */
+inline bool debug_dgram_parse_header(const uint8_t* data, size_t len, DebugDgramHeader* h) {
+  uint32_t magic;
+  if (len < DEBUG_DGRAM_HEADER) return false;
+  memcpy(&magic, data, 4);
+  if (magic != DEBUG_DGRAM_MAGIC) return false;
+  memcpy(&h->boot, data + 4, 4);
+  memcpy(&h->seq, data + 8, 4);
+  memcpy(&h->dropped, data + 12, 4);
+  return true;
+}
+
+/**
+ * Call fn(ms, bytes, len) for each record of a datagram; false if the
+ * datagram is invalid or its last record is cut short
+ */
+template <typename Fn>
+inline bool debug_dgram_for_each(const uint8_t* data, size_t len, Fn fn) {
+  DebugDgramHeader h;
+  if (!debug_dgram_parse_header(data, len, &h)) return false;
+  size_t pos = DEBUG_DGRAM_HEADER;
+  while (pos + DEBUG_DGRAM_RECORD_HEADER <= len) {
+    uint16_t l;
+    uint32_t ms;
+    memcpy(&l, data + pos, 2);
+    memcpy(&ms, data + pos + 2, 4);
+    pos += DEBUG_DGRAM_RECORD_HEADER;
+    if (pos + l > len) return false;
+    fn(ms, data + pos, (size_t)l);
+    pos += l;
+  }
+  return pos == len;
+}
+
+#endif  // DEBUG_DATAGRAM_H
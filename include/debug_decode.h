@@ -0,0 +1,580 @@
+/**
+ * @file debug_decode.h
+ * @brief Host-side decoder for binary debug frames
+ *
+ * Counterpart of debug_deferred.h. Splits a captured serial stream into
+ * plain text and frames, resolves format strings from the firmware ELF
+ * and renders the arguments with the host's printf.
+ *
+ * Host only (uses std::string/std::vector); used by tools/debug_decode.cpp.
+ */
+
+#ifndef DEBUG_DECODE_H
+#define DEBUG_DECODE_H
+
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "debug_deferred.h"
+#include "debug_token.h"
+
+// ============================================================================
+// ELF STRING LOOKUP - Map a runtime address to the literal in the image
+// ============================================================================
+
+/**
+ * Loads an ELF file (32- or 64-bit, little-endian) and resolves addresses
+ * that fall inside any allocated PROGBITS section (.rodata, .flash.rodata).
+ */
+class DebugElfImage {
+ public:
+  bool load(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    data_.resize(size > 0 ? (size_t)size : 0);
+    bool ok = size > 0 && fread(&data_[0], 1, data_.size(), f) == data_.size();
+    fclose(f);
+    return ok && parse();
+  }
+
+  /** NUL-terminated string at addr, or NULL when addr is not in the image */
+  const char* lookup(uint64_t addr) const {
+    for (size_t i = 0; i < sections_.size(); i++) {
+      const Section& s = sections_[i];
+      if (addr >= s.addr && addr < s.addr + s.size) {
+        const char* p = (const char*)&data_[s.offset + (addr - s.addr)];
+        size_t max = s.size - (addr - s.addr);
+        return memchr(p, 0, max) ? p : NULL;
+      }
+    }
+    return NULL;
+  }
+
+  /** Call fn(name, bytes, size) for every section whose name starts with prefix */
+  template <typename Fn>
+  void for_each_section(const char* prefix, Fn fn) const {
+    size_t plen = strlen(prefix);
+    for (size_t i = 0; i < named_.size(); i++) {
+      if (named_[i].name.compare(0, plen, prefix) == 0) {
+        fn(named_[i].name, &data_[named_[i].offset], (size_t)named_[i].size);
+      }
+    }
+  }
+
+ private:
+  struct Section {
+    uint64_t addr;
+    uint64_t offset;
+    uint64_t size;
+  };
+  struct Named {
+    std::string name;
+    uint64_t offset;
+    uint64_t size;
+  };
+
+  template <typename T>
+  T read(size_t off) const {
+    T v;
+    memcpy(&v, &data_[off], sizeof(T));
+    return v;
+  }
+
+  /**
+   * Read the section table. Every header, the section-name string table
+   * and each name inside it are bounds-checked, so a truncated, stripped
+   * or malformed file is rejected (or its bad sections skipped) rather
+   * than read past the end.
+   */
+  bool parse() {
+    if (data_.size() < 52 || memcmp(&data_[0], "\x7f" "ELF", 4) != 0 || data_[5] != 1) return false;
+    bool is64 = data_[4] == 2;
+    if (is64 && data_.size() < 64) return false;
+    uint64_t shoff = is64 ? read<uint64_t>(0x28) : read<uint32_t>(0x20);
+    uint16_t shentsize = read<uint16_t>(is64 ? 0x3A : 0x2E);
+    uint16_t shnum = read<uint16_t>(is64 ? 0x3C : 0x30);
+    uint16_t shstrndx = read<uint16_t>(is64 ? 0x3E : 0x32);
+    if (shentsize < (is64 ? 64 : 40) || shstrndx >= shnum) return false;
+    if (shoff > data_.size() || (uint64_t)shnum * shentsize > data_.size() - shoff) return false;
+
+    size_t strhdr = (size_t)(shoff + (uint64_t)shstrndx * shentsize);
+    uint64_t strtab = is64 ? read<uint64_t>(strhdr + 24) : read<uint32_t>(strhdr + 16);
+    uint64_t strsize = is64 ? read<uint64_t>(strhdr + 32) : read<uint32_t>(strhdr + 20);
+    if (strtab > data_.size() || strsize > data_.size() - strtab) return false;
+
+    for (uint16_t i = 0; i < shnum; i++) {
+      size_t h = (size_t)(shoff + (uint64_t)i * shentsize);
+      uint32_t name = read<uint32_t>(h);
+      uint32_t type = read<uint32_t>(h + 4);
+      uint64_t flags = is64 ? read<uint64_t>(h + 8) : read<uint32_t>(h + 8);
+      uint64_t addr = is64 ? read<uint64_t>(h + 16) : read<uint32_t>(h + 12);
+      uint64_t offset = is64 ? read<uint64_t>(h + 24) : read<uint32_t>(h + 16);
+      uint64_t size = is64 ? read<uint64_t>(h + 32) : read<uint32_t>(h + 20);
+      if (type == 8 /* SHT_NOBITS */ || offset > data_.size() || size > data_.size() - offset) continue;
+      Named n;
+      if (name < strsize) {
+        const char* start = (const char*)&data_[strtab + name];
+        const void* nul = memchr(start, '\0', (size_t)(strsize - name));
+        if (nul) n.name.assign(start, (size_t)((const char*)nul - start));
+      }
+      n.offset = offset;
+      n.size = size;
+      named_.push_back(n);
+      if (type == 1 /* SHT_PROGBITS */ && (flags & 2 /* SHF_ALLOC */) && size) {
+        Section s = {addr, offset, size};
+        sections_.push_back(s);
+      }
+    }
+    return true;
+  }
+
+  std::vector<uint8_t> data_;
+  std::vector<Section> sections_;
+  std::vector<Named> named_;
+};
+
+// ============================================================================
+// ARGUMENT RENDERING - printf each conversion with the decoded value
+// ============================================================================
+
+/**
+ * One decoded argument
+ */
+struct DebugArgValue {
+  uint8_t tag;  // DebugArgTag, or 0 when the frame ran out of arguments
+  int64_t i;
+  double f;
+  std::string s;
+};
+
+/**
+ * Reads tagged arguments back out of a deferred frame payload.
+ * The tags carry the type, so the conversion hint is ignored.
+ */
+struct DebugArgReader {
+  const uint8_t* pos;
+  const uint8_t* end;
+
+  DebugArgValue next(char /*conv*/, bool /*wide*/) {
+    DebugArgValue v;
+    v.tag = 0;
+    v.i = 0;
+    v.f = 0;
+    if (pos >= end) return v;
+    uint8_t tag = *pos++;
+    size_t avail = (size_t)(end - pos);
+    switch (tag) {
+      case DEBUG_ARG_I32: {
+        if (avail < 4) break;
+        int32_t x;
+        memcpy(&x, pos, 4);
+        pos += 4;
+        v.i = x;
+        v.f = x;
+        v.tag = tag;
+        break;
+      }
+      case DEBUG_ARG_I64:
+        if (avail < 8) break;
+        memcpy(&v.i, pos, 8);
+        pos += 8;
+        v.f = (double)v.i;
+        v.tag = tag;
+        break;
+      case DEBUG_ARG_F32: {
+        if (avail < 4) break;
+        float x;
+        memcpy(&x, pos, 4);
+        pos += 4;
+        v.f = x;
+        v.i = (int64_t)x;
+        v.tag = tag;
+        break;
+      }
+      case DEBUG_ARG_F64:
+        if (avail < 8) break;
+        memcpy(&v.f, pos, 8);
+        pos += 8;
+        v.i = (int64_t)v.f;
+        v.tag = tag;
+        break;
+      case DEBUG_ARG_STR:
+        if (avail < 1 || avail - 1 < pos[0]) break;
+        v.s.assign((const char*)pos + 1, pos[0]);
+        pos += 1 + pos[0];
+        v.tag = tag;
+        break;
+      default:
+        break;
+    }
+    if (!v.tag) pos = end;  // Unknown or truncated - stop reading
+    return v;
+  }
+};
+
+/**
+ * Render fmt with arguments from reader, appending to out.
+ * Each conversion is passed to snprintf with its flags/width/precision
+ * preserved and the length modifier rewritten to match the decoded value.
+ * Reader provides DebugArgValue next(char conv, bool wide), where wide is
+ * true for 64-bit length modifiers (ll, j).
+ */
+template <typename Reader>
+inline void debug_render(const char* fmt, Reader& reader, std::string& out) {
+  char buf[512];
+  const char* p = fmt;
+  while (*p) {
+    if (*p != '%') {
+      out += *p++;
+      continue;
+    }
+    if (p[1] == '%') {
+      out += '%';
+      p += 2;
+      continue;
+    }
+
+    // Collect "%[flags][width][.precision]" and skip length modifiers
+    std::string spec = "%";
+    const char* q = p + 1;
+    while (*q && strchr("-+ #0", *q)) spec += *q++;
+    for (int part = 0; part < 2; part++) {
+      if (part == 1) {
+        if (*q != '.') break;
+        spec += *q++;
+      }
+      if (*q == '*') {
+        DebugArgValue w = reader.next('d', false);
+        spec += std::to_string((long long)w.i);
+        q++;
+      } else {
+        while (*q >= '0' && *q <= '9') spec += *q++;
+      }
+    }
+    bool wide = false;
+    for (; *q && strchr("hlLqjzt", *q); q++) {
+      if (*q == 'j' || *q == 'q' || (q[0] == 'l' && q[1] == 'l')) wide = true;
+    }
+    char conv = *q;
+    if (!conv) break;
+    p = q + 1;
+
+    DebugArgValue v = reader.next(conv, wide);
+    if (!v.tag) {
+      out += "<missing>";
+      continue;
+    }
+    switch (conv) {
+      case 'd':
+      case 'i':
+        snprintf(buf, sizeof(buf), (spec + "lld").c_str(), (long long)v.i);
+        break;
+      case 'u':
+      case 'o':
+      case 'x':
+      case 'X': {
+        // Reproduce the width the target used: 32-bit values stay 32-bit
+        unsigned long long u = v.tag == DEBUG_ARG_I32 ? (uint32_t)v.i : (uint64_t)v.i;
+        snprintf(buf, sizeof(buf), (spec + "ll" + conv).c_str(), u);
+        break;
+      }
+      case 'c':
+        snprintf(buf, sizeof(buf), (spec + "c").c_str(), (int)v.i);
+        break;
+      case 'p':
+        snprintf(buf, sizeof(buf), "0x%llx", (unsigned long long)(uint32_t)v.i);
+        break;
+      case 's':
+        snprintf(buf, sizeof(buf), (spec + "s").c_str(),
+                 v.tag == DEBUG_ARG_STR ? v.s.c_str() : "<?>");
+        break;
+      case 'f':
+      case 'F':
+      case 'e':
+      case 'E':
+      case 'g':
+      case 'G':
+      case 'a':
+      case 'A':
+        snprintf(buf, sizeof(buf), (spec + conv).c_str(), v.f);
+        break;
+      default:
+        snprintf(buf, sizeof(buf), "<%%%c?>", conv);
+        break;
+    }
+    out += buf;
+  }
+}
+
+/**
+ * Reads untagged token-frame arguments; the format conversion decides how
+ * many bytes each argument occupies (see debug_token.h).
+ */
+struct DebugTokenReader {
+  const uint8_t* pos;
+  const uint8_t* end;
+
+  DebugArgValue next(char conv, bool wide) {
+    DebugArgValue v;
+    v.tag = 0;
+    v.i = 0;
+    v.f = 0;
+    if (pos >= end) return v;
+    if (strchr("fFeEgGaA", conv)) {
+      float x;
+      if (end - pos < 4) return fail(v);
+      memcpy(&x, pos, 4);
+      pos += 4;
+      v.f = x;
+      v.tag = DEBUG_ARG_F32;
+    } else if (conv == 's') {
+      size_t len = *pos++;
+      if ((size_t)(end - pos) < len) return fail(v);
+      v.s.assign((const char*)pos, len);
+      pos += len;
+      v.tag = DEBUG_ARG_STR;
+    } else {
+      uint64_t raw = 0;
+      for (int shift = 0;; shift += 7) {
+        if (pos >= end || shift > 63) return fail(v);
+        uint8_t b = *pos++;
+        raw |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) break;
+      }
+      v.i = (int64_t)(raw >> 1) ^ -(int64_t)(raw & 1);  // zigzag
+      v.f = (double)v.i;
+      v.tag = wide ? DEBUG_ARG_I64 : DEBUG_ARG_I32;
+    }
+    return v;
+  }
+
+ private:
+  DebugArgValue& fail(DebugArgValue& v) {
+    pos = end;
+    v.tag = 0;
+    return v;
+  }
+};
+
+/**
+ * token -> format string map, built from the .log_tokens.* sections of an
+ * ELF or from a CSV database written by tools/debug_tokens.cpp
+ */
+class DebugTokenDatabase {
+ public:
+  struct Collision {
+    uint32_t token;
+    std::string kept;   // First string seen for the token
+    std::string other;  // Different string with the same hash
+  };
+
+  /**
+   * Add a literal under its FNV-1a token. Returns false, keeps the first
+   * string and records a collision when a different string already holds
+   * the token; such records cannot be told apart when decoding.
+   */
+  bool add(const std::string& str) { return insert(debug_token_hash(str.c_str()), str); }
+
+  /** Collect every literal stored in the ELF's token sections */
+  void load(const DebugElfImage& image) {
+    image.for_each_section(".log_tokens.", [this](const std::string&, const uint8_t* data,
+                                                  size_t size) {
+      size_t start = 0;
+      for (size_t i = 0; i < size; i++) {
+        if (data[i] == 0) {
+          if (i > start) add(std::string((const char*)data + start, i - start));
+          start = i + 1;
+        }
+      }
+    });
+  }
+
+  /**
+   * Load "token,string" lines; the string is C-escaped (\\, \n, \t, \r,
+   * \xNN) so it never contains a raw newline
+   */
+  bool load_csv(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+    char line[1024];
+    while (fgets(line, sizeof(line), f)) {
+      char* comma = strchr(line, ',');
+      if (!comma) continue;
+      std::string str;
+      for (const char* p = comma + 1; *p && *p != '\n'; p++) {
+        if (*p != '\\' || !p[1]) {
+          str += *p;
+          continue;
+        }
+        p++;
+        switch (*p) {
+          case 'n': str += '\n'; break;
+          case 't': str += '\t'; break;
+          case 'r': str += '\r'; break;
+          case 'x': str += (char)strtoul(std::string(p + 1, 2).c_str(), NULL, 16); p += 2; break;
+          default: str += *p; break;
+        }
+      }
+      insert((uint32_t)strtoul(line, NULL, 16), str);
+    }
+    fclose(f);
+    return true;
+  }
+
+  const char* lookup(uint32_t token) const {
+    std::map<uint32_t, std::string>::const_iterator it = strings_.find(token);
+    return it == strings_.end() ? NULL : it->second.c_str();
+  }
+
+  const std::map<uint32_t, std::string>& entries() const { return strings_; }
+  const std::vector<Collision>& collisions() const { return collisions_; }
+
+ private:
+  bool insert(uint32_t token, const std::string& str) {
+    std::pair<std::map<uint32_t, std::string>::iterator, bool> it =
+        strings_.insert(std::make_pair(token, str));
+    if (it.second || it.first->second == str) return true;
+    Collision c = {token, it.first->second, str};
+    collisions_.push_back(c);
+    return false;
+  }
+
+  std::map<uint32_t, std::string> strings_;
+  std::vector<Collision> collisions_;
+};
+
+/**
+ * Write str C-escaped for the CSV database
+ */
+inline std::string debug_token_escape(const std::string& str) {
+  std::string out;
+  char hex[8];
+  for (size_t i = 0; i < str.size(); i++) {
+    unsigned char c = (unsigned char)str[i];
+    switch (c) {
+      case '\\': out += "\\\\"; break;
+      case '\n': out += "\\n"; break;
+      case '\t': out += "\\t"; break;
+      case '\r': out += "\\r"; break;
+      default:
+        if (c < 0x20 || c == 0x7F) {
+          snprintf(hex, sizeof(hex), "\\x%02x", c);
+          out += hex;
+        } else {
+          out += (char)c;
+        }
+    }
+  }
+  return out;
+}
+
+// ============================================================================
+// STREAM SPLITTER - Separate plain text from binary frames
+// ============================================================================
+
+/**
+ * Feed captured bytes; text bytes are appended to the pending output and
+ * complete frames are handed to on_frame(kind, payload, len).
+ */
+class DebugFrameParser {
+ public:
+  DebugFrameParser() : state_(TEXT), kind_(0), len_(0) {}
+
+  template <typename OnText, typename OnFrame>
+  void feed(const uint8_t* data, size_t n, OnText on_text, OnFrame on_frame) {
+    for (size_t i = 0; i < n; i++) {
+      uint8_t b = data[i];
+      switch (state_) {
+        case TEXT:
+          if (b == DEBUG_FRAME_MARK) {
+            state_ = KIND;
+          } else {
+            on_text((char)b);
+          }
+          break;
+        case KIND:
+          kind_ = b;
+          state_ = LENGTH;
+          break;
+        case LENGTH:
+          len_ = b;
+          payload_.clear();
+          state_ = PAYLOAD;
+          if (len_ == 0) {
+            on_frame(kind_, payload_.data(), 0);
+            state_ = TEXT;
+          }
+          break;
+        case PAYLOAD:
+          payload_.push_back(b);
+          if (payload_.size() == len_) {
+            on_frame(kind_, payload_.data(), payload_.size());
+            state_ = TEXT;
+          }
+          break;
+      }
+    }
+  }
+
+ private:
+  enum State { TEXT, KIND, LENGTH, PAYLOAD };
+  State state_;
+  uint8_t kind_;
+  size_t len_;
+  std::vector<uint8_t> payload_;
+};
+
+/**
+ * Render one deferred frame payload using image for format lookup
+ */
+inline void debug_render_deferred(const DebugElfImage& image, uint8_t kind, const uint8_t* payload,
+                                  size_t len, std::string& out) {
+  if (len < 4) {
+    out += "<short frame>\n";
+    return;
+  }
+  uint32_t addr;
+  memcpy(&addr, payload, 4);
+  const char* fmt = image.lookup(addr);
+  if (!fmt) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "<unknown format 0x%08x>", (unsigned)addr);
+    out += buf;
+  } else {
+    DebugArgReader reader = {payload + 4, payload + len};
+    debug_render(fmt, reader, out);
+  }
+  if (kind == DEBUG_FRAME_DEFERRED_LN) out += '\n';
+}
+
+/**
+ * Render one token frame payload using db for detokenization
+ */
+inline void debug_render_token(const DebugTokenDatabase& db, uint8_t kind, const uint8_t* payload,
+                               size_t len, std::string& out) {
+  if (len < 4) {
+    out += "<short frame>\n";
+    return;
+  }
+  uint32_t token;
+  memcpy(&token, payload, 4);
+  const char* fmt = db.lookup(token);
+  if (!fmt) {
+    char buf[40];
+    snprintf(buf, sizeof(buf), "<unknown token %08x>", (unsigned)token);
+    out += buf;
+  } else {
+    DebugTokenReader reader = {payload + 4, payload + len};
+    debug_render(fmt, reader, out);
+  }
+  if (kind == DEBUG_FRAME_TOKEN_LN) out += '\n';
+}
+
+#endif  // DEBUG_DECODE_H
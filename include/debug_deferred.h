@@ -0,0 +1,155 @@
+/**
+ * @file debug_deferred.h
+ * @brief Deferred (binary) logging - record the format pointer, not the text
+ *
+ * With DEBUG_DEFERRED=1, debugf/debugfln/debug_if skip vsnprintf on the
+ * ESP32. Each call writes a small binary frame holding the address of the
+ * format literal plus the raw argument bytes; tools/debug_decode.cpp looks
+ * the literal up in the firmware ELF and re-creates the text on the host.
+ *
+ * Frame layout (see debug_frame.h, all integers little-endian):
+ *   [0x1E mark][kind][payload length][payload ...]
+ *   payload = u32 format address, then one tagged value per argument
+ *
+ * Plain text written by debug()/debugln() passes through unchanged, so
+ * frames and text can share the same serial stream.
+ *
+ * This header has no Arduino dependency; debug_decode.h is its host-side
+ * counterpart.
+ */
+
+#ifndef DEBUG_DEFERRED_H
+#define DEBUG_DEFERRED_H
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#include "debug_frame.h"
+
+#ifndef DEBUG_DEFERRED_MAX
+#define DEBUG_DEFERRED_MAX 96  // Max payload bytes per frame (args beyond are dropped)
+#endif
+
+static_assert(DEBUG_DEFERRED_MAX <= 255, "DEBUG_DEFERRED_MAX must fit in one length byte");
+
+// ============================================================================
+// ARGUMENT ENCODING
+// ============================================================================
+
+enum DebugArgTag : uint8_t {
+  DEBUG_ARG_I32 = 1,  // 4 bytes (all integers up to 32 bits, chars, bools)
+  DEBUG_ARG_I64 = 2,  // 8 bytes
+  DEBUG_ARG_F32 = 3,  // 4-byte float (promoted to double when rendered)
+  DEBUG_ARG_F64 = 4,  // 8-byte double
+  DEBUG_ARG_STR = 5   // u8 length + bytes (strings are copied, not referenced)
+};
+
+// ============================================================================
+// ENCODER
+// ============================================================================
+
+/**
+ * Bounded writer into a caller-provided buffer. Once an argument does not
+ * fit, it and all following arguments are dropped; the decoder renders
+ * them as missing.
+ */
+struct DebugEncoder {
+  uint8_t* pos;
+  uint8_t* end;
+  bool full;
+
+  DebugEncoder(uint8_t* begin, uint8_t* limit) : pos(begin), end(limit), full(false) {}
+
+  bool reserve(size_t n) {
+    if (full || (size_t)(end - pos) < n) {
+      full = true;
+      return false;
+    }
+    return true;
+  }
+
+  void put(const void* data, size_t n) {
+    memcpy(pos, data, n);
+    pos += n;
+  }
+
+  void tagged(uint8_t tag, const void* data, size_t n) {
+    if (!reserve(n + 1)) return;
+    *pos++ = tag;
+    put(data, n);
+  }
+};
+
+// Values are stored in host byte order; both ESP32 and x86/ARM hosts are
+// little-endian, matching the wire format.
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+debug_encode_arg(DebugEncoder& e, T value) {
+  if (sizeof(T) <= 4) {
+    int32_t v = (int32_t)value;
+    e.tagged(DEBUG_ARG_I32, &v, 4);
+  } else {
+    int64_t v = (int64_t)value;
+    e.tagged(DEBUG_ARG_I64, &v, 8);
+  }
+}
+
+inline void debug_encode_arg(DebugEncoder& e, float value) {
+  e.tagged(DEBUG_ARG_F32, &value, 4);
+}
+
+inline void debug_encode_arg(DebugEncoder& e, double value) {
+  e.tagged(DEBUG_ARG_F64, &value, 8);
+}
+
+inline void debug_encode_arg(DebugEncoder& e, const char* str) {
+  if (!str) str = "(null)";
+  size_t len = strlen(str);
+  if (len > 255) len = 255;
+  if (!e.reserve(2)) return;
+  size_t room = (size_t)(e.end - e.pos) - 2;
+  if (len > room) len = room;  // Truncate long strings rather than drop them
+  *e.pos++ = DEBUG_ARG_STR;
+  *e.pos++ = (uint8_t)len;
+  e.put(str, len);
+}
+
+inline void debug_encode_arg(DebugEncoder& e, char* str) {
+  debug_encode_arg(e, (const char*)str);
+}
+
+template <typename T>
+inline void debug_encode_arg(DebugEncoder& e, const T* ptr) {
+  debug_encode_arg(e, (uintptr_t)ptr);
+}
+
+inline void debug_encode_args(DebugEncoder&) {}
+
+template <typename T, typename... Rest>
+inline void debug_encode_args(DebugEncoder& e, T first, Rest... rest) {
+  debug_encode_arg(e, first);
+  debug_encode_args(e, rest...);
+}
+
+/**
+ * Encode one deferred frame and hand it to out.write() in a single call
+ * (so frames stay whole when out is the async ring buffer).
+ */
+template <typename Out, typename... Args>
+inline void debug_deferred_log(Out& out, uint8_t kind, const char* fmt, Args... args) {
+  uint8_t frame[3 + DEBUG_DEFERRED_MAX];
+  DebugEncoder e(frame + 3, frame + sizeof(frame));
+  uint32_t addr = (uint32_t)(uintptr_t)fmt;
+  e.reserve(4);
+  e.put(&addr, 4);
+  debug_encode_args(e, args...);
+  frame[0] = DEBUG_FRAME_MARK;
+  frame[1] = kind;
+  frame[2] = (uint8_t)(e.pos - (frame + 3));
+  out.write(frame, (size_t)(e.pos - frame));
+}
+
+#endif  // DEBUG_DEFERRED_H
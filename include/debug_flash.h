@@ -0,0 +1,594 @@
+/**
+ * @file debug_flash.h
+ * @brief Append-only debug log in a flash partition (DEBUG_FLASH=1)
+ *
+ * The macros write into a RAM ring (lock-free, as in debug_async.h); a
+ * background task packs the bytes into batches and appends each batch as
+ * one CRC-protected block to a dedicated flash partition, so flash writes
+ * and erases never run in the caller's context.
+ *
+ * Layout - every sector is one segment, used round-robin:
+ *   segment : [u32 magic][u32 seq][u32 CRC-32 of magic+seq][u32 reserved]
+ *             [block][block]...  (erased 0xFF after the last block)
+ *   block   : [u16 len][u16 ~len][u32 CRC-32 of payload][payload, padded to 4]
+ *
+ * Erase-ahead: when a segment is opened, the following sector is erased
+ * right away (in the flush task), so the switch to a new segment is a
+ * header write, not an erase, and the oldest segment is recycled one step
+ * early.
+ *
+ * Power-loss recovery (mount): the valid segment header with the highest
+ * sequence number is the current segment; its blocks are walked until
+ * erased flash. A block with a bad length or CRC (a write cut short)
+ * closes that segment and logging continues in the next one; everything
+ * before the cut is kept.
+ *
+ * Flash access goes through DebugFlashDevice: DebugFlashPartition on the
+ * ESP32 (esp_partition_*), DebugFlashFile on the host - a file with NOR
+ * semantics (program only clears bits, erase sets 0xFF) and a simulated
+ * power cut for recovery testing.
+ *
+ * Usage:
+ *   partitions.csv:  debuglog, data, 0x40, , 256K
+ *   build_flags   =  -DDEBUG_FLASH=1
+ *
+ *   void setup() {
+ *     Serial.begin(115200);
+ *     debug_flash_begin();                // mount + start the flush task
+ *   }
+ *   ...
+ *   debug_flash_dump(Serial);             // replay the stored log, oldest first
+ */
+
+#ifndef DEBUG_FLASH_H
+#define DEBUG_FLASH_H
+
+#pragma once
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "debug_crc.h"
+#include "debug_ring.h"
+
+#if defined(ESP_PLATFORM)
+#include <esp_partition.h>
+#else
+#include <chrono>
+#include <thread>
+#endif
+
+// ============================================================================
+// CONFIGURATION - Override via compiler flags or platformio.ini
+// ============================================================================
+
+#ifndef DEBUG_FLASH_PARTITION
+#define DEBUG_FLASH_PARTITION "debuglog"  // Data partition label (ESP32)
+#endif
+
+#ifndef DEBUG_FLASH_FILE
+#define DEBUG_FLASH_FILE "debug_flash.bin"  // Backing file (host)
+#endif
+
+#ifndef DEBUG_FLASH_FILE_SIZE
+#define DEBUG_FLASH_FILE_SIZE (256 * 1024)  // Simulated partition size (host)
+#endif
+
+#ifndef DEBUG_FLASH_SECTOR
+#define DEBUG_FLASH_SECTOR 4096  // Erase unit = segment size
+#endif
+
+#ifndef DEBUG_FLASH_BATCH
+#define DEBUG_FLASH_BATCH 512  // Max payload per block
+#endif
+
+#ifndef DEBUG_FLASH_BUFFER_SIZE
+#define DEBUG_FLASH_BUFFER_SIZE 4096  // RAM ring between the macros and the flush task
+#endif
+
+#ifndef DEBUG_FLASH_POLICY
+#define DEBUG_FLASH_POLICY DEBUG_DROP_NEWEST  // When the RAM ring is full (see debug_ring.h)
+#endif
+
+#ifndef DEBUG_FLASH_FLUSH_MS
+#define DEBUG_FLASH_FLUSH_MS 1000  // Longest a partial batch waits in RAM
+#endif
+
+#ifndef DEBUG_FLASH_POLL_MS
+#define DEBUG_FLASH_POLL_MS 20  // Flush task sleep when the ring is empty (at least one tick)
+#endif
+
+#ifndef DEBUG_FLASH_LINE_MAX
+#define DEBUG_FLASH_LINE_MAX 128  // Longest single formatted write (truncated beyond)
+#endif
+
+#ifndef DEBUG_FLASH_TASK_STACK
+#define DEBUG_FLASH_TASK_STACK 4096
+#endif
+
+#ifndef DEBUG_FLASH_ECHO
+#define DEBUG_FLASH_ECHO 1  // Also pass every write through to DEBUG_FLASH_UART
+#endif
+
+#ifndef DEBUG_FLASH_UART
+#define DEBUG_FLASH_UART Serial
+#endif
+
+#define DEBUG_FLASH_MAGIC 0x47534C44u  // "DLSG"
+#define DEBUG_FLASH_SEGMENT_HEADER 16
+#define DEBUG_FLASH_BLOCK_HEADER 8
+
+static_assert(DEBUG_FLASH_BATCH % 4 == 0 && DEBUG_FLASH_BATCH < 0xFFFF, "DEBUG_FLASH_BATCH must be a multiple of 4");
+static_assert(DEBUG_FLASH_SEGMENT_HEADER + DEBUG_FLASH_BLOCK_HEADER + DEBUG_FLASH_BATCH <= DEBUG_FLASH_SECTOR,
+              "DEBUG_FLASH_BATCH must fit in one sector");
+
+// ============================================================================
+// FLASH DEVICE
+// ============================================================================
+
+/**
+ * NOR flash as the log sees it: program clears bits, erase sets a whole
+ * sector to 0xFF. All offsets are relative to the partition.
+ */
+class DebugFlashDevice {
+ public:
+  virtual ~DebugFlashDevice() {}
+  virtual uint32_t size() const = 0;
+  virtual bool read(uint32_t offset, void* data, size_t len) = 0;
+  virtual bool write(uint32_t offset, const void* data, size_t len) = 0;
+  virtual bool erase_sector(uint32_t offset) = 0;
+};
+
+#if defined(ESP_PLATFORM)
+
+class DebugFlashPartition : public DebugFlashDevice {
+ public:
+  explicit DebugFlashPartition(const char* label)
+      : part_(esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label)) {}
+
+  bool valid() const { return part_ != NULL; }
+  uint32_t size() const override { return part_ ? (uint32_t)part_->size : 0; }
+  bool read(uint32_t offset, void* data, size_t len) override {
+    return esp_partition_read(part_, offset, data, len) == ESP_OK;
+  }
+  bool write(uint32_t offset, const void* data, size_t len) override {
+    return esp_partition_write(part_, offset, data, len) == ESP_OK;
+  }
+  bool erase_sector(uint32_t offset) override {
+    return esp_partition_erase_range(part_, offset, DEBUG_FLASH_SECTOR) == ESP_OK;
+  }
+
+ private:
+  const esp_partition_t* part_;
+};
+
+#else
+
+/**
+ * File-backed NOR flash simulation. power_cut_after(n) lets only the next
+ * n programmed bytes through (a write in progress stops part-way) and
+ * fails every write and erase after that, like a unit losing power.
+ */
+class DebugFlashFile : public DebugFlashDevice {
+ public:
+  DebugFlashFile(const char* path, uint32_t size)
+      : file_(NULL), size_(size), budget_(-1), programmed_(0), erases_(0) {
+    file_ = fopen(path, "r+b");
+    if (!file_) file_ = fopen(path, "w+b");
+    if (!file_) return;
+    fseek(file_, 0, SEEK_END);
+    long have = ftell(file_);
+    uint8_t ff[256];
+    memset(ff, 0xFF, sizeof(ff));
+    for (long at = have < 0 ? 0 : have; at < (long)size_; at += (long)sizeof(ff)) {
+      fwrite(ff, 1, (size_t)((long)size_ - at) < sizeof(ff) ? (size_t)((long)size_ - at) : sizeof(ff), file_);
+    }
+    fflush(file_);
+  }
+  ~DebugFlashFile() {
+    if (file_) fclose(file_);
+  }
+
+  bool valid() const { return file_ != NULL; }
+  uint32_t size() const override { return size_; }
+
+  bool read(uint32_t offset, void* data, size_t len) override {
+    if (!file_ || offset + len > size_) return false;
+    fseek(file_, (long)offset, SEEK_SET);
+    return fread(data, 1, len, file_) == len;
+  }
+
+  bool write(uint32_t offset, const void* data, size_t len) override {
+    if (!file_ || offset + len > size_) return false;
+    size_t n = len;
+    if (budget_ >= 0 && (long)n > budget_) n = (size_t)budget_;
+    const uint8_t* src = (const uint8_t*)data;
+    uint8_t cell[256];
+    for (size_t done = 0; done < n;) {
+      size_t k = n - done < sizeof(cell) ? n - done : sizeof(cell);
+      read(offset + (uint32_t)done, cell, k);
+      for (size_t i = 0; i < k; i++) cell[i] &= src[done + i];  // NOR: program clears bits only
+      fseek(file_, (long)(offset + done), SEEK_SET);
+      fwrite(cell, 1, k, file_);
+      done += k;
+    }
+    fflush(file_);
+    programmed_ += n;
+    if (budget_ >= 0) budget_ -= (long)n;
+    return n == len;
+  }
+
+  bool erase_sector(uint32_t offset) override {
+    if (!file_ || budget_ == 0 || offset % DEBUG_FLASH_SECTOR || offset + DEBUG_FLASH_SECTOR > size_) {
+      return false;
+    }
+    uint8_t ff[DEBUG_FLASH_SECTOR];
+    memset(ff, 0xFF, sizeof(ff));
+    fseek(file_, (long)offset, SEEK_SET);
+    fwrite(ff, 1, sizeof(ff), file_);
+    fflush(file_);
+    erases_++;
+    return true;
+  }
+
+  void power_cut_after(long bytes) { budget_ = bytes; }
+  void power_restore() { budget_ = -1; }
+  uint64_t programmed() const { return programmed_; }  // Bytes programmed
+  uint32_t erases() const { return erases_; }          // Sectors erased
+
+ private:
+  FILE* file_;
+  uint32_t size_;
+  long budget_;  // -1: unlimited
+  uint64_t programmed_;
+  uint32_t erases_;
+};
+
+#endif  // ESP_PLATFORM
+
+// ============================================================================
+// SEGMENTED LOG
+// ============================================================================
+
+class DebugFlashLog {
+ public:
+  DebugFlashLog() : dev_(NULL), sectors_(0), cur_(0), off_(0), seq_(0), next_erased_(false), appended_(0) {}
+
+  /**
+   * Find the current segment and write position after a reset or power
+   * loss; formats the partition when no valid segment exists
+   */
+  bool mount(DebugFlashDevice& dev) {
+    dev_ = &dev;
+    sectors_ = dev.size() / DEBUG_FLASH_SECTOR;
+    if (sectors_ < 2) return false;
+
+    bool found = false;
+    for (uint32_t s = 0; s < sectors_; s++) {
+      uint32_t seq;
+      if (segment_seq(s, &seq) && (!found || (int32_t)(seq - seq_) > 0)) {
+        found = true;
+        seq_ = seq;
+        cur_ = s;
+      }
+    }
+    if (!found) {
+      cur_ = sectors_ - 1;  // open_next() starts at sector 0
+      seq_ = 0;
+      next_erased_ = false;
+      return open_next();
+    }
+
+    off_ = DEBUG_FLASH_SEGMENT_HEADER;
+    bool torn = false;
+    uint16_t len;
+    while (!torn && (len = block_at(cur_, off_, &torn, NULL)) != 0) {
+      off_ += block_size(len);
+    }
+    next_erased_ = sector_erased((cur_ + 1) % sectors_);
+    if (torn) return open_next();  // Never program over a partly written block
+    if (!next_erased_) next_erased_ = dev_->erase_sector(((cur_ + 1) % sectors_) * DEBUG_FLASH_SECTOR);
+    return true;
+  }
+
+  /**
+   * Append one block (len <= DEBUG_FLASH_BATCH). Runs in the flush task.
+   */
+  bool append(const uint8_t* data, size_t len) {
+    if (!dev_ || !len || len > DEBUG_FLASH_BATCH) return false;
+    if (off_ + block_size((uint16_t)len) > DEBUG_FLASH_SECTOR && !open_next()) return false;
+    uint8_t block[DEBUG_FLASH_BLOCK_HEADER + DEBUG_FLASH_BATCH + 3];
+    uint16_t l = (uint16_t)len, nl = (uint16_t)~l;
+    uint32_t crc = debug_crc32(0, data, len);
+    memcpy(block, &l, 2);
+    memcpy(block + 2, &nl, 2);
+    memcpy(block + 4, &crc, 4);
+    memcpy(block + DEBUG_FLASH_BLOCK_HEADER, data, len);
+    size_t size = block_size(l);
+    memset(block + DEBUG_FLASH_BLOCK_HEADER + len, 0, size - DEBUG_FLASH_BLOCK_HEADER - len);
+    bool ok = dev_->write(cur_ * DEBUG_FLASH_SECTOR + off_, block, size);
+    off_ += (uint32_t)size;  // Even on failure: never program the same bytes twice
+    if (ok) appended_ += len;
+    return ok;
+  }
+
+  /**
+   * Call fn(data, len) for every stored block, oldest segment first
+   */
+  template <typename Fn>
+  void for_each(Fn fn) {
+    if (!dev_) return;
+    uint8_t payload[DEBUG_FLASH_BATCH];
+    uint32_t seq = 0, last = 0;
+    bool any = false;
+    // Segments in sequence order: repeatedly pick the smallest seq above the last one
+    for (;;) {
+      bool found = false;
+      uint32_t sector = 0;
+      for (uint32_t s = 0; s < sectors_; s++) {
+        uint32_t q;
+        if (segment_seq(s, &q) && (!any || (int32_t)(q - last) > 0) && (!found || (int32_t)(q - seq) < 0)) {
+          found = true;
+          seq = q;
+          sector = s;
+        }
+      }
+      if (!found) break;
+      any = true;
+      last = seq;
+      bool torn = false;
+      uint16_t len;
+      for (uint32_t off = DEBUG_FLASH_SEGMENT_HEADER; (len = block_at(sector, off, &torn, payload)) != 0;
+           off += block_size(len)) {
+        fn((const uint8_t*)payload, (size_t)len);
+      }
+    }
+  }
+
+  uint32_t appended() const { return (uint32_t)appended_; }  // Payload bytes since mount
+  uint32_t segment() const { return cur_; }
+  uint32_t offset() const { return off_; }
+
+ private:
+  static uint32_t block_size(uint16_t len) { return DEBUG_FLASH_BLOCK_HEADER + ((len + 3u) & ~3u); }
+
+  bool segment_seq(uint32_t sector, uint32_t* seq) {
+    uint32_t h[4];
+    if (!dev_->read(sector * DEBUG_FLASH_SECTOR, h, sizeof(h))) return false;
+    *seq = h[1];
+    return h[0] == DEBUG_FLASH_MAGIC && h[2] == debug_crc32(0, h, 8);
+  }
+
+  /**
+   * Length of the intact block at off (payload copied out when given),
+   * 0 at the end of the segment; *torn is set for a damaged block
+   */
+  uint16_t block_at(uint32_t sector, uint32_t off, bool* torn, uint8_t* payload) {
+    uint8_t h[DEBUG_FLASH_BLOCK_HEADER];
+    if (off + DEBUG_FLASH_BLOCK_HEADER > DEBUG_FLASH_SECTOR ||
+        !dev_->read(sector * DEBUG_FLASH_SECTOR + off, h, sizeof(h))) {
+      return 0;
+    }
+    uint16_t len, nl;
+    uint32_t crc;
+    memcpy(&len, h, 2);
+    memcpy(&nl, h + 2, 2);
+    memcpy(&crc, h + 4, 4);
+    if (len == 0xFFFF && nl == 0xFFFF) return 0;  // Erased: end of the log in this segment
+    uint8_t local[DEBUG_FLASH_BATCH];
+    uint8_t* buf = payload ? payload : local;
+    if (nl != (uint16_t)~len || !len || len > DEBUG_FLASH_BATCH || off + block_size(len) > DEBUG_FLASH_SECTOR ||
+        !dev_->read(sector * DEBUG_FLASH_SECTOR + off + DEBUG_FLASH_BLOCK_HEADER, buf, len) ||
+        debug_crc32(0, buf, len) != crc) {
+      *torn = true;
+      return 0;
+    }
+    return len;
+  }
+
+  bool sector_erased(uint32_t sector) {
+    uint32_t buf[64];
+    for (uint32_t off = 0; off < DEBUG_FLASH_SECTOR; off += sizeof(buf)) {
+      if (!dev_->read(sector * DEBUG_FLASH_SECTOR + off, buf, sizeof(buf))) return false;
+      for (size_t i = 0; i < 64; i++) {
+        if (buf[i] != 0xFFFFFFFFu) return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Move to the next sector (already erased ahead unless that failed),
+   * write its header, then erase the sector after it
+   */
+  bool open_next() {
+    uint32_t next = (cur_ + 1) % sectors_;
+    if (!next_erased_ && !dev_->erase_sector(next * DEBUG_FLASH_SECTOR)) return false;
+    uint32_t h[4] = {DEBUG_FLASH_MAGIC, seq_ + 1, 0, 0xFFFFFFFFu};
+    h[2] = debug_crc32(0, h, 8);
+    cur_ = next;
+    seq_++;
+    off_ = DEBUG_FLASH_SEGMENT_HEADER;
+    bool ok = dev_->write(cur_ * DEBUG_FLASH_SECTOR, h, sizeof(h));
+    next_erased_ = dev_->erase_sector(((cur_ + 1) % sectors_) * DEBUG_FLASH_SECTOR);
+    return ok;
+  }
+
+  DebugFlashDevice* dev_;
+  uint32_t sectors_;
+  uint32_t cur_;  // Current segment (sector index)
+  uint32_t off_;  // Next free byte in it
+  uint32_t seq_;  // Its sequence number
+  bool next_erased_;
+  uint64_t appended_;
+};
+
+// ============================================================================
+// FLASH PRINT OBJECT
+// ============================================================================
+
+/**
+ * Print implementation: write() copies into the RAM ring (and echoes to
+ * DEBUG_FLASH_UART); flush_step() in the flush task moves ring records
+ * into a batch and appends it when full or DEBUG_FLASH_FLUSH_MS old.
+ */
+class DebugFlashOutput : public Print {
+  typedef DebugRing<DEBUG_FLASH_BUFFER_SIZE> Ring;
+
+ public:
+  DebugFlashOutput() : batch_len_(0), batch_ms_(0), pending_len_(-1) { busy_.clear(); }
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+
+  size_t write(const uint8_t* data, size_t len) override {
+#if DEBUG_FLASH_ECHO
+    DEBUG_FLASH_UART.write(data, len);
+#endif
+    return ring_.write(data, len, DEBUG_FLASH_POLICY);
+  }
+
+  using Print::write;
+
+  size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+    va_list args;
+    va_start(args, fmt);
+    char line[DEBUG_FLASH_LINE_MAX];
+    size_t cut;
+    size_t n = debug_vformat_line(line, sizeof(line), fmt, args, &cut);
+    va_end(args);
+    if (cut) ring_.discard(cut);
+    return n ? write((const uint8_t*)line, n) : 0;
+  }
+
+  /**
+   * Move ring records into the batch and append it to flash when full,
+   * when older than DEBUG_FLASH_FLUSH_MS or when force is set. Returns
+   * bytes taken from the ring; 0 if another task is flushing.
+   */
+  size_t flush_step(bool force) {
+    if (busy_.test_and_set(std::memory_order_acquire)) return 0;
+    size_t moved = step(force);
+    busy_.clear(std::memory_order_release);
+    return moved;
+  }
+
+  /**
+   * Write everything buffered to flash now (before sleep or restart)
+   */
+  void flush() override {
+    while (busy_.test_and_set(std::memory_order_acquire)) debug_ring_wait();
+    while (step(true)) {
+    }
+    busy_.clear(std::memory_order_release);
+#if DEBUG_FLASH_ECHO
+    DEBUG_FLASH_UART.flush();
+#endif
+  }
+
+  bool mount(DebugFlashDevice& dev) { return log_.mount(dev); }
+
+  /** Replay the stored log to out, oldest first */
+  template <typename Out>
+  void dump(Out& out) {
+    while (busy_.test_and_set(std::memory_order_acquire)) debug_ring_wait();
+    log_.for_each([&out](const uint8_t* data, size_t len) { out.write(data, len); });
+    busy_.clear(std::memory_order_release);
+  }
+
+  DebugFlashLog& log() { return log_; }
+  uint32_t dropped() const { return ring_.dropped(); }
+
+ private:
+  size_t step(bool force) {
+    size_t moved = 0;
+    for (;;) {
+      if (pending_len_ < 0) pending_len_ = ring_.pop(pending_, sizeof(pending_), NULL);
+      if (pending_len_ < 0) break;
+      if (batch_len_ + (size_t)pending_len_ > DEBUG_FLASH_BATCH) append_batch();
+      if (!batch_len_) batch_ms_ = (uint32_t)millis();
+      memcpy(batch_ + batch_len_, pending_, (size_t)pending_len_);
+      batch_len_ += (size_t)pending_len_;
+      moved += (size_t)pending_len_;
+      pending_len_ = -1;
+    }
+    if (batch_len_ && (force || batch_len_ == DEBUG_FLASH_BATCH ||
+                       (uint32_t)millis() - batch_ms_ >= DEBUG_FLASH_FLUSH_MS)) {
+      append_batch();
+    }
+    return moved;
+  }
+
+  void append_batch() {
+    log_.append(batch_, batch_len_);
+    batch_len_ = 0;
+  }
+
+  Ring ring_;
+  DebugFlashLog log_;
+  uint8_t batch_[DEBUG_FLASH_BATCH];
+  size_t batch_len_;
+  uint32_t batch_ms_;
+  uint8_t pending_[Ring::record_max()];  // Record popped but not yet batched
+  int pending_len_;
+  std::atomic_flag busy_;
+};
+
+inline DebugFlashOutput& debug_flash_output() {
+  static DebugFlashOutput out;
+  return out;
+}
+
+/**
+ * Replay the stored log to out (e.g. Serial), oldest segment first
+ */
+template <typename Out>
+inline void debug_flash_dump(Out& out) {
+  debug_flash_output().dump(out);
+}
+
+// ============================================================================
+// FLUSH TASK
+// ============================================================================
+
+#if defined(ESP_PLATFORM)
+
+inline void debug_flash_task(void*) {
+  const TickType_t idle = pdMS_TO_TICKS(DEBUG_FLASH_POLL_MS) ? pdMS_TO_TICKS(DEBUG_FLASH_POLL_MS) : 1;  // 0 would spin
+  for (;;) {
+    if (!debug_flash_output().flush_step(false)) vTaskDelay(idle);
+  }
+}
+
+/**
+ * Mount the partition and start the flush task. Call once in setup().
+ * Returns false when the partition is missing or cannot be formatted.
+ */
+inline bool debug_flash_begin(UBaseType_t priority = 1, BaseType_t core = tskNO_AFFINITY) {
+  static DebugFlashPartition partition(DEBUG_FLASH_PARTITION);
+  static TaskHandle_t handle = NULL;
+  if (handle) return true;
+  if (!partition.valid() || !debug_flash_output().mount(partition)) return false;
+  return xTaskCreatePinnedToCore(debug_flash_task, "debug_flash", DEBUG_FLASH_TASK_STACK, NULL, priority,
+                                 &handle, core) == pdPASS;
+}
+
+#else  // Host build - flush from a detached std::thread into DEBUG_FLASH_FILE
+
+inline bool debug_flash_begin() {
+  static DebugFlashFile file(DEBUG_FLASH_FILE, DEBUG_FLASH_FILE_SIZE);
+  static bool started = false;
+  if (started) return true;
+  if (!file.valid() || !debug_flash_output().mount(file)) return false;
+  started = true;
+  std::thread([] {
+    for (;;) {
+      if (!debug_flash_output().flush_step(false)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(DEBUG_FLASH_POLL_MS));
+      }
+    }
+  }).detach();
+  return true;
+}
+
+#endif  // ESP_PLATFORM
+
+#endif  // DEBUG_FLASH_H
@@ -0,0 +1,283 @@
+/**
+ * @file debug_format.h
+ * @brief Compile-time printf format / argument checking (DEBUG_FMT_CHECK)
+ *
+ * The format literal is walked by C++11 constexpr functions, one argument
+ * at a time: each step returns what the next conversion needs (integer of
+ * a given size, floating point, string, pointer) and the argument's type
+ * is classified by DebugFmtArgKind. Any disagreement fails a static_assert:
+ *
+ *   debugf("t=%d\n", 21.5f);
+ *   error: static assertion failed: debug format: argument type does not
+ *          match its conversion (e.g. %d given a float, %s given a String)
+ *
+ * Integer conversions are checked by size after promotion (so %d accepts
+ * int, char, bool, enums and, on the ESP32, long). Signedness is NOT
+ * checked: %u given an int, or %d given an unsigned, passes.
+ * The format must be a string literal.
+ *
+ * debug_fmt_decode() turns one spec into constant fields (flags, width,
+ * precision, length, conversion) for the template formatter.
+ */
+
+#ifndef DEBUG_FORMAT_H
+#define DEBUG_FORMAT_H
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+enum DebugFmtResult {
+  DEBUG_FMT_OK = 0,
+  DEBUG_FMT_TOO_FEW,   // More conversions than arguments
+  DEBUG_FMT_TOO_MANY,  // More arguments than conversions
+  DEBUG_FMT_MISMATCH,  // Argument type does not fit its conversion
+  DEBUG_FMT_BAD_SPEC   // Unknown or unsupported conversion (%n, %b, ...)
+};
+
+// ============================================================================
+// FORMAT WALKER - What the next conversion needs
+// ============================================================================
+
+/**
+ * One argument requirement. kind: 'd' integer (size bytes), 'f' double,
+ * 'F' long double, 's' string, 'p' pointer, '?' bad spec, 0 end of format.
+ * A '*' width/precision is reported as an int and parsing resumes inside
+ * the same spec (in_spec).
+ */
+struct DebugFmtReq {
+  char kind;
+  uint8_t size;
+  const char* next;
+  bool in_spec;
+  constexpr DebugFmtReq(char k, uint8_t s, const char* n, bool in)
+      : kind(k), size(s), next(n), in_spec(in) {}
+};
+
+/** Next '%' that starts a conversion (skips "%%"), or the terminator */
+constexpr const char* debug_fmt_next(const char* p) {
+  return !*p ? p : *p != '%' ? debug_fmt_next(p + 1) : p[1] == '%' ? debug_fmt_next(p + 2) : p;
+}
+
+constexpr bool debug_fmt_is(char c, const char* set) {
+  return *set && (*set == c || debug_fmt_is(c, set + 1));
+}
+
+/** Conversion character at p with length modifier lm */
+constexpr DebugFmtReq debug_fmt_conv(const char* p, char lm) {
+  return debug_fmt_is(*p, "diouxXc")
+             ? DebugFmtReq('d',
+                           lm == 'l'   ? sizeof(long)
+                           : lm == 'q' ? sizeof(long long)
+                           : lm == 'z' ? sizeof(size_t)
+                           : lm == 'j' ? sizeof(intmax_t)
+                           : lm == 't' ? sizeof(ptrdiff_t)
+                           : lm == 0 || lm == 'h' || lm == 'H' ? sizeof(int)
+                                                                 : 0,
+                           p + 1, false)
+         : debug_fmt_is(*p, "fFeEgGaA") ? DebugFmtReq(lm == 'L' ? 'F' : 'f', 0, p + 1, false)
+         : *p == 's' && lm == 0         ? DebugFmtReq('s', 0, p + 1, false)
+         : *p == 'p' && lm == 0         ? DebugFmtReq('p', 0, p + 1, false)
+                                        : DebugFmtReq('?', 0, p, false);
+}
+
+/** Length modifier at p as one character ('H' for hh, 'q' for ll), 0 if none */
+constexpr char debug_fmt_lm(const char* p) {
+  return p[0] == 'h' && p[1] == 'h'   ? 'H'
+         : p[0] == 'l' && p[1] == 'l' ? 'q'
+         : debug_fmt_is(*p, "hlLzjt") ? *p
+                                      : 0;
+}
+
+/** Characters taken by length modifier lm */
+constexpr int debug_fmt_lm_len(char lm) { return lm == 'H' || lm == 'q' ? 2 : lm ? 1 : 0; }
+
+/** Length modifier (hh, h, l, ll, L, z, j, t) then conversion */
+constexpr DebugFmtReq debug_fmt_length(const char* p) {
+  return debug_fmt_conv(p + debug_fmt_lm_len(debug_fmt_lm(p)), debug_fmt_lm(p));
+}
+
+/** Inside a spec: flags, width, precision ('*' needs an int argument) */
+constexpr DebugFmtReq debug_fmt_spec(const char* p) {
+  return *p == '*'                         ? DebugFmtReq('d', sizeof(int), p + 1, true)
+         : debug_fmt_is(*p, "-+ #0123456789.") ? debug_fmt_spec(p + 1)
+                                               : debug_fmt_length(p);
+}
+
+constexpr DebugFmtReq debug_fmt_req(const char* p, bool in_spec) {
+  return in_spec ? debug_fmt_spec(p)
+         : !*debug_fmt_next(p) ? DebugFmtReq(0, 0, p, false)
+                               : debug_fmt_spec(debug_fmt_next(p) + 1);
+}
+
+// ============================================================================
+// SPEC DECODING - Every field of one conversion, for DEBUG_FAST_FORMAT
+// ============================================================================
+
+enum DebugFmtFlags : uint8_t {
+  DEBUG_FMT_LEFT = 1,   // '-'
+  DEBUG_FMT_PLUS = 2,   // '+'
+  DEBUG_FMT_SPACE = 4,  // ' '
+  DEBUG_FMT_ALT = 8,    // '#'
+  DEBUG_FMT_ZERO = 16   // '0'
+};
+
+/**
+ * One decoded conversion. width/prec are taken from int arguments when
+ * width_star/prec_star; prec is -1 when not given. length is
+ * debug_fmt_lm()'s code; end points past the conversion character.
+ */
+struct DebugFmtSpec {
+  uint8_t flags;
+  bool width_star;
+  bool prec_star;
+  char length;
+  char conv;
+  int width;
+  int prec;
+  const char* end;
+  constexpr DebugFmtSpec(uint8_t f, bool ws, bool ps, char lm, char c, int w, int pr, const char* e)
+      : flags(f), width_star(ws), prec_star(ps), length(lm), conv(c), width(w), prec(pr), end(e) {}
+};
+
+constexpr uint8_t debug_fmt_flag(char c) {
+  return c == '-'   ? DEBUG_FMT_LEFT
+         : c == '+' ? DEBUG_FMT_PLUS
+         : c == ' ' ? DEBUG_FMT_SPACE
+         : c == '#' ? DEBUG_FMT_ALT
+         : c == '0' ? DEBUG_FMT_ZERO
+                    : 0;
+}
+
+constexpr uint8_t debug_fmt_flags(const char* p) {
+  return debug_fmt_flag(*p) ? (uint8_t)(debug_fmt_flag(*p) | debug_fmt_flags(p + 1)) : 0;
+}
+
+constexpr const char* debug_fmt_skip_flags(const char* p) {
+  return debug_fmt_flag(*p) ? debug_fmt_skip_flags(p + 1) : p;
+}
+
+constexpr int debug_fmt_number(const char* p, int value) {
+  return *p >= '0' && *p <= '9' ? debug_fmt_number(p + 1, value * 10 + (*p - '0')) : value;
+}
+
+/** Past a width or precision: '*' or digits */
+constexpr const char* debug_fmt_skip_field(const char* p) {
+  return *p == '*' ? p + 1 : *p >= '0' && *p <= '9' ? debug_fmt_skip_field(p + 1) : p;
+}
+
+/** p: flags, w: width, q: precision, r: length modifier */
+constexpr DebugFmtSpec debug_fmt_decode_at(const char* p, const char* w, const char* q, const char* r) {
+  return DebugFmtSpec(debug_fmt_flags(p), *w == '*', *q == '.' && q[1] == '*', debug_fmt_lm(r),
+                      r[debug_fmt_lm_len(debug_fmt_lm(r))], debug_fmt_number(w, 0),
+                      *q == '.' ? debug_fmt_number(q + 1, 0) : -1,
+                      r + debug_fmt_lm_len(debug_fmt_lm(r)) + (r[debug_fmt_lm_len(debug_fmt_lm(r))] ? 1 : 0));
+}
+
+constexpr DebugFmtSpec debug_fmt_decode_prec(const char* p, const char* w, const char* q) {
+  return debug_fmt_decode_at(p, w, q, *q == '.' ? debug_fmt_skip_field(q + 1) : q);
+}
+
+/** Decode the spec that starts after its '%' */
+constexpr DebugFmtSpec debug_fmt_decode(const char* p) {
+  return debug_fmt_decode_prec(p, debug_fmt_skip_flags(p), debug_fmt_skip_field(debug_fmt_skip_flags(p)));
+}
+
+// ============================================================================
+// ARGUMENT CLASSIFICATION
+// ============================================================================
+
+template <typename... Ts>
+struct DebugFmtTypes {};
+
+/** Unevaluated: decltype(debug_fmt_types(args...)) lists the decayed types */
+template <typename... Ts>
+DebugFmtTypes<Ts...> debug_fmt_types(Ts...);
+
+template <typename T>
+struct DebugFmtArgKind {
+  static constexpr char kind =
+      std::is_integral<T>::value || std::is_enum<T>::value ? 'd'
+      : std::is_same<T, long double>::value                ? 'F'
+      : std::is_floating_point<T>::value                   ? 'f'
+      : std::is_same<T, char*>::value || std::is_same<T, const char*>::value ? 's'
+      : std::is_pointer<T>::value || std::is_same<T, std::nullptr_t>::value  ? 'p'
+                                                                             : 'x';
+  static constexpr uint8_t size = sizeof(T) < sizeof(int) ? sizeof(int) : sizeof(T);  // Promoted
+};
+
+constexpr bool debug_fmt_accepts(DebugFmtReq r, char kind, uint8_t size) {
+  return r.kind == 'd'   ? kind == 'd' && size == r.size
+         : r.kind == 'p' ? kind == 'p' || kind == 's'
+                         : kind == r.kind;
+}
+
+// ============================================================================
+// CHECK - Walk format and argument list together
+// ============================================================================
+
+constexpr int debug_fmt_match(DebugFmtReq r, DebugFmtTypes<>) {
+  return r.kind == 0 ? DEBUG_FMT_OK : r.kind == '?' ? DEBUG_FMT_BAD_SPEC : DEBUG_FMT_TOO_FEW;
+}
+
+template <typename T, typename... Rest>
+constexpr int debug_fmt_match(DebugFmtReq r, DebugFmtTypes<T, Rest...>);
+
+template <typename... Ts>
+constexpr int debug_fmt_check(const char* p, bool in_spec, DebugFmtTypes<Ts...> types) {
+  return debug_fmt_match(debug_fmt_req(p, in_spec), types);
+}
+
+template <typename T, typename... Rest>
+constexpr int debug_fmt_match(DebugFmtReq r, DebugFmtTypes<T, Rest...>) {
+  return r.kind == 0     ? DEBUG_FMT_TOO_MANY
+         : r.kind == '?' ? DEBUG_FMT_BAD_SPEC
+         : !debug_fmt_accepts(r, DebugFmtArgKind<T>::kind, DebugFmtArgKind<T>::size)
+             ? DEBUG_FMT_MISMATCH
+             : debug_fmt_check(r.next, r.in_spec, DebugFmtTypes<Rest...>());
+}
+
+/**
+ * Static assertions for a literal format and its arguments. Expands to
+ * declarations, so use it inside a block.
+ */
+#define DEBUG_FMT_ASSERT(fmt, ...) \
+  static_assert(debug_fmt_check(fmt, false, decltype(debug_fmt_types(__VA_ARGS__))()) != DEBUG_FMT_TOO_FEW, \
+                "debug format: fewer arguments than conversions"); \
+  static_assert(debug_fmt_check(fmt, false, decltype(debug_fmt_types(__VA_ARGS__))()) != DEBUG_FMT_TOO_MANY, \
+                "debug format: more arguments than conversions"); \
+  static_assert(debug_fmt_check(fmt, false, decltype(debug_fmt_types(__VA_ARGS__))()) != DEBUG_FMT_MISMATCH, \
+                "debug format: argument type does not match its conversion " \
+                "(e.g. %d given a float, %s given a String)"); \
+  static_assert(debug_fmt_check(fmt, false, decltype(debug_fmt_types(__VA_ARGS__))()) != DEBUG_FMT_BAD_SPEC, \
+                "debug format: unsupported conversion (newlib has no %b; %n is not allowed)")
+
+// ============================================================================
+// ISR RECORDS - Only conversions that fit one 32-bit record word
+// ============================================================================
+
+constexpr bool debug_fmt_isr_safe(const char* p, bool in_spec);
+
+constexpr bool debug_fmt_isr_req(DebugFmtReq r) {
+  return r.kind == 0 || r.kind == '?' ? true  // End, or a bad spec reported elsewhere
+         : r.kind == 'f' || r.kind == 'F' || (r.kind == 'd' && r.size > 4)
+             ? false
+             : debug_fmt_isr_safe(r.next, r.in_spec);
+}
+
+/** No %f/%e/%g and no 64-bit integer conversions (%lld, %llu, %jd...) */
+constexpr bool debug_fmt_isr_safe(const char* p, bool in_spec) {
+  return debug_fmt_isr_req(debug_fmt_req(p, in_spec));
+}
+
+/**
+ * Extra check for debugf_isr: its records store each argument in one
+ * 32-bit word, so wider conversions would print truncated values
+ */
+#define DEBUG_FMT_ASSERT_ISR(fmt) \
+  static_assert(debug_fmt_isr_safe(fmt, false), \
+                "debugf_isr: floating-point and 64-bit conversions are not supported " \
+                "(each argument is stored as one 32-bit word)")
+
+#endif  // DEBUG_FORMAT_H
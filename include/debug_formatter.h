@@ -0,0 +1,625 @@
+/**
+ * @file debug_formatter.h
+ * @brief Variadic-template printf replacement (DEBUG_FAST_FORMAT=1)
+ *
+ * DEBUG_FORMAT_TO(out, fmt, args...) renders a printf-style format without
+ * va_list or vsnprintf. The format literal is parsed at compile time: the
+ * macro wraps it in a local type, and the walk below takes positions in it
+ * as template arguments, so every literal run is a constant-length copy and
+ * every conversion spec a constant (debug_fmt_decode() in debug_format.h).
+ * Only the per-argument routines run: each is chosen by the argument's C++
+ * type (digit-pair decimal, branchless hex, exact fixed-point float; see
+ * debug_conv.h) and writes straight into a small stack buffer that is
+ * handed to out.write() when full and at the end - normally one write per
+ * line.
+ *
+ * Supported: flags "-+ #0", width and precision (including '*'), length
+ * modifiers, d i u x X o c s p f F e E g G and %%. Anything else, float
+ * precision above DEBUG_FORMAT_FLOAT_PREC and argument-count mismatches
+ * fail to compile.
+ *
+ * Output matches printf, except: %f of |value| >= 1e19 prints in %e form;
+ * %e/%g digits of values outside about 1e-10..1.8e19 are scaled in double
+ * precision and can differ in the last place; a '*' precision above
+ * DEBUG_FORMAT_FLOAT_PREC is zero-padded; %p of NULL prints 0x0 (newlib).
+ */
+
+#ifndef DEBUG_FORMATTER_H
+#define DEBUG_FORMATTER_H
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#include "debug_conv.h"
+#include "debug_format.h"
+
+#ifndef DEBUG_FORMAT_CHUNK
+#define DEBUG_FORMAT_CHUNK 128  // Stack buffer; lines longer than this take several writes
+#endif
+
+#define DEBUG_FORMAT_FLOAT_PREC 17  // Most float digits rendered exactly (64-bit arithmetic)
+
+// ============================================================================
+// OUTPUT BUFFER
+// ============================================================================
+
+template <typename Out>
+class DebugFmtWriter {
+ public:
+  explicit DebugFmtWriter(Out& out) : out_(out), n_(0) {}
+
+  void put(char c) {
+    if (n_ == sizeof(buf_)) flush();
+    buf_[n_++] = c;
+  }
+
+  void put(const char* s, size_t len) {
+    while (len) {
+      if (n_ == sizeof(buf_)) flush();
+      size_t n = sizeof(buf_) - n_ < len ? sizeof(buf_) - n_ : len;
+      memcpy(buf_ + n_, s, n);
+      n_ += n;
+      s += n;
+      len -= n;
+    }
+  }
+
+  void fill(char c, int count) {
+    while (count-- > 0) put(c);
+  }
+
+  void flush() {
+    if (n_) out_.write((const uint8_t*)buf_, n_);
+    n_ = 0;
+  }
+
+ private:
+  Out& out_;
+  size_t n_;
+  char buf_[DEBUG_FORMAT_CHUNK];
+};
+
+// ============================================================================
+// FIELD RENDERING
+// ============================================================================
+
+/** Hex (shift 4) or octal (shift 3); setting 0x20 lower-cases A-F and keeps 0-9 */
+inline char* debug_fmt_radix(char* end, uint64_t v, unsigned shift, bool upper) {
+  char lower = upper ? 0 : 0x20;
+  unsigned mask = (1u << shift) - 1;
+  do {
+    *--end = (char)(debug_conv_nibble((uint32_t)(v & mask)) | lower);
+    v >>= shift;
+  } while (v);
+  return end;
+}
+
+/**
+ * Pad and emit sign/prefix + digits according to width and flags; trail
+ * zeros go into the body at split (float precision beyond
+ * DEBUG_FORMAT_FLOAT_PREC)
+ */
+template <typename Out>
+inline void debug_fmt_field(DebugFmtWriter<Out>& w, const DebugFmtSpec& s, const char* prefix,
+                            size_t prefix_len, const char* body, size_t body_len, int zeros,
+                            size_t split = 0, int trail = 0) {
+  int pad = s.width - (int)(prefix_len + body_len) - zeros - trail;
+  if (!(s.flags & (DEBUG_FMT_LEFT | DEBUG_FMT_ZERO))) w.fill(' ', pad);
+  w.put(prefix, prefix_len);
+  if ((s.flags & (DEBUG_FMT_LEFT | DEBUG_FMT_ZERO)) == DEBUG_FMT_ZERO) w.fill('0', pad);
+  w.fill('0', zeros);
+  if (trail) {
+    w.put(body, split);
+    w.fill('0', trail);
+    w.put(body + split, body_len - split);
+  } else {
+    w.put(body, body_len);
+  }
+  if (s.flags & DEBUG_FMT_LEFT) w.fill(' ', pad);
+}
+
+template <typename Out>
+inline void debug_fmt_integer(DebugFmtWriter<Out>& w, DebugFmtSpec s, uint64_t mag, bool negative) {
+  char buf[24];
+  char* end = buf + sizeof(buf);
+  char* p;
+  char prefix[2];
+  size_t prefix_len = 0;
+
+  switch (s.conv) {
+    case 'x':
+    case 'X':
+      p = debug_fmt_radix(end, mag, 4, s.conv == 'X');
+      if ((s.flags & DEBUG_FMT_ALT) && mag) {
+        prefix[0] = '0';
+        prefix[1] = s.conv;
+        prefix_len = 2;
+      }
+      break;
+    case 'p':  // newlib: 0x + lower-case hex, also for NULL
+      p = debug_fmt_radix(end, mag, 4, false);
+      prefix[0] = '0';
+      prefix[1] = 'x';
+      prefix_len = 2;
+      break;
+    case 'o':
+      p = debug_fmt_radix(end, mag, 3, false);
+      if ((s.flags & DEBUG_FMT_ALT) && *p != '0') *--p = '0';
+      break;
+    case 'u':
+      p = debug_conv_u64(end, mag);
+      break;
+    default:
+      p = debug_conv_u64(end, mag);
+      if (negative) prefix[prefix_len++] = '-';
+      else if (s.flags & DEBUG_FMT_PLUS) prefix[prefix_len++] = '+';
+      else if (s.flags & DEBUG_FMT_SPACE) prefix[prefix_len++] = ' ';
+      break;
+  }
+
+  int digits = (int)(end - p);
+  if (s.prec == 0 && mag == 0 && !(s.conv == 'o' && (s.flags & DEBUG_FMT_ALT))) digits = 0;  // %.0d of 0
+  int zeros = s.prec > digits ? s.prec - digits : 0;
+  if (s.prec >= 0) s.flags &= ~DEBUG_FMT_ZERO;  // Precision disables '0' padding
+  debug_fmt_field(w, s, prefix, prefix_len, end - digits, (size_t)digits, zeros);
+}
+
+template <typename Out>
+inline void debug_fmt_string(DebugFmtWriter<Out>& w, const DebugFmtSpec& s, const char* str) {
+  if (!str) str = "(null)";
+  size_t len = 0;
+  while (str[len] && (s.prec < 0 || len < (size_t)s.prec)) len++;
+  debug_fmt_field(w, s, "", 0, str, len, 0);
+}
+
+// ============================================================================
+// FLOAT DIGITS - Exact decimal rounding of a double in 64-bit integers
+// ============================================================================
+
+static const uint64_t debug_fmt_pow10[20] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull,
+    1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull,
+    100000000000000ull, 1000000000000000ull, 10000000000000000ull, 100000000000000000ull,
+    1000000000000000000ull, 10000000000000000000ull};
+
+static const uint64_t debug_fmt_pow5[28] = {
+    1ull, 5ull, 25ull, 125ull, 625ull, 3125ull, 15625ull, 78125ull, 390625ull, 1953125ull,
+    9765625ull, 48828125ull, 244140625ull, 1220703125ull, 6103515625ull, 30517578125ull,
+    152587890625ull, 762939453125ull, 3814697265625ull, 19073486328125ull, 95367431640625ull,
+    476837158203125ull, 2384185791015625ull, 11920928955078125ull, 59604644775390625ull,
+    298023223876953125ull, 1490116119384765625ull, 7450580596923828125ull};
+
+static const double debug_fmt_pow10d[23] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                            1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                            1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+/** A finite 0 <= v < 2^64 as whole + frac / 2^bits */
+struct DebugFmtParts {
+  uint64_t whole;
+  uint64_t frac;
+  int bits;
+};
+
+inline DebugFmtParts debug_fmt_split(double v) {
+  uint64_t raw;
+  memcpy(&raw, &v, sizeof(raw));
+  int exp = (int)(raw >> 52) & 0x7FF;
+  uint64_t mant = raw & 0xFFFFFFFFFFFFFull;
+  if (exp) {
+    mant |= 1ull << 52;
+  } else {
+    exp = 1;  // Subnormal
+  }
+  int e = exp - 1075;  // v = mant * 2^e
+  DebugFmtParts p;
+  if (e >= 0) {
+    p.whole = mant << e;
+    p.frac = 0;
+    p.bits = 0;
+  } else if (e > -64) {
+    p.whole = mant >> -e;
+    p.frac = mant & ((1ull << -e) - 1);
+    p.bits = -e;
+  } else {
+    p.whole = 0;
+    p.frac = mant;
+    p.bits = -e;
+  }
+  return p;
+}
+
+/**
+ * frac / 2^bits * 10^n (n <= 27), truncated; half is set to how the rest
+ * compares with one half (-1, 0, 1). The caller keeps the result in 64 bits.
+ */
+inline uint64_t debug_fmt_frac(uint64_t frac, int bits, int n, int& half) {
+  half = -1;
+  if (!frac) return 0;
+  // x = frac * 5^n in two words (frac < 2^53, so x < 2^116), then x >> (bits - n)
+  uint64_t a0 = (uint32_t)frac, a1 = frac >> 32;
+  uint64_t b0 = (uint32_t)debug_fmt_pow5[n], b1 = debug_fmt_pow5[n] >> 32;
+  uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0;
+  uint64_t mid = (p00 >> 32) + (uint32_t)p01 + (uint32_t)p10;
+  uint64_t lo = (mid << 32) | (uint32_t)p00;
+  uint64_t hi = a1 * b1 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+  int s = bits - n;
+  if (s <= 0) return lo << -s;  // Exact
+  if (s >= 128) return 0;       // Below 2^-12
+  uint64_t q, rest_hi, rest_lo, half_hi, half_lo;
+  if (s < 64) {
+    q = lo >> s | hi << (64 - s);
+    rest_hi = 0;
+    rest_lo = lo & ((1ull << s) - 1);
+    half_hi = 0;
+    half_lo = 1ull << (s - 1);
+  } else {
+    q = hi >> (s - 64);
+    rest_hi = hi & ((1ull << (s - 64)) - 1);
+    rest_lo = lo;
+    half_hi = s > 64 ? 1ull << (s - 65) : 0;
+    half_lo = s > 64 ? 0 : 1ull << 63;
+  }
+  half = rest_hi != half_hi ? (rest_hi > half_hi ? 1 : -1) : rest_lo != half_lo ? (rest_lo > half_lo ? 1 : -1) : 0;
+  return q;
+}
+
+/**
+ * round(v * 10^n), ties to even, for a finite v >= 0; the result must fit
+ * 64 bits. Exact for v < 2^64 and -19 <= n <= 27, scaled in double otherwise.
+ */
+inline uint64_t debug_fmt_scale(double v, int n) {
+  if (v < 18446744073709551616.0 && n >= -19 && n <= 27) {
+    DebugFmtParts p = debug_fmt_split(v);
+    int half;
+    uint64_t q;
+    if (n >= 0) {
+      q = debug_fmt_frac(p.frac, p.bits, n, half);
+      if (p.whole) q += p.whole * debug_fmt_pow10[n];  // n <= 19 whenever the result fits
+    } else {
+      uint64_t d = debug_fmt_pow10[-n], r = p.whole % d;
+      q = p.whole / d;
+      half = r != d / 2 ? (r > d / 2 ? 1 : -1) : p.frac ? 1 : 0;
+    }
+    if (half > 0 || (half == 0 && (q & 1))) q++;
+    return q;
+  }
+  double s = v;
+  for (; n > 22; n -= 22) s *= 1e22;
+  for (; n < -22; n += 22) s /= 1e22;
+  s = n >= 0 ? s * debug_fmt_pow10d[n] : s / debug_fmt_pow10d[-n];
+  uint64_t q = (uint64_t)s;
+  double rest = s - (double)q;
+  if (rest > 0.5 || (rest == 0.5 && (q & 1))) q++;
+  return q;
+}
+
+/**
+ * v > 0 as m * 10^(exp10 - prec), m with exactly prec + 1 digits
+ */
+inline uint64_t debug_fmt_sci(double v, int prec, int& exp10) {
+  uint64_t raw;
+  memcpy(&raw, &v, sizeof(raw));
+  int e2 = (int)(raw >> 52);
+  e2 = e2 ? e2 - 1023 : 63 - __builtin_clzll(raw) - 1074;  // floor(log2(v))
+  double t = e2 * 0.30102999566398120;
+  int x = (int)t;
+  if (x > t) x--;  // floor(log10(2^e2)): the exponent or one below it
+  uint64_t m = debug_fmt_scale(v, prec - x);
+  while (m < debug_fmt_pow10[prec]) m = debug_fmt_scale(v, prec - --x);
+  while (m >= debug_fmt_pow10[prec + 1]) m = debug_fmt_scale(v, prec - ++x);  // Also a carry to 10.0
+  exp10 = x;
+  return m;
+}
+
+/** Exponent suffix e+NN / E-NNN */
+inline size_t debug_fmt_exponent(char* out, int exp10, bool upper) {
+  size_t n = 0;
+  out[n++] = upper ? 'E' : 'e';
+  out[n++] = exp10 < 0 ? '-' : '+';
+  unsigned e = exp10 < 0 ? -exp10 : exp10;
+  if (e >= 100) out[n++] = (char)('0' + e / 100);
+  memcpy(out + n, debug_conv_pairs + (e % 100) * 2, 2);
+  return n + 2;
+}
+
+/**
+ * Text of a finite v >= 0 in style 'f', 'e' or 'g' with prec <=
+ * DEBUG_FORMAT_FLOAT_PREC; split is where extra precision zeros would go.
+ * Returns the length.
+ */
+inline size_t debug_fmt_float_body(char* out, double v, int prec, char style, bool upper, bool alt, size_t& split) {
+  char digits[24];
+  char* end = digits + sizeof(digits);
+  size_t n = 0;
+
+  if (style == 'f') {
+    DebugFmtParts p = debug_fmt_split(v);
+    int half;
+    uint64_t frac = debug_fmt_frac(p.frac, p.bits, prec, half);
+    if (half > 0 || (half == 0 && ((prec ? frac : p.whole) & 1))) frac++;
+    if (frac == debug_fmt_pow10[prec]) {  // Rounding carried into the integer part
+      frac = 0;
+      p.whole++;
+    }
+    char* d = debug_conv_u64(end, p.whole);
+    n = (size_t)(end - d);
+    memcpy(out, d, n);
+    if (prec || alt) out[n++] = '.';
+    for (int i = prec - 1; i >= 0; i--) {
+      out[n + i] = (char)('0' + frac % 10);
+      frac /= 10;
+    }
+    n += prec;
+    split = n;
+    return n;
+  }
+
+  // 'e' and 'g' share the significant digits: 'g' has prec of them
+  int sig = style == 'g' ? (prec ? prec : 1) : prec + 1;
+  int x = 0;
+  uint64_t m = v != 0 ? debug_fmt_sci(v, sig - 1, x) : 0;
+  char* d = end - sig;
+  memset(d, '0', (size_t)sig);
+  debug_conv_u64(end, m);
+
+  if (style == 'g' && x >= -4 && x < sig) {
+    if (x >= 0) {
+      memcpy(out, d, (size_t)x + 1);
+      n = (size_t)x + 1;
+      out[n++] = '.';
+      memcpy(out + n, d + x + 1, (size_t)(sig - 1 - x));
+      n += (size_t)(sig - 1 - x);
+    } else {
+      out[n++] = '0';
+      out[n++] = '.';
+      memset(out + n, '0', (size_t)(-x - 1));
+      n += (size_t)(-x - 1);
+      memcpy(out + n, d, (size_t)sig);
+      n += (size_t)sig;
+    }
+    if (!alt) {  // Trailing zeros and a bare point go
+      while (out[n - 1] == '0') n--;
+      if (out[n - 1] == '.') n--;
+    }
+    split = n;
+    return n;
+  }
+
+  out[n++] = d[0];
+  if (sig > 1 || alt) out[n++] = '.';
+  memcpy(out + n, d + 1, (size_t)(sig - 1));
+  n += (size_t)(sig - 1);
+  if (style == 'g' && !alt) {
+    while (out[n - 1] == '0') n--;
+    if (out[n - 1] == '.') n--;
+  }
+  split = n;
+  return n + debug_fmt_exponent(out + n, x, upper);
+}
+
+template <typename Out>
+inline void debug_fmt_float(DebugFmtWriter<Out>& w, DebugFmtSpec s, double v) {
+  char prefix[1];
+  size_t prefix_len = 0;
+  bool upper = s.conv == 'F' || s.conv == 'E' || s.conv == 'G';
+  uint64_t raw;
+  memcpy(&raw, &v, sizeof(raw));
+  if (raw >> 63) {  // Sign bit: also -0.0 and -nan
+    prefix[prefix_len++] = '-';
+    v = -v;
+  } else if (s.flags & DEBUG_FMT_PLUS) {
+    prefix[prefix_len++] = '+';
+  } else if (s.flags & DEBUG_FMT_SPACE) {
+    prefix[prefix_len++] = ' ';
+  }
+
+  if (v != v || v > 1.7976931348623157e308) {
+    s.flags &= ~DEBUG_FMT_ZERO;
+    debug_fmt_field(w, s, prefix, prefix_len, v != v ? (upper ? "NAN" : "nan") : (upper ? "INF" : "inf"),
+                    3, 0);
+    return;
+  }
+
+  bool alt = s.flags & DEBUG_FMT_ALT;
+  char style = s.conv | 0x20;  // Lower case
+  if (style == 'f' && v >= 1e19) style = 'e';
+  int prec = s.prec < 0 ? 6 : s.prec;
+  int extra = 0;
+  if (prec > DEBUG_FORMAT_FLOAT_PREC) {  // Only from a '*' argument
+    extra = style != 'g' || alt ? prec - DEBUG_FORMAT_FLOAT_PREC : 0;
+    prec = DEBUG_FORMAT_FLOAT_PREC;
+  }
+  char body[48];
+  size_t split;
+  size_t n = debug_fmt_float_body(body, v, prec, style, upper, alt, split);
+  debug_fmt_field(w, s, prefix, prefix_len, body, n, 0, split, extra);
+}
+
+// ============================================================================
+// PER-TYPE DISPATCH
+// ============================================================================
+
+template <typename T>
+struct DebugFmtPromoted {
+  typedef typename std::conditional<
+      std::is_enum<T>::value, int,
+      typename std::conditional<(sizeof(T) < sizeof(int)), int, T>::type>::type type;
+};
+
+template <typename Out, typename T>
+inline typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+debug_fmt_arg(DebugFmtWriter<Out>& w, const DebugFmtSpec& s, T value) {
+  typedef typename DebugFmtPromoted<T>::type P;
+  typedef typename std::make_unsigned<P>::type U;
+  typedef typename std::make_signed<P>::type S;
+  uint64_t u = (uint64_t)(U)(P)value;
+  int64_t v = (int64_t)(S)(P)value;  // Reinterpret like printf does for %d of an unsigned
+  if (s.length == 'h') {
+    u = (unsigned short)u;
+    v = (short)v;
+  } else if (s.length == 'H') {
+    u = (unsigned char)u;
+    v = (signed char)v;
+  }
+  if (s.conv == 'c') {
+    char c = (char)value;
+    debug_fmt_field(w, s, "", 0, &c, 1, 0);
+  } else if (s.conv == 'd' || s.conv == 'i') {
+    debug_fmt_integer(w, s, v < 0 ? 0 - (uint64_t)v : (uint64_t)v, v < 0);
+  } else {
+    debug_fmt_integer(w, s, u, false);
+  }
+}
+
+template <typename Out, typename T>
+inline typename std::enable_if<std::is_floating_point<T>::value>::type debug_fmt_arg(
+    DebugFmtWriter<Out>& w, const DebugFmtSpec& s, T value) {
+  debug_fmt_float(w, s, (double)value);
+}
+
+template <typename Out>
+inline void debug_fmt_arg(DebugFmtWriter<Out>& w, DebugFmtSpec s, const void* value) {
+  s.conv = 'p';
+  debug_fmt_integer(w, s, (uint64_t)(uintptr_t)value, false);
+}
+
+template <typename Out>
+inline void debug_fmt_arg(DebugFmtWriter<Out>& w, const DebugFmtSpec& s, std::nullptr_t) {
+  debug_fmt_arg(w, s, (const void*)0);
+}
+
+template <typename Out>
+inline void debug_fmt_arg(DebugFmtWriter<Out>& w, const DebugFmtSpec& s, const char* value) {
+  if (s.conv == 's') {
+    debug_fmt_string(w, s, value);
+  } else {
+    debug_fmt_arg(w, s, (const void*)value);
+  }
+}
+
+template <typename Out>
+inline void debug_fmt_arg(DebugFmtWriter<Out>& w, const DebugFmtSpec& s, char* value) {
+  debug_fmt_arg(w, s, (const char*)value);
+}
+
+template <typename Out, typename T>
+inline void debug_fmt_arg(DebugFmtWriter<Out>& w, const DebugFmtSpec& s, T* value) {
+  debug_fmt_arg(w, s, (const void*)value);
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, int>::type
+debug_fmt_int(T value) {
+  return (int)value;
+}
+
+template <typename T>
+inline typename std::enable_if<!std::is_integral<T>::value && !std::is_enum<T>::value, int>::type
+debug_fmt_int(const T&) {
+  return 0;
+}
+
+// ============================================================================
+// FORMAT WALK - Positions in the literal are template arguments
+// ============================================================================
+
+/** First '%' at or after p, or the terminator */
+constexpr const char* debug_fmt_stop(const char* p) { return !*p || *p == '%' ? p : debug_fmt_stop(p + 1); }
+
+/** What follows a literal run stopped at p */
+enum DebugFmtStep { DEBUG_FMT_STEP_END, DEBUG_FMT_STEP_PERCENT, DEBUG_FMT_STEP_CONV };
+
+constexpr int debug_fmt_step(const char* p) {
+  return !*p ? DEBUG_FMT_STEP_END : p[1] == '%' ? DEBUG_FMT_STEP_PERCENT : DEBUG_FMT_STEP_CONV;
+}
+
+template <typename Lit, size_t Pos, typename Out, typename... Args>
+inline void debug_fmt_text(DebugFmtWriter<Out>& w, const Args&... args);
+
+template <typename Lit, size_t Pos, typename Out, typename... Args>
+inline void debug_fmt_after(DebugFmtWriter<Out>&, std::integral_constant<int, DEBUG_FMT_STEP_END>,
+                            const Args&...) {
+  static_assert(sizeof...(Args) == 0, "DEBUG_FAST_FORMAT: more arguments than conversions");
+}
+
+template <typename Lit, size_t Pos, typename Out, typename... Args>
+inline void debug_fmt_after(DebugFmtWriter<Out>& w, std::integral_constant<int, DEBUG_FMT_STEP_PERCENT>,
+                            const Args&... args) {
+  debug_fmt_text<Lit, Pos>(w, args...);
+}
+
+/** The value; its spec is a constant unless a '*' argument changed it */
+template <typename Lit, size_t Next, typename Out, typename T, typename... Rest>
+inline void debug_fmt_value(DebugFmtWriter<Out>& w, const DebugFmtSpec& s, std::false_type, std::false_type,
+                            const T& value, const Rest&... rest) {
+  debug_fmt_arg(w, s, value);
+  debug_fmt_text<Lit, Next>(w, rest...);
+}
+
+template <typename Lit, size_t Next, typename Out, bool Prec, typename T, typename... Rest>
+inline void debug_fmt_value(DebugFmtWriter<Out>& w, DebugFmtSpec s, std::true_type,
+                            std::integral_constant<bool, Prec> prec, const T& width, const Rest&... rest) {
+  s.width = debug_fmt_int(width);
+  if (s.width < 0) {
+    s.flags |= DEBUG_FMT_LEFT;
+    s.width = -s.width;
+  }
+  debug_fmt_value<Lit, Next>(w, s, std::false_type(), prec, rest...);
+}
+
+template <typename Lit, size_t Next, typename Out, typename T, typename... Rest>
+inline void debug_fmt_value(DebugFmtWriter<Out>& w, DebugFmtSpec s, std::false_type, std::true_type,
+                            const T& prec, const Rest&... rest) {
+  s.prec = debug_fmt_int(prec);
+  if (s.prec < 0) s.prec = -1;
+  debug_fmt_value<Lit, Next>(w, s, std::false_type(), std::false_type(), rest...);
+}
+
+template <typename Lit, size_t Pos, typename Out, typename... Args>
+inline void debug_fmt_after(DebugFmtWriter<Out>& w, std::integral_constant<int, DEBUG_FMT_STEP_CONV>,
+                            const Args&... args) {
+  constexpr DebugFmtSpec spec = debug_fmt_decode(Lit::str() + Pos);
+  static_assert(debug_fmt_is(spec.conv, "diouxXcspfFeEgG"),
+                "DEBUG_FAST_FORMAT: unsupported conversion (%a, %n, ...)");
+  static_assert(!debug_fmt_is(spec.conv, "fFeEgG") || spec.prec <= DEBUG_FORMAT_FLOAT_PREC,
+                "DEBUG_FAST_FORMAT: float precision above DEBUG_FORMAT_FLOAT_PREC");
+  static_assert(sizeof...(Args) >= 1 + spec.width_star + spec.prec_star,
+                "DEBUG_FAST_FORMAT: fewer arguments than conversions");
+  debug_fmt_value<Lit, (size_t)(spec.end - Lit::str())>(w, spec, std::integral_constant<bool, spec.width_star>(),
+                                                         std::integral_constant<bool, spec.prec_star>(), args...);
+}
+
+/** Copy the literal run at Pos ("%%" as one '%'), then what follows it */
+template <typename Lit, size_t Pos, typename Out, typename... Args>
+inline void debug_fmt_text(DebugFmtWriter<Out>& w, const Args&... args) {
+  constexpr size_t stop = (size_t)(debug_fmt_stop(Lit::str() + Pos) - Lit::str());
+  constexpr int step = debug_fmt_step(Lit::str() + stop);
+  w.put(Lit::str() + Pos, stop - Pos + (step == DEBUG_FMT_STEP_PERCENT));
+  debug_fmt_after<Lit, stop + (step == DEBUG_FMT_STEP_PERCENT ? 2 : 1)>(
+      w, std::integral_constant<int, step>(), args...);
+}
+
+/**
+ * Format the literal Lit::str() to out (any type with
+ * write(const uint8_t*, size_t)) in as few writes as possible
+ */
+template <typename Lit, typename Out, typename... Args>
+inline void debug_format_to(Out& out, const Args&... args) {
+  DebugFmtWriter<Out> w(out);
+  debug_fmt_text<Lit, 0>(w, args...);
+  w.flush();
+}
+
+/**
+ * debug_format_to() for a string literal fmt, parsed at compile time
+ */
+#define DEBUG_FORMAT_TO(out, fmt, ...) do { \
+  struct DebugFmtLiteral { \
+    static constexpr const char* str() { return fmt; } \
+  }; \
+  debug_format_to<DebugFmtLiteral>(out, ##__VA_ARGS__); \
+} while(0)
+
+#endif  // DEBUG_FORMATTER_H
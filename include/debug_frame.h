@@ -0,0 +1,48 @@
+/**
+ * @file debug_frame.h
+ * @brief Binary frame format shared by all non-text debug output
+ *
+ * Frames are embedded in the normal output stream:
+ *   [0x1E mark][kind][payload length][payload ...]
+ * Plain text never contains 0x1E, so host tools (debug_decode.h) can split
+ * a capture into text and frames.
+ */
+
+#ifndef DEBUG_FRAME_H
+#define DEBUG_FRAME_H
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#define DEBUG_FRAME_MARK 0x1E  // ASCII record separator - never produced by text output
+#define DEBUG_FRAME_MAX 255    // Largest payload (length is one byte)
+
+enum DebugFrameKind : uint8_t {
+  DEBUG_FRAME_DEFERRED = 1,     // debugf: format address + args (debug_deferred.h)
+  DEBUG_FRAME_DEFERRED_LN = 2,  // debugfln/debug_if: same, decoder appends newline
+  DEBUG_FRAME_TOKEN = 3,        // Tokenized (debug_token.h): token + args
+  DEBUG_FRAME_TOKEN_LN = 4,     // Tokenized, decoder appends newline
+  DEBUG_FRAME_TRACE_INFO = 5,   // Trace header: u32 cycles per microsecond (debug_trace.h)
+  DEBUG_FRAME_TRACE_NAME = 6,   // Trace scope name: u8 id + text
+  DEBUG_FRAME_TRACE_TASK = 7,   // Trace task name: u8 id + text
+  DEBUG_FRAME_TRACE_EVENTS = 8, // Packed 8-byte trace events
+  DEBUG_FRAME_TRACE_CLOCK = 9   // Per-core clock anchor: u8 core, u32 cycles, u64 microseconds
+};
+
+/**
+ * Write a frame with header and payload in a single out.write() call
+ * (so frames stay whole in the async ring buffer)
+ */
+template <typename Out>
+inline void debug_frame_write(Out& out, uint8_t kind, const void* payload, size_t len) {
+  uint8_t frame[3 + DEBUG_FRAME_MAX];
+  if (len > DEBUG_FRAME_MAX) len = DEBUG_FRAME_MAX;
+  frame[0] = DEBUG_FRAME_MARK;
+  frame[1] = kind;
+  frame[2] = (uint8_t)len;
+  for (size_t i = 0; i < len; i++) frame[3 + i] = ((const uint8_t*)payload)[i];
+  out.write(frame, len + 3);
+}
+
+#endif  // DEBUG_FRAME_H
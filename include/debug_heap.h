@@ -0,0 +1,447 @@
+/**
+ * @file debug_heap.h
+ * @brief Heap allocation tracker with per-call-site statistics (DEBUG_HEAP=1)
+ *
+ * malloc/calloc/realloc/free and operator new/delete are hooked, and
+ * every live block is recorded with the return address of its caller.
+ * debug_heap_report() then lists, per call site, the live bytes and
+ * blocks, the peak and the alloc/free counts. A site whose live bytes
+ * only ever grow is a leak; many short-lived blocks from one site
+ * fragment the heap.
+ *
+ * Hooks:
+ *   ESP32 - the linker redirects the allocator to __wrap_* (add to
+ *           build_flags: -Wl,--wrap=malloc,--wrap=free,--wrap=calloc,--wrap=realloc)
+ *   host  - malloc and friends are interposed and forward to glibc's
+ *           __libc_* entry points
+ * operator new/delete are replaced on both, so a `new` is attributed to
+ * the caller of new, not to the runtime's operator new.
+ *
+ * Memory is fixed: two open-addressing tables (linear probing), one of
+ * call sites (DEBUG_HEAP_SITES) and one of live blocks (DEBUG_HEAP_BLOCKS,
+ * ~12 bytes each on the ESP32). When the block table is full, new blocks
+ * are counted as untracked; when the site table is full, new sites are
+ * pooled as "(other)". The tracker never allocates, and a thread-local
+ * guard lets allocations made while it runs (e.g. printf in the report)
+ * pass straight through; frees of tracked blocks are still recorded.
+ *
+ * Resolve the addresses with addr2line:
+ *   xtensa-esp32-elf-addr2line -pfiaC -e .pio/build/esp32dev/firmware.elf 0x400d1a2b
+ */
+
+#ifndef DEBUG_HEAP_H
+#define DEBUG_HEAP_H
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include "debug_ring.h"
+
+#if defined(ESP_PLATFORM)
+#include <esp_heap_caps.h>
+#endif
+
+#ifndef DEBUG_HEAP_SITES
+#define DEBUG_HEAP_SITES 128  // Call sites tracked (power of two)
+#endif
+
+#ifndef DEBUG_HEAP_BLOCKS
+#define DEBUG_HEAP_BLOCKS 2048  // Live blocks tracked (power of two)
+#endif
+
+#ifndef DEBUG_HEAP_REPORT_TOP
+#define DEBUG_HEAP_REPORT_TOP 16  // Sites listed by debug_heap_report(), by live bytes
+#endif
+
+// ============================================================================
+// TABLES
+// ============================================================================
+
+struct DebugHeapSite {
+  uintptr_t site;   // Caller return address; 0 = "(other)" once the table is full
+  size_t live;      // Bytes allocated here and not yet freed
+  size_t peak;      // Highest live
+  uint32_t blocks;  // Blocks allocated here and not yet freed
+  uint32_t allocs;
+  uint32_t frees;
+};
+
+struct DebugHeapBlock {
+  uintptr_t ptr;  // 0 = empty slot
+  uint32_t size;
+  uint16_t site;  // Index into the site table
+};
+
+struct DebugHeapTotals {
+  size_t live;
+  size_t peak;
+  uint32_t blocks;
+  uint32_t allocs;
+  uint32_t frees;
+  uint32_t failed;     // Allocations that returned NULL
+  uint32_t untracked;  // Blocks not recorded because the block table was full
+};
+
+class DebugHeapTable {
+  static_assert((DEBUG_HEAP_SITES & (DEBUG_HEAP_SITES - 1)) == 0, "DEBUG_HEAP_SITES must be a power of two");
+  static_assert((DEBUG_HEAP_BLOCKS & (DEBUG_HEAP_BLOCKS - 1)) == 0, "DEBUG_HEAP_BLOCKS must be a power of two");
+
+ public:
+  DebugHeapTable() : sites_used_(0), blocks_used_(0) {
+    memset(sites_, 0, sizeof(sites_));
+    memset(blocks_, 0, sizeof(blocks_));
+    memset(&totals_, 0, sizeof(totals_));
+  }
+
+  /** Record a block returned by the allocator (ptr NULL: a failed call) */
+  void on_alloc(void* ptr, size_t size, uintptr_t site) {
+    lock_.lock();
+    if (!ptr) {
+      if (size) totals_.failed++;
+    } else {
+      uint16_t s = find_site(site);
+      sites_[s].allocs++;
+      totals_.allocs++;
+      DebugHeapBlock b = {(uintptr_t)ptr, (uint32_t)size, s};
+      if (insert(b)) {
+        add(b);
+      } else {
+        totals_.untracked++;
+      }
+    }
+    lock_.unlock();
+  }
+
+  /**
+   * Forget a block before it goes back to the allocator; false if it was
+   * not tracked. The removed entry is stored in *out when given.
+   */
+  bool on_free(void* ptr, DebugHeapBlock* out) {
+    lock_.lock();
+    DebugHeapBlock b;
+    bool found = erase((uintptr_t)ptr, &b);
+    if (found) {
+      DebugHeapSite& s = sites_[b.site];
+      s.live -= b.size;
+      s.blocks--;
+      s.frees++;
+      totals_.live -= b.size;
+      totals_.blocks--;
+      totals_.frees++;
+      if (out) *out = b;
+    }
+    lock_.unlock();
+    return found;
+  }
+
+  /** Put back a block removed by on_free() (realloc that failed) */
+  void restore(const DebugHeapBlock& b) {
+    lock_.lock();
+    if (insert(b)) {
+      sites_[b.site].frees--;
+      totals_.frees--;
+      add(b);
+    }
+    lock_.unlock();
+  }
+
+  /** Copy of site slot i (0 .. DEBUG_HEAP_SITES); false if unused */
+  bool site(size_t i, DebugHeapSite* out) {
+    lock_.lock();
+    *out = sites_[i];
+    lock_.unlock();
+    return out->allocs != 0;
+  }
+
+  DebugHeapTotals totals() {
+    lock_.lock();
+    DebugHeapTotals t = totals_;
+    lock_.unlock();
+    return t;
+  }
+
+  /** Restart peak tracking from the current live bytes */
+  void reset_peak() {
+    lock_.lock();
+    for (size_t i = 0; i <= DEBUG_HEAP_SITES; i++) sites_[i].peak = sites_[i].live;
+    totals_.peak = totals_.live;
+    lock_.unlock();
+  }
+
+  static size_t slots() { return DEBUG_HEAP_SITES + 1; }  // Including "(other)"
+
+ private:
+  static uint32_t hash(uintptr_t v) {
+    uint32_t h = (uint32_t)(v >> 2) ^ (uint32_t)((uint64_t)v >> 32);
+    h *= 0x9E3779B1u;
+    return h ^ (h >> 15);
+  }
+
+  void add(const DebugHeapBlock& b) {
+    DebugHeapSite& s = sites_[b.site];
+    s.live += b.size;
+    s.blocks++;
+    if (s.live > s.peak) s.peak = s.live;
+    totals_.live += b.size;
+    totals_.blocks++;
+    if (totals_.live > totals_.peak) totals_.peak = totals_.live;
+  }
+
+  /** Slot of site, claimed on first use; the overflow slot when 7/8 full */
+  uint16_t find_site(uintptr_t site) {
+    const uint32_t mask = DEBUG_HEAP_SITES - 1;
+    for (uint32_t i = hash(site) & mask;; i = (i + 1) & mask) {
+      if (sites_[i].site == site && sites_[i].allocs) return (uint16_t)i;
+      if (!sites_[i].allocs) {
+        if (sites_used_ >= DEBUG_HEAP_SITES / 8 * 7) return DEBUG_HEAP_SITES;
+        sites_used_++;
+        sites_[i].site = site;
+        return (uint16_t)i;
+      }
+    }
+  }
+
+  /** Add to the block table; false when it is 7/8 full */
+  bool insert(const DebugHeapBlock& b) {
+    const uint32_t mask = DEBUG_HEAP_BLOCKS - 1;
+    if (blocks_used_ >= DEBUG_HEAP_BLOCKS / 8 * 7) return false;
+    uint32_t i = hash(b.ptr) & mask;
+    while (blocks_[i].ptr) i = (i + 1) & mask;
+    blocks_[i] = b;
+    blocks_used_++;
+    return true;
+  }
+
+  /**
+   * Remove ptr with backward-shift deletion: later entries of the probe
+   * chain move up into the hole, so lookups never need tombstones
+   */
+  bool erase(uintptr_t ptr, DebugHeapBlock* out) {
+    const uint32_t mask = DEBUG_HEAP_BLOCKS - 1;
+    uint32_t i = hash(ptr) & mask;
+    while (blocks_[i].ptr != ptr) {
+      if (!blocks_[i].ptr) return false;
+      i = (i + 1) & mask;
+    }
+    *out = blocks_[i];
+    for (uint32_t j = (i + 1) & mask; blocks_[j].ptr; j = (j + 1) & mask) {
+      uint32_t home = hash(blocks_[j].ptr) & mask;
+      bool stays = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+      if (stays) continue;
+      blocks_[i] = blocks_[j];
+      i = j;
+    }
+    blocks_[i].ptr = 0;
+    blocks_used_--;
+    return true;
+  }
+
+  DebugSpinLock lock_;
+  DebugHeapSite sites_[DEBUG_HEAP_SITES + 1];  // Last slot: "(other)"
+  DebugHeapBlock blocks_[DEBUG_HEAP_BLOCKS];
+  uint32_t sites_used_;
+  uint32_t blocks_used_;
+  DebugHeapTotals totals_;
+};
+
+/**
+ * Reentrancy guard: set while this thread is inside the tracker, so
+ * allocations it causes go straight to the allocator
+ */
+inline bool& debug_heap_busy() {
+  static thread_local bool busy = false;
+  return busy;
+}
+
+struct DebugHeapGuard {
+  DebugHeapGuard() : entered(!debug_heap_busy()) { debug_heap_busy() = true; }
+  ~DebugHeapGuard() {
+    if (entered) debug_heap_busy() = false;
+  }
+  bool entered;  // False when nested: record no new blocks (frees still erase)
+};
+
+/**
+ * The table (statically allocated on first use, inside the guard, so
+ * allocations made by its initialization are not tracked)
+ */
+inline DebugHeapTable& debug_heap_table() {
+  static DebugHeapTable table;
+  return table;
+}
+
+// ============================================================================
+// TRACKED ALLOCATOR - Called by the hooks with the caller's return address
+// ============================================================================
+
+#if defined(ESP_PLATFORM)
+extern "C" void* __real_malloc(size_t size);
+extern "C" void* __real_calloc(size_t count, size_t size);
+extern "C" void* __real_realloc(void* ptr, size_t size);
+extern "C" void __real_free(void* ptr);
+#define DEBUG_HEAP_REAL(fn) __real_##fn
+#elif defined(__GLIBC__)
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+extern "C" void __libc_free(void* ptr);
+#define DEBUG_HEAP_REAL(fn) __libc_##fn
+#else
+#error "DEBUG_HEAP needs the ESP32 linker wrap or a glibc host"
+#endif
+
+inline void* debug_heap_malloc(size_t size, void* site) {
+  void* p = DEBUG_HEAP_REAL(malloc)(size);
+  DebugHeapGuard guard;
+  if (guard.entered) debug_heap_table().on_alloc(p, size, (uintptr_t)site);
+  return p;
+}
+
+inline void* debug_heap_calloc(size_t count, size_t size, void* site) {
+  void* p = DEBUG_HEAP_REAL(calloc)(count, size);
+  DebugHeapGuard guard;
+  if (guard.entered) debug_heap_table().on_alloc(p, count * size, (uintptr_t)site);
+  return p;
+}
+
+/**
+ * The block is untracked before the allocator sees it, so another task
+ * that is handed the same address cannot be confused with it. This also
+ * happens when nested (the tracker never holds its lock while allocating):
+ * a tracked block freed from inside the report must not stay in the table,
+ * or its address would later be inserted twice.
+ */
+inline void debug_heap_free(void* ptr) {
+  if (ptr) {
+    DebugHeapGuard guard;
+    debug_heap_table().on_free(ptr, NULL);
+  }
+  DEBUG_HEAP_REAL(free)(ptr);
+}
+
+inline void* debug_heap_realloc(void* ptr, size_t size, void* site) {
+  DebugHeapGuard guard;
+  DebugHeapBlock old;
+  bool tracked = ptr && debug_heap_table().on_free(ptr, &old);
+  void* p = DEBUG_HEAP_REAL(realloc)(ptr, size);
+  if (!p && size && tracked) debug_heap_table().restore(old);               // Failed: the old block is still live
+  if (guard.entered) debug_heap_table().on_alloc(p, size, (uintptr_t)site);  // NULL counts as failed unless size is 0
+  return p;
+}
+
+[[noreturn]] inline void debug_heap_out_of_memory() {
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS)
+  throw std::bad_alloc();
+#else
+  abort();
+#endif
+}
+
+// ============================================================================
+// HOOKS - Weak so every translation unit may include this header
+// ============================================================================
+
+extern "C" {
+#if defined(ESP_PLATFORM)
+__attribute__((weak)) void* __wrap_malloc(size_t size) {
+  return debug_heap_malloc(size, __builtin_return_address(0));
+}
+__attribute__((weak)) void* __wrap_calloc(size_t count, size_t size) {
+  return debug_heap_calloc(count, size, __builtin_return_address(0));
+}
+__attribute__((weak)) void* __wrap_realloc(void* ptr, size_t size) {
+  return debug_heap_realloc(ptr, size, __builtin_return_address(0));
+}
+__attribute__((weak)) void __wrap_free(void* ptr) { debug_heap_free(ptr); }
+#else
+__attribute__((weak)) void* malloc(size_t size) { return debug_heap_malloc(size, __builtin_return_address(0)); }
+__attribute__((weak)) void* calloc(size_t count, size_t size) {
+  return debug_heap_calloc(count, size, __builtin_return_address(0));
+}
+__attribute__((weak)) void* realloc(void* ptr, size_t size) {
+  return debug_heap_realloc(ptr, size, __builtin_return_address(0));
+}
+__attribute__((weak)) void free(void* ptr) { debug_heap_free(ptr); }
+#endif
+}
+
+__attribute__((weak)) void* operator new(size_t size) {
+  void* p = debug_heap_malloc(size ? size : 1, __builtin_return_address(0));
+  if (!p) debug_heap_out_of_memory();
+  return p;
+}
+__attribute__((weak)) void* operator new[](size_t size) {
+  void* p = debug_heap_malloc(size ? size : 1, __builtin_return_address(0));
+  if (!p) debug_heap_out_of_memory();
+  return p;
+}
+__attribute__((weak)) void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return debug_heap_malloc(size ? size : 1, __builtin_return_address(0));
+}
+__attribute__((weak)) void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return debug_heap_malloc(size ? size : 1, __builtin_return_address(0));
+}
+__attribute__((weak)) void operator delete(void* ptr) noexcept { debug_heap_free(ptr); }
+__attribute__((weak)) void operator delete[](void* ptr) noexcept { debug_heap_free(ptr); }
+
+// ============================================================================
+// REPORT
+// ============================================================================
+
+/**
+ * Totals, then up to DEBUG_HEAP_REPORT_TOP sites by live bytes:
+ *   [HEAP] live 5120 B in 12 blocks, peak 9216 B, 340 allocs, 328 frees
+ *   [HEAP] site               live B   peak B  blocks   allocs    frees
+ *   [HEAP] 0x400d1a2b           4096     8192       4      170      166
+ */
+template <typename Out>
+inline void debug_heap_print(Out& out) {
+  DebugHeapGuard guard;  // Allocations made while printing are not counted
+  DebugHeapTable& table = debug_heap_table();
+  DebugHeapTotals t = table.totals();
+  out.printf("[HEAP] live %lu B in %lu blocks, peak %lu B, %lu allocs, %lu frees", (unsigned long)t.live,
+             (unsigned long)t.blocks, (unsigned long)t.peak, (unsigned long)t.allocs, (unsigned long)t.frees);
+  if (t.failed) out.printf(", %lu failed", (unsigned long)t.failed);
+  if (t.untracked) out.printf(", %lu untracked", (unsigned long)t.untracked);
+  out.printf("\n");
+#if defined(ESP_PLATFORM)
+  out.printf("[HEAP] free %lu B, largest free block %lu B, minimum free %lu B\n",
+             (unsigned long)heap_caps_get_free_size(MALLOC_CAP_8BIT),
+             (unsigned long)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT),
+             (unsigned long)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+#endif
+  out.printf("[HEAP] %-18s %8s %8s %7s %8s %8s\n", "site", "live B", "peak B", "blocks", "allocs", "frees");
+
+  // Selection by live bytes (then slot index) without a sort buffer
+  size_t prev_live = (size_t)-1;
+  size_t prev_slot = 0;
+  for (int n = 0; n < DEBUG_HEAP_REPORT_TOP; n++) {
+    DebugHeapSite best = DebugHeapSite();
+    size_t best_slot = DebugHeapTable::slots();
+    for (size_t i = 0; i < DebugHeapTable::slots(); i++) {
+      DebugHeapSite s;
+      if (!table.site(i, &s)) continue;
+      bool after_prev = s.live < prev_live || (s.live == prev_live && i > prev_slot);
+      bool better = best_slot == DebugHeapTable::slots() || s.live > best.live;
+      if (after_prev && better) {
+        best = s;
+        best_slot = i;
+      }
+    }
+    if (best_slot == DebugHeapTable::slots()) break;
+    if (best_slot == DEBUG_HEAP_SITES) {
+      out.printf("[HEAP] %-18s", "(other)");
+    } else {
+      out.printf("[HEAP] 0x%-16lx", (unsigned long)best.site);
+    }
+    out.printf(" %8lu %8lu %7lu %8lu %8lu\n", (unsigned long)best.live, (unsigned long)best.peak,
+               (unsigned long)best.blocks, (unsigned long)best.allocs, (unsigned long)best.frees);
+    prev_live = best.live;
+    prev_slot = best_slot;
+  }
+}
+
+#endif  // DEBUG_HEAP_H
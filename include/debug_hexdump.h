@@ -0,0 +1,93 @@
+/**
+ * @file debug_hexdump.h
+ * @brief Table-driven hex dump used by debug_array()
+ *
+ * Each 16-byte row (offset, hex bytes, ASCII column) is assembled in a
+ * stack buffer with a nibble lookup table, reading the input a 32-bit word
+ * at a time, and handed to the output in a single write() - one call per
+ * row instead of one printf per byte.
+ *
+ * Output:
+ *   0000: 42 12 34 56 78 9A BC DE 48 65 6C 6C 6F 00 01 02  |B.4Vx...Hello...|
+ */
+
+#ifndef DEBUG_HEXDUMP_H
+#define DEBUG_HEXDUMP_H
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define DEBUG_HEXDUMP_ROW 16
+
+// Longest row: 8 offset digits + ": " + 16 * 3 + " |" + 16 + "|\n"
+#define DEBUG_HEXDUMP_LINE_MAX (8 + 2 + DEBUG_HEXDUMP_ROW * 3 + 2 + DEBUG_HEXDUMP_ROW + 2)
+
+static const char debug_hex_digits[] = "0123456789ABCDEF";
+
+/**
+ * Write "XX " for one byte
+ */
+inline char* debug_hexdump_byte(char* p, uint32_t b) {
+  p[0] = debug_hex_digits[(b >> 4) & 0xF];
+  p[1] = debug_hex_digits[b & 0xF];
+  p[2] = ' ';
+  return p + 3;
+}
+
+/**
+ * Format one row of up to 16 bytes into line; returns its length.
+ * offset_digits is 4 or 8.
+ */
+inline size_t debug_hexdump_row(char* line, const uint8_t* data, size_t n, uint32_t offset,
+                                int offset_digits) {
+  char* p = line;
+  for (int shift = (offset_digits - 1) * 4; shift >= 0; shift -= 4) {
+    *p++ = debug_hex_digits[(offset >> shift) & 0xF];
+  }
+  *p++ = ':';
+  *p++ = ' ';
+
+  // Hex column: whole 32-bit words first, then the remainder
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    uint32_t w;
+    memcpy(&w, data + i, 4);  // Unaligned-safe load; little-endian byte order
+    p = debug_hexdump_byte(p, w);
+    p = debug_hexdump_byte(p, w >> 8);
+    p = debug_hexdump_byte(p, w >> 16);
+    p = debug_hexdump_byte(p, w >> 24);
+  }
+  for (; i < n; i++) p = debug_hexdump_byte(p, data[i]);
+  memset(p, ' ', (DEBUG_HEXDUMP_ROW - n) * 3);  // Pad short rows so ASCII aligns
+  p += (DEBUG_HEXDUMP_ROW - n) * 3;
+
+  // ASCII column
+  *p++ = ' ';
+  *p++ = '|';
+  for (i = 0; i < n; i++) {
+    uint8_t c = data[i];
+    *p++ = (c >= 0x20 && c < 0x7F) ? (char)c : '.';
+  }
+  *p++ = '|';
+  *p++ = '\n';
+  return (size_t)(p - line);
+}
+
+/**
+ * Dump len bytes from data to out, one write() per row
+ */
+template <typename Out>
+inline void debug_hexdump(Out& out, const void* data, size_t len) {
+  const uint8_t* bytes = (const uint8_t*)data;
+  int offset_digits = len > 0x10000 ? 8 : 4;
+  char line[DEBUG_HEXDUMP_LINE_MAX];
+  for (size_t off = 0; off < len; off += DEBUG_HEXDUMP_ROW) {
+    size_t n = len - off < DEBUG_HEXDUMP_ROW ? len - off : DEBUG_HEXDUMP_ROW;
+    size_t line_len = debug_hexdump_row(line, bytes + off, n, (uint32_t)off, offset_digits);
+    out.write((const uint8_t*)line, line_len);
+  }
+}
+
+#endif  // DEBUG_HEXDUMP_H
@@ -0,0 +1,256 @@
+/**
+ * @file debug_isr.h
+ * @brief ISR-safe logging: fixed-size binary records, formatted later
+ *
+ * debug_isr("msg") and debugf_isr(fmt, ...) never format, lock or
+ * allocate. They copy the format pointer, up to DEBUG_ISR_ARGS word-sized
+ * arguments and a cycle timestamp into a lock-free single-producer ring.
+ * There is one ring per (core, interrupt level): an interrupt can only be
+ * preempted by a higher level, so each ring has exactly one writer at a
+ * time. Task-context calls briefly mask interrupts up to the highest
+ * supported level and use that ring.
+ *
+ * debug_isr_drain() formats the records from task context (call it from
+ * loop() or any low-priority task).
+ *
+ * Arguments must be integers of at most 32 bits, chars, bools or pointers
+ * (e.g. literal strings); each is stored in one record word. Floating point
+ * is rejected at compile time because the FPU context is not saved in
+ * ESP32 interrupt handlers, and 64-bit integers because they would be
+ * truncated (with DEBUG_FMT_CHECK, %f and %lld in the format are rejected
+ * too).
+ */
+
+#ifndef DEBUG_ISR_H
+#define DEBUG_ISR_H
+
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <type_traits>
+
+#if defined(ESP_PLATFORM)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+#ifndef DEBUG_ISR_DEPTH
+#define DEBUG_ISR_DEPTH 32  // Records per ring (power of two)
+#endif
+
+#ifndef DEBUG_ISR_LEVELS
+#define DEBUG_ISR_LEVELS 3  // Interrupt levels 1..N (C handlers use 1-3 on ESP32)
+#endif
+
+#ifndef DEBUG_ISR_ARGS
+#define DEBUG_ISR_ARGS 4
+#endif
+
+#ifndef DEBUG_ISR_MEASURE
+#define DEBUG_ISR_MEASURE 0  // Track worst-case cycles spent in the write path
+#endif
+
+#if defined(ESP_PLATFORM)
+#define DEBUG_ISR_CORES portNUM_PROCESSORS
+#else
+#define DEBUG_ISR_CORES 1
+#endif
+
+#if defined(ESP_PLATFORM)
+#define DEBUG_ISR_INLINE inline __attribute__((always_inline))  // Stay in the caller's IRAM
+#else
+#define DEBUG_ISR_INLINE inline
+#endif
+
+static_assert((DEBUG_ISR_DEPTH & (DEBUG_ISR_DEPTH - 1)) == 0, "DEBUG_ISR_DEPTH must be a power of two");
+
+// ============================================================================
+// RECORDS AND RINGS
+// ============================================================================
+
+typedef uintptr_t DebugIsrArg;  // 32 bits on ESP32; holds a pointer on 64-bit hosts
+
+struct DebugIsrRecord {
+  uint32_t cycles;
+  const char* fmt;
+  DebugIsrArg args[DEBUG_ISR_ARGS];
+};
+
+struct DebugIsrRing {
+  DebugIsrRecord records[DEBUG_ISR_DEPTH];
+  std::atomic<uint32_t> head;  // Written by the producer only
+  std::atomic<uint32_t> tail;  // Written by the drain only
+  uint32_t dropped;            // Producer only
+  uint32_t max_cycles;         // Producer only (DEBUG_ISR_MEASURE)
+};
+
+// Forced inline: an out-of-line copy could land in flash and be called
+// from an IRAM ISR while the cache is disabled. The array itself is .bss.
+DEBUG_ISR_INLINE DebugIsrRing* debug_isr_rings() {
+  static DebugIsrRing rings[DEBUG_ISR_CORES * DEBUG_ISR_LEVELS];
+  return rings;
+}
+
+DEBUG_ISR_INLINE uint32_t debug_isr_cycles() {
+#if defined(__XTENSA__)
+  uint32_t ccount;
+  __asm__ __volatile__("rsr %0, ccount" : "=a"(ccount));
+  return ccount;
+#elif defined(__x86_64__) || defined(__i386__)
+  return (uint32_t)__builtin_ia32_rdtsc();  // Host: TSC ticks for DEBUG_ISR_MEASURE
+#else
+  static std::atomic<uint32_t> seq(0);  // Ordering only; no cycle counter
+  return seq.fetch_add(1, std::memory_order_relaxed);
+#endif
+}
+
+/**
+ * Current interrupt level (0 = task context with interrupts enabled)
+ */
+DEBUG_ISR_INLINE uint32_t debug_isr_level() {
+#if defined(__XTENSA__)
+  uint32_t ps;
+  __asm__ __volatile__("rsr %0, ps" : "=a"(ps));
+  return ps & 0xF;
+#elif defined(ESP_PLATFORM)
+  return xPortInIsrContext() ? 1 : 0;
+#else
+  return 1;  // Host: no interrupts; callers must be a single thread
+#endif
+}
+
+// ============================================================================
+// PRODUCER (ISR SIDE)
+// ============================================================================
+
+template <typename T>
+DEBUG_ISR_INLINE DebugIsrArg debug_isr_arg(T value) {
+  static_assert(!std::is_floating_point<T>::value,
+                "debugf_isr: floating-point arguments are not ISR-safe");
+  static_assert(!(std::is_integral<T>::value || std::is_enum<T>::value) || sizeof(T) <= 4,
+                "debugf_isr: 64-bit integer arguments do not fit a record word");
+  return (DebugIsrArg)value;
+}
+
+DEBUG_ISR_INLINE void debug_isr_fill(DebugIsrArg*, int) {}
+
+template <typename T, typename... Rest>
+DEBUG_ISR_INLINE void debug_isr_fill(DebugIsrArg* args, int i, T first, Rest... rest) {
+  if (i < DEBUG_ISR_ARGS) args[i] = debug_isr_arg(first);
+  debug_isr_fill(args, i + 1, rest...);
+}
+
+template <typename... Args>
+DEBUG_ISR_INLINE void debug_isr_write(const char* fmt, Args... args) {
+  static_assert(sizeof...(Args) <= DEBUG_ISR_ARGS, "debugf_isr: too many arguments (DEBUG_ISR_ARGS)");
+  uint32_t start = debug_isr_cycles();
+  uint32_t level = debug_isr_level();
+
+#if defined(ESP_PLATFORM)
+  uint32_t saved = 0;
+  bool masked = level == 0;
+  if (masked) {
+    saved = portSET_INTERRUPT_MASK_FROM_ISR();  // Becomes the sole writer at that level
+    level = DEBUG_ISR_LEVELS;
+  }
+  uint32_t core = xPortGetCoreID();
+#else
+  uint32_t core = 0;
+  if (level == 0) level = DEBUG_ISR_LEVELS;
+#endif
+
+  if (level <= DEBUG_ISR_LEVELS) {
+    DebugIsrRing& r = debug_isr_rings()[core * DEBUG_ISR_LEVELS + level - 1];
+    uint32_t head = r.head.load(std::memory_order_relaxed);
+    if (head - r.tail.load(std::memory_order_acquire) >= DEBUG_ISR_DEPTH) {
+      r.dropped++;
+    } else {
+      DebugIsrRecord& rec = r.records[head & (DEBUG_ISR_DEPTH - 1)];
+      rec.cycles = start;
+      rec.fmt = fmt;
+      debug_isr_fill(rec.args, 0, args...);
+      r.head.store(head + 1, std::memory_order_release);
+    }
+#if DEBUG_ISR_MEASURE == 1
+    uint32_t spent = debug_isr_cycles() - start;
+    if (spent > r.max_cycles) r.max_cycles = spent;
+#endif
+  }
+
+#if defined(ESP_PLATFORM)
+  if (masked) portCLEAR_INTERRUPT_MASK_FROM_ISR(saved);
+#endif
+}
+
+// ============================================================================
+// CONSUMER (TASK SIDE)
+// ============================================================================
+
+/**
+ * snprintf with all DEBUG_ISR_ARGS record words as arguments, in order
+ */
+template <int N>
+struct DebugIsrFormat {
+  template <typename... Unpacked>
+  static int print(char* buf, size_t size, const char* fmt, const DebugIsrArg* args, Unpacked... unpacked) {
+    return DebugIsrFormat<N - 1>::print(buf, size, fmt, args, unpacked..., args[sizeof...(Unpacked)]);
+  }
+};
+
+template <>
+struct DebugIsrFormat<0> {
+  template <typename... Unpacked>
+  static int print(char* buf, size_t size, const char* fmt, const DebugIsrArg*, Unpacked... unpacked) {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#pragma GCC diagnostic ignored "-Wformat-security"
+    return snprintf(buf, size, fmt, unpacked...);
+#pragma GCC diagnostic pop
+  }
+};
+
+/**
+ * Format and print all pending records as
+ *   "[ISR c<core> L<level> @<cycles>] message"
+ * Call from task context only; returns the number of records printed.
+ */
+template <typename Out>
+inline size_t debug_isr_print(Out& out) {
+  size_t printed = 0;
+  char line[128];
+  for (uint32_t i = 0; i < DEBUG_ISR_CORES * DEBUG_ISR_LEVELS; i++) {
+    DebugIsrRing& r = debug_isr_rings()[i];
+    uint32_t tail = r.tail.load(std::memory_order_relaxed);
+    while (tail != r.head.load(std::memory_order_acquire)) {
+      const DebugIsrRecord& rec = r.records[tail & (DEBUG_ISR_DEPTH - 1)];
+      int n = snprintf(line, sizeof(line), "[ISR c%u L%u @%lu] ", (unsigned)(i / DEBUG_ISR_LEVELS),
+                       (unsigned)(i % DEBUG_ISR_LEVELS + 1), (unsigned long)rec.cycles);
+      n += DebugIsrFormat<DEBUG_ISR_ARGS>::print(line + n, sizeof(line) - n - 1, rec.fmt, rec.args);
+      if (n > (int)sizeof(line) - 2) n = sizeof(line) - 2;
+      line[n++] = '\n';
+      out.write((const uint8_t*)line, (size_t)n);
+      r.tail.store(++tail, std::memory_order_release);
+      printed++;
+    }
+  }
+  return printed;
+}
+
+/**
+ * Print per-ring drop counts and (with DEBUG_ISR_MEASURE=1) the
+ * worst-case cycles spent in debugf_isr
+ */
+template <typename Out>
+inline void debug_isr_stats(Out& out) {
+  for (uint32_t i = 0; i < DEBUG_ISR_CORES * DEBUG_ISR_LEVELS; i++) {
+    DebugIsrRing& r = debug_isr_rings()[i];
+    if (!r.head.load(std::memory_order_relaxed) && !r.dropped) continue;
+    out.printf("[ISR] core %u level %u: %lu logged, %lu dropped, worst %lu cycles\n",
+               (unsigned)(i / DEBUG_ISR_LEVELS), (unsigned)(i % DEBUG_ISR_LEVELS + 1),
+               (unsigned long)r.head.load(std::memory_order_relaxed), (unsigned long)r.dropped,
+               (unsigned long)r.max_cycles);
+  }
+}
+
+#endif  // DEBUG_ISR_H
@@ -0,0 +1,198 @@
+/**
+ * @file debug_native.h
+ * @brief Minimal Arduino shim for host-native (Linux/macOS) builds
+ *
+ * debug.h includes this instead of <Arduino.h> when ARDUINO is not
+ * defined, so the library can be compiled, tested and benchmarked on a
+ * developer machine (PlatformIO "native" platform or plain g++).
+ *
+ * Provides Print, a Serial object that captures output in memory,
+ * micros(), millis(), delay() and delayMicroseconds().
+ *
+ * Usage:
+ *   g++ -std=gnu++11 -Iinclude test.cpp
+ *
+ *   debugf("x=%d\n", 1);
+ *   assert(Serial.output() == "x=1\n");
+ *   Serial.clear();
+ */
+
+#ifndef DEBUG_NATIVE_H
+#define DEBUG_NATIVE_H
+
+#pragma once
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+// ============================================================================
+// TIME
+// ============================================================================
+
+inline uint64_t debug_native_now_us() {
+  static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - start).count();
+}
+
+inline unsigned long micros() { return (unsigned long)debug_native_now_us(); }
+inline unsigned long millis() { return (unsigned long)(debug_native_now_us() / 1000); }
+inline void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+inline void delayMicroseconds(unsigned int us) {
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+inline void yield() { std::this_thread::yield(); }
+
+// ============================================================================
+// PRINT - Same interface as the ESP32 Arduino core's Print class
+// ============================================================================
+
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) n += write(*buffer++);
+    return n;
+  }
+  virtual void flush() {}
+
+  size_t write(const char* str) { return str ? write((const uint8_t*)str, strlen(str)) : 0; }
+  size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); }
+
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+    char small[64];
+    va_list args;
+    va_start(args, format);
+    va_list copy;
+    va_copy(copy, args);
+    int len = vsnprintf(small, sizeof(small), format, copy);
+    va_end(copy);
+    size_t n = 0;
+    if (len >= 0 && (size_t)len < sizeof(small)) {
+      n = write((const uint8_t*)small, (size_t)len);
+    } else if (len > 0) {
+      std::string big((size_t)len + 1, '\0');
+      vsnprintf(&big[0], big.size(), format, args);
+      n = write((const uint8_t*)big.data(), (size_t)len);
+    }
+    va_end(args);
+    return n;
+  }
+
+  size_t print(const char* s) { return write(s); }
+  size_t print(const std::string& s) { return write(s.data(), s.size()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char b, int base = DEC) { return print((unsigned long)b, base); }
+  size_t print(int n, int base = DEC) { return print((long)n, base); }
+  size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+  size_t print(long n, int base = DEC) {
+    if (base == DEC && n < 0) return print('-') + number((unsigned long long)-(long long)n, DEC);
+    return number((unsigned long)n, base);
+  }
+  size_t print(unsigned long n, int base = DEC) { return number(n, base); }
+  size_t print(long long n, int base = DEC) {
+    if (base == DEC && n < 0) return print('-') + number(0ULL - (unsigned long long)n, DEC);
+    return number((unsigned long long)n, base);
+  }
+  size_t print(unsigned long long n, int base = DEC) { return number(n, base); }
+  size_t print(double n, int digits = 2) { return printf("%.*f", digits, n); }
+  size_t print(bool b) { return print((int)b); }
+
+  size_t println() { return write("\r\n"); }
+  template <typename T>
+  size_t println(const T& value) {
+    size_t n = print(value);
+    return n + println();
+  }
+  template <typename T>
+  size_t println(const T& value, int format) {
+    size_t n = print(value, format);
+    return n + println();
+  }
+
+ private:
+  size_t number(unsigned long long n, int base) {
+    char buf[65];
+    char* p = buf + sizeof(buf) - 1;
+    *p = '\0';
+    if (base < 2) base = 10;
+    do {
+      int digit = (int)(n % base);
+      *--p = (char)(digit < 10 ? '0' + digit : 'A' + digit - 10);
+      n /= base;
+    } while (n);
+    return write(p);
+  }
+};
+
+// ============================================================================
+// SERIAL - Captures output in memory; input can be injected for tests
+// ============================================================================
+
+class DebugNativeSerial : public Print {
+ public:
+  DebugNativeSerial() : echo_(false) {}
+
+  void begin(unsigned long) {}
+  void end() {}
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* buffer, size_t size) override {
+    output_.append((const char*)buffer, size);
+    if (echo_) fwrite(buffer, 1, size, stdout);
+    return size;
+  }
+  using Print::write;
+
+  // Echoed bytes sit in stdio's buffer; push them out like a UART drain
+  void flush() override {
+    if (echo_) fflush(stdout);
+  }
+
+  int available() { return (int)input_.size(); }
+  int read() {
+    if (input_.empty()) return -1;
+    int c = (unsigned char)input_[0];
+    input_.erase(0, 1);
+    return c;
+  }
+
+  /** Everything written since the last clear() */
+  const std::string& output() const { return output_; }
+  void clear() { output_.clear(); }
+
+  /** Queue bytes to be returned by read() */
+  void inject(const char* text) { input_ += text; }
+
+  /** Also copy output to stdout (for examples and benchmarks) */
+  void echo(bool on) { echo_ = on; }
+
+  explicit operator bool() const { return true; }
+
+ private:
+  std::string output_;
+  std::string input_;
+  bool echo_;
+};
+
+inline DebugNativeSerial& debug_native_serial() {
+  static DebugNativeSerial serial;
+  return serial;
+}
+
+// One shared instance across translation units
+static DebugNativeSerial& Serial = debug_native_serial();
+
+#endif  // DEBUG_NATIVE_H
@@ -0,0 +1,377 @@
+/**
+ * @file debug_net.h
+ * @brief Network log streaming sink: batched UDP datagrams or a TCP stream
+ *
+ * DebugNetSink is a DebugSink (debug_sink.h, DEBUG_SINKS=1). write() only
+ * copies the record with a millisecond stamp into a lock-free RAM ring and
+ * returns - it never waits for the network. A background task packs the
+ * records into datagrams of up to DEBUG_NET_DATAGRAM bytes (format in
+ * debug_datagram.h, with a boot id and sequence number so the receiver
+ * can count losses) and sends them when full or DEBUG_NET_FLUSH_MS after
+ * the first record.
+ *
+ * While the network is down records stay in the ring; when it fills, new
+ * records are dropped and counted, and the running count of dropped
+ * records travels in every datagram. Name resolution and (re)connecting also run in the task,
+ * retried every DEBUG_NET_RETRY_MS.
+ *
+ * Sockets are the BSD API, provided by lwIP on the ESP32 and by the OS on
+ * the host, so the same code runs against a loopback receiver on Linux.
+ *
+ * Usage:
+ *   build_flags = -DDEBUG_SINKS=1
+ *
+ *   static DebugPrintSink uart(Serial);
+ *   static DebugNetSink net;
+ *
+ *   void setup() {
+ *     // ... WiFi.begin() - the task connects once the network is up
+ *     net.begin("192.168.1.20", 5140);                 // UDP
+ *     debug_sink_add(uart, DEBUG_LEVEL_TRACE);
+ *     debug_sink_add(net, DEBUG_LEVEL_INFO);
+ *   }
+ *
+ * Receive with: debug_netrecv 5140   (tools/debug_netrecv.cpp)
+ */
+
+#ifndef DEBUG_NET_H
+#define DEBUG_NET_H
+
+#pragma once
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include "debug_datagram.h"
+#include "debug_ring.h"
+#include "debug_sink.h"
+
+#if defined(ESP_PLATFORM)
+#include <lwip/netdb.h>
+#include <lwip/sockets.h>
+#if __has_include(<esp_random.h>)
+#include <esp_random.h>
+#else
+#include <esp_system.h>
+#endif
+#else
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <chrono>
+#include <random>
+#include <thread>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#ifndef DEBUG_NET_DATAGRAM
+#define DEBUG_NET_DATAGRAM 1400  // Bytes per datagram; below the 1472-byte UDP payload of a 1500 MTU
+#endif
+
+#ifndef DEBUG_NET_BUFFER_SIZE
+#define DEBUG_NET_BUFFER_SIZE 8192  // RAM ring (power of two)
+#endif
+
+#ifndef DEBUG_NET_FLUSH_MS
+#define DEBUG_NET_FLUSH_MS 200  // Longest a partial datagram waits
+#endif
+
+#ifndef DEBUG_NET_POLL_MS
+#define DEBUG_NET_POLL_MS 5  // Task sleep when the ring is empty (at least one tick); the ring must hold this long of output
+#endif
+
+#ifndef DEBUG_NET_RETRY_MS
+#define DEBUG_NET_RETRY_MS 2000  // Delay between connection attempts
+#endif
+
+#ifndef DEBUG_NET_SEND_TIMEOUT_MS
+#define DEBUG_NET_SEND_TIMEOUT_MS 500  // A stalled TCP peer counts as a disconnect
+#endif
+
+#ifndef DEBUG_NET_HOST_MAX
+#define DEBUG_NET_HOST_MAX 64
+#endif
+
+#ifndef DEBUG_NET_TASK_STACK
+#define DEBUG_NET_TASK_STACK 4096
+#endif
+
+enum DebugNetProto : uint8_t {
+  DEBUG_NET_UDP = 0,  // Datagrams; lost ones show up as sequence gaps
+  DEBUG_NET_TCP = 1   // Stream of [u16 length][datagram]; reconnects after errors
+};
+
+// ============================================================================
+// SOCKET - BSD sockets (lwIP on the ESP32)
+// ============================================================================
+
+class DebugNetSocket {
+ public:
+  DebugNetSocket() : fd_(-1), proto_(DEBUG_NET_UDP) {}
+  ~DebugNetSocket() { close(); }
+
+  /**
+   * Resolve host and connect (UDP: fix the peer address). Blocks on DNS
+   * and the TCP handshake - call from the sender task only.
+   */
+  bool open(const char* host, uint16_t port, DebugNetProto proto) {
+    close();
+    char service[8];
+    snprintf(service, sizeof(service), "%u", (unsigned)port);
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = proto == DEBUG_NET_TCP ? SOCK_STREAM : SOCK_DGRAM;
+    struct addrinfo* res = NULL;
+    if (getaddrinfo(host, service, &hints, &res) != 0 || !res) return false;
+    int fd = socket(res->ai_family, res->ai_socktype, 0);
+    if (fd >= 0) {
+      struct timeval tv;
+      tv.tv_sec = DEBUG_NET_SEND_TIMEOUT_MS / 1000;
+      tv.tv_usec = (DEBUG_NET_SEND_TIMEOUT_MS % 1000) * 1000;
+      setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+      if (connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+        ::close(fd);
+        fd = -1;
+      }
+    }
+    freeaddrinfo(res);
+    fd_ = fd;
+    proto_ = proto;
+    return fd_ >= 0;
+  }
+
+  /**
+   * Send one datagram (TCP: with its length prefix, which the caller
+   * reserved in the 2 bytes before data). A TCP error closes the socket;
+   * a UDP error only loses this datagram.
+   */
+  bool send(uint8_t* data, size_t len) {
+    if (fd_ < 0) return false;
+    if (proto_ == DEBUG_NET_UDP) return ::send(fd_, data, len, 0) == (ssize_t)len;
+    uint16_t l = (uint16_t)len;
+    data -= 2;
+    memcpy(data, &l, 2);
+    len += 2;
+    while (len) {
+      ssize_t n = ::send(fd_, data, len, MSG_NOSIGNAL);
+      if (n <= 0) {
+        close();
+        return false;
+      }
+      data += n;
+      len -= (size_t)n;
+    }
+    return true;
+  }
+
+  void close() {
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+  }
+
+  bool connected() const { return fd_ >= 0; }
+
+ private:
+  int fd_;
+  DebugNetProto proto_;
+};
+
+// ============================================================================
+// SINK
+// ============================================================================
+
+/**
+ * Random id of this run, so the receiver can tell a reboot from a gap
+ */
+inline uint32_t debug_net_boot_id() {
+#if defined(ESP_PLATFORM)
+  return esp_random();
+#else
+  return std::random_device()();
+#endif
+}
+
+class DebugNetSink : public DebugSink {
+  typedef DebugRing<DEBUG_NET_BUFFER_SIZE> Ring;
+  static_assert(DEBUG_DGRAM_HEADER + DEBUG_DGRAM_RECORD_HEADER + Ring::record_max() <= DEBUG_NET_DATAGRAM,
+                "DEBUG_NET_DATAGRAM must hold at least one ring record");
+
+ public:
+  DebugNetSink()
+      : DebugSink(DEBUG_SINK_BUFFERED | DEBUG_SINK_REMOTE),
+        port_(0),
+        proto_(DEBUG_NET_UDP),
+        started_(false),
+        batch_len_(DEBUG_DGRAM_HEADER),
+        batch_ms_(0),
+        pending_len_(-1),
+        pending_ms_(0),
+        retry_ms_(0),
+        sent_(0),
+        send_errors_(0),
+        dropped_(0) {
+    host_[0] = 0;
+    header_.boot = debug_net_boot_id();
+    header_.seq = 0;
+    header_.dropped = 0;
+    busy_.clear();
+  }
+
+  /**
+   * Set the receiver and start the sender task; records written before
+   * the connection is up wait in the ring. Call once in setup().
+   */
+#if defined(ESP_PLATFORM)
+  bool begin(const char* host, uint16_t port, DebugNetProto proto = DEBUG_NET_UDP, UBaseType_t priority = 1,
+             BaseType_t core = tskNO_AFFINITY) {
+    if (started_) return true;
+    configure(host, port, proto);
+    started_ = true;
+    if (xTaskCreatePinnedToCore(task, "debug_net", DEBUG_NET_TASK_STACK, this, priority, NULL, core) != pdPASS) {
+      started_ = false;
+    }
+    return started_;
+  }
+#else
+  bool begin(const char* host, uint16_t port, DebugNetProto proto = DEBUG_NET_UDP) {
+    if (started_) return true;
+    configure(host, port, proto);
+    started_ = true;
+    std::thread(task, this).detach();
+    return true;
+  }
+#endif
+
+  /** Queue one record; never blocks (dropped and counted when the ring is full) */
+  size_t write(const uint8_t* data, size_t len) override {
+    size_t n = ring_.write(data, len, DEBUG_DROP_NEWEST, (uint32_t)millis());
+    if (!n && len) dropped_.fetch_add(1, std::memory_order_relaxed);
+    return n;
+  }
+
+  /**
+   * Send everything buffered now, if connected (before sleep or restart).
+   * Unlike write(), this waits for the network.
+   */
+  void flush() override {
+    while (busy_.test_and_set(std::memory_order_acquire)) debug_ring_wait();
+    while (step(true)) {
+    }
+    busy_.clear(std::memory_order_release);
+  }
+
+  /**
+   * Move ring records into the datagram and send it when full, older than
+   * DEBUG_NET_FLUSH_MS or when force is set. Returns records taken from
+   * the ring; 0 if not connected or another task is sending.
+   */
+  size_t send_step(bool force) {
+    if (busy_.test_and_set(std::memory_order_acquire)) return 0;
+    size_t moved = step(force);
+    busy_.clear(std::memory_order_release);
+    return moved;
+  }
+
+  uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }  // Records lost to a full ring
+  uint32_t sent() const { return sent_; }                // Datagrams sent
+  uint32_t send_errors() const { return send_errors_; }  // Datagrams lost to socket errors
+  bool connected() const { return sock_.connected(); }
+
+ private:
+  void configure(const char* host, uint16_t port, DebugNetProto proto) {
+    strncpy(host_, host, sizeof(host_) - 1);
+    host_[sizeof(host_) - 1] = 0;
+    port_ = port;
+    proto_ = proto;
+    retry_ms_ = (uint32_t)millis() - DEBUG_NET_RETRY_MS;  // First attempt right away
+  }
+
+  size_t step(bool force) {
+    if (!sock_.connected()) {
+      if (!started_ || (uint32_t)millis() - retry_ms_ < DEBUG_NET_RETRY_MS) return 0;
+      retry_ms_ = (uint32_t)millis();
+      if (!sock_.open(host_, port_, proto_)) {
+        retry_ms_ = (uint32_t)millis();  // DNS or connect may have taken a while
+        return 0;
+      }
+    }
+    size_t moved = 0;
+    for (;;) {
+      if (pending_len_ < 0) pending_len_ = ring_.pop(pending_, sizeof(pending_), &pending_ms_);
+      if (pending_len_ < 0) break;
+      if (batch_len_ + DEBUG_DGRAM_RECORD_HEADER + (size_t)pending_len_ > DEBUG_NET_DATAGRAM) {
+        if (!send_batch()) return moved;  // TCP dropped; keep the record for the next connection
+      }
+      if (batch_len_ == DEBUG_DGRAM_HEADER) batch_ms_ = (uint32_t)millis();
+      batch_len_ += debug_dgram_put_record(dgram() + batch_len_, pending_ms_, pending_, (size_t)pending_len_);
+      pending_len_ = -1;
+      moved++;
+    }
+    if (batch_len_ > DEBUG_DGRAM_HEADER &&
+        (force || (uint32_t)millis() - batch_ms_ >= DEBUG_NET_FLUSH_MS)) {
+      send_batch();
+    }
+    return moved;
+  }
+
+  /**
+   * Stamp the header and send; the sequence number advances even when the
+   * send fails, so the receiver sees the loss as a gap
+   */
+  bool send_batch() {
+    header_.dropped = dropped_.load(std::memory_order_relaxed);
+    debug_dgram_put_header(dgram(), header_);
+    header_.seq++;
+    bool ok = sock_.send(dgram(), batch_len_);
+    if (ok) {
+      sent_++;
+    } else {
+      send_errors_++;
+    }
+    batch_len_ = DEBUG_DGRAM_HEADER;
+    return ok || sock_.connected();
+  }
+
+  uint8_t* dgram() { return batch_ + 2; }  // 2 bytes in front for the TCP length
+
+#if defined(ESP_PLATFORM)
+  static void task(void* arg) {
+    DebugNetSink* self = (DebugNetSink*)arg;
+    const TickType_t poll = pdMS_TO_TICKS(DEBUG_NET_POLL_MS) ? pdMS_TO_TICKS(DEBUG_NET_POLL_MS) : 1;  // 0 would spin
+    for (;;) {
+      if (!self->send_step(false)) vTaskDelay(poll);
+    }
+  }
+#else
+  static void task(DebugNetSink* self) {
+    for (;;) {
+      if (!self->send_step(false)) std::this_thread::sleep_for(std::chrono::milliseconds(DEBUG_NET_POLL_MS));
+    }
+  }
+#endif
+
+  Ring ring_;
+  DebugNetSocket sock_;
+  char host_[DEBUG_NET_HOST_MAX];
+  uint16_t port_;
+  DebugNetProto proto_;
+  bool started_;
+  DebugDgramHeader header_;
+  uint8_t batch_[2 + DEBUG_NET_DATAGRAM];
+  size_t batch_len_;
+  uint32_t batch_ms_;
+  uint8_t pending_[Ring::record_max()];  // Record popped but not yet batched
+  int pending_len_;
+  uint32_t pending_ms_;
+  uint32_t retry_ms_;
+  uint32_t sent_;
+  uint32_t send_errors_;
+  std::atomic<uint32_t> dropped_;
+  std::atomic_flag busy_;
+};
+
+#endif  // DEBUG_NET_H
@@ -0,0 +1,432 @@
+/**
+ * @file debug_profile.h
+ * @brief Scoped profiling timers aggregated into a static table
+ *
+ * DEBUG_SCOPE("name") times the enclosing block with the CPU cycle counter
+ * and folds the result into a fixed-size table instead of printing. Exit
+ * is recorded by a destructor, so early returns are timed correctly and
+ * nested scopes each get their own entry.
+ *
+ * Usage:
+ *   void readSensors() {
+ *     DEBUG_SCOPE("readSensors");
+ *     ...
+ *   }
+ *   debug_profile_print(Serial);   // print the table when convenient
+ *
+ * DEBUG_SCOPE_HISTOGRAM("name") additionally records every sample into a
+ * log-linear latency histogram (fixed memory, lock-free increment) so tail
+ * latency (p99, p99.9) can be reported without logging each sample.
+ *
+ * DEBUG_TRACE=1 also records every scope entry/exit as a timeline event
+ * (see debug_trace.h) for export to Chrome Trace / Perfetto.
+ */
+
+#ifndef DEBUG_PROFILE_H
+#define DEBUG_PROFILE_H
+
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include "debug_ring.h"
+
+#if !defined(ESP_PLATFORM)
+#include <chrono>
+#endif
+
+#ifndef DEBUG_PROFILE_SLOTS
+#define DEBUG_PROFILE_SLOTS 32  // Distinct scope names tracked
+#endif
+
+#ifndef DEBUG_TRACE
+#define DEBUG_TRACE 0  // Record scope begin/end events for timeline export
+#endif
+
+#if DEBUG_TRACE == 1
+#include "debug_trace.h"
+#if defined(ESP_PLATFORM)
+#include <esp_timer.h>
+#if portNUM_PROCESSORS > 1
+#include <esp_ipc.h>
+#endif
+#endif
+#endif
+
+#ifndef DEBUG_HISTOGRAM_SLOTS
+#define DEBUG_HISTOGRAM_SLOTS 8  // Scopes that can carry a histogram (~500 bytes each)
+#endif
+
+// ============================================================================
+// CYCLE COUNTER
+// ============================================================================
+
+/**
+ * Free-running CPU cycle count (wraps every ~18 s at 240 MHz; intervals
+ * are computed with unsigned subtraction so a single wrap is harmless).
+ * The host build counts nanoseconds instead.
+ */
+inline uint32_t debug_cycles() {
+#if defined(__XTENSA__)
+  uint32_t ccount;
+  __asm__ __volatile__("rsr %0, ccount" : "=a"(ccount));
+  return ccount;
+#elif defined(ESP_PLATFORM)
+  return ESP.getCycleCount();
+#else
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/**
+ * Cycles per microsecond, for converting debug_cycles() intervals
+ */
+inline uint32_t debug_cycles_per_us() {
+#if defined(ESP_PLATFORM)
+  return getCpuFrequencyMhz();
+#else
+  return 1000;
+#endif
+}
+
+// ============================================================================
+// LATENCY HISTOGRAM - Log-linear buckets over cycle counts
+// ============================================================================
+
+/**
+ * Values 0-7 get exact buckets; above that every power of two is split into
+ * 4 linear sub-buckets, so any value lands in a bucket at most 25% wide.
+ * 8 + 29 * 4 = 124 buckets cover the full 32-bit cycle range.
+ */
+#define DEBUG_HISTOGRAM_BUCKETS 124
+
+struct DebugHistogram {
+  std::atomic<uint32_t> buckets[DEBUG_HISTOGRAM_BUCKETS];
+};
+
+inline uint32_t debug_histogram_bucket(uint32_t v) {
+  if (v < 8) return v;
+  uint32_t e = 31 - __builtin_clz(v);  // Index of the top bit, >= 3
+  return 8 + (e - 3) * 4 + ((v >> (e - 2)) & 3);
+}
+
+/** Smallest value that falls into bucket b */
+inline uint32_t debug_histogram_lower(uint32_t b) {
+  if (b < 8) return b;
+  uint32_t e = (b - 8) / 4 + 3;
+  return (4 + (b - 8) % 4) << (e - 2);
+}
+
+/** Largest value that falls into bucket b */
+inline uint32_t debug_histogram_upper(uint32_t b) {
+  return b + 1 < DEBUG_HISTOGRAM_BUCKETS ? debug_histogram_lower(b + 1) - 1 : UINT32_MAX;
+}
+
+/**
+ * Hand out histograms from a static pool; NULL once the pool is used up
+ */
+inline DebugHistogram* debug_histogram_alloc() {
+  static DebugHistogram pool[DEBUG_HISTOGRAM_SLOTS];
+  static std::atomic<uint32_t> next(0);
+  uint32_t i = next.fetch_add(1, std::memory_order_relaxed);
+  return i < DEBUG_HISTOGRAM_SLOTS ? &pool[i] : NULL;
+}
+
+/**
+ * Value at quantile q (0..1): midpoint of the bucket holding that rank
+ */
+inline uint32_t debug_histogram_quantile(const uint32_t* counts, uint32_t total, double q) {
+  uint32_t rank = (uint32_t)(q * total + 0.999999);
+  if (rank == 0) rank = 1;
+  uint32_t seen = 0;
+  for (uint32_t b = 0; b < DEBUG_HISTOGRAM_BUCKETS; b++) {
+    seen += counts[b];
+    if (seen >= rank) {
+      uint32_t lo = debug_histogram_lower(b);
+      return lo + (debug_histogram_upper(b) - lo) / 2;
+    }
+  }
+  return 0;
+}
+
+// ============================================================================
+// PROFILE TABLE
+// ============================================================================
+
+/**
+ * Aggregated timings for one scope name
+ */
+struct DebugProfileSlot {
+  const char* name;
+  uint8_t depth;  // Nesting depth when first seen (report indentation)
+  uint32_t count;
+  uint64_t total;
+  uint32_t min;
+  uint32_t max;
+  DebugHistogram* histogram;  // Only for DEBUG_SCOPE_HISTOGRAM scopes
+};
+
+struct DebugProfileTable {
+  DebugProfileSlot slots[DEBUG_PROFILE_SLOTS];
+  std::atomic<uint32_t> used;
+  DebugSpinLock lock;
+};
+
+inline DebugProfileTable& debug_profile_table() {
+  static DebugProfileTable table;
+  return table;
+}
+
+/**
+ * Current nesting depth of DEBUG_SCOPEs on this task
+ */
+inline uint8_t& debug_profile_depth() {
+  static thread_local uint8_t depth = 0;
+  return depth;
+}
+
+/**
+ * Find or create the slot for name. Called once per DEBUG_SCOPE site;
+ * returns NULL when the table is full (that scope is then not timed).
+ */
+inline DebugProfileSlot* debug_profile_slot(const char* name, bool histogram = false) {
+  DebugProfileTable& t = debug_profile_table();
+  DebugProfileSlot* found = NULL;
+  t.lock.lock();
+  uint32_t n = t.used.load(std::memory_order_relaxed);
+  for (uint32_t i = 0; i < n && !found; i++) {
+    if (t.slots[i].name == name || strcmp(t.slots[i].name, name) == 0) found = &t.slots[i];
+  }
+  if (!found && n < DEBUG_PROFILE_SLOTS) {
+    found = &t.slots[n];
+    found->name = name;
+    found->depth = debug_profile_depth();
+    found->count = 0;
+    found->total = 0;
+    found->min = UINT32_MAX;
+    found->max = 0;
+    found->histogram = NULL;
+    t.used.store(n + 1, std::memory_order_release);
+  }
+  if (found && histogram && !found->histogram) found->histogram = debug_histogram_alloc();
+  t.lock.unlock();
+  return found;
+}
+
+inline void debug_profile_record(DebugProfileSlot* slot, uint32_t cycles) {
+  DebugProfileTable& t = debug_profile_table();
+  t.lock.lock();
+  slot->count++;
+  slot->total += cycles;
+  if (cycles < slot->min) slot->min = cycles;
+  if (cycles > slot->max) slot->max = cycles;
+  t.lock.unlock();
+}
+
+/**
+ * RAII timer created by DEBUG_SCOPE
+ */
+class DebugScope {
+ public:
+  explicit DebugScope(DebugProfileSlot* slot) : slot_(slot), start_(debug_cycles()) {
+    debug_profile_depth()++;
+#if DEBUG_TRACE == 1
+    if (slot_) debug_trace_record(index(), DEBUG_TRACE_BEGIN, start_);
+#endif
+  }
+
+  ~DebugScope() {
+    uint32_t end = debug_cycles();
+    uint32_t cycles = end - start_;
+    debug_profile_depth()--;
+    if (!slot_) return;
+#if DEBUG_TRACE == 1
+    debug_trace_record(index(), DEBUG_TRACE_END, end);
+#endif
+    if (slot_->histogram) {
+      slot_->histogram->buckets[debug_histogram_bucket(cycles)].fetch_add(1, std::memory_order_relaxed);
+    }
+    debug_profile_record(slot_, cycles);
+  }
+
+ private:
+  DebugScope(const DebugScope&);
+  DebugScope& operator=(const DebugScope&);
+
+  uint8_t index() const { return (uint8_t)(slot_ - debug_profile_table().slots); }
+
+  DebugProfileSlot* slot_;
+  uint32_t start_;
+};
+
+// ============================================================================
+// REPORTING
+// ============================================================================
+
+/**
+ * Print one line per scope: calls, total/avg/min/max in microseconds.
+ * Nested scopes are indented under their parent.
+ */
+template <typename Out>
+inline void debug_profile_print(Out& out) {
+  DebugProfileTable& t = debug_profile_table();
+  uint32_t n = t.used.load(std::memory_order_acquire);
+  uint32_t per_us = debug_cycles_per_us();
+  out.printf("[PROFILE] %-24s %8s %10s %8s %8s %8s\n", "scope", "calls", "total us", "avg", "min",
+             "max");
+  for (uint32_t i = 0; i < n; i++) {
+    t.lock.lock();
+    DebugProfileSlot s = t.slots[i];
+    t.lock.unlock();
+    if (!s.count) continue;
+    out.printf("[PROFILE] %*s%-*s %8lu %10lu %8lu %8lu %8lu\n", s.depth * 2, "",
+               24 - s.depth * 2, s.name, (unsigned long)s.count,
+               (unsigned long)(s.total / per_us), (unsigned long)(s.total / s.count / per_us),
+               (unsigned long)(s.min / per_us), (unsigned long)(s.max / per_us));
+  }
+}
+
+/**
+ * Print the latency distribution of every DEBUG_SCOPE_HISTOGRAM scope in
+ * microseconds (one decimal): min, mean, p50, p99, p99.9, max
+ */
+template <typename Out>
+inline void debug_histogram_print(Out& out) {
+  DebugProfileTable& t = debug_profile_table();
+  uint32_t n = t.used.load(std::memory_order_acquire);
+  uint32_t per_us = debug_cycles_per_us();
+  uint32_t counts[DEBUG_HISTOGRAM_BUCKETS];
+  out.printf("[LATENCY] %-20s %8s %8s %8s %8s %8s %8s %8s\n", "scope", "count", "min", "mean",
+             "p50", "p99", "p99.9", "max");
+  for (uint32_t i = 0; i < n; i++) {
+    t.lock.lock();
+    DebugProfileSlot s = t.slots[i];
+    t.lock.unlock();
+    if (!s.histogram) continue;
+    uint32_t total = 0;
+    for (uint32_t b = 0; b < DEBUG_HISTOGRAM_BUCKETS; b++) {
+      counts[b] = s.histogram->buckets[b].load(std::memory_order_relaxed);
+      total += counts[b];
+    }
+    if (!total) continue;
+    uint32_t v[6] = {s.min,
+                     s.count ? (uint32_t)(s.total / s.count) : 0,
+                     debug_histogram_quantile(counts, total, 0.50),
+                     debug_histogram_quantile(counts, total, 0.99),
+                     debug_histogram_quantile(counts, total, 0.999),
+                     s.max};
+    char cols[6][24];  // Any unsigned long whole part: 20 digits, ".", 1 digit, NUL
+    for (int c = 0; c < 6; c++) {
+      uint64_t tenths = (uint64_t)v[c] * 10 / per_us;
+      snprintf(cols[c], sizeof(cols[c]), "%lu.%lu", (unsigned long)(tenths / 10),
+               (unsigned long)(tenths % 10));
+    }
+    out.printf("[LATENCY] %-20s %8lu %8s %8s %8s %8s %8s %8s\n", s.name, (unsigned long)total,
+               cols[0], cols[1], cols[2], cols[3], cols[4], cols[5]);
+  }
+}
+
+/**
+ * Print the histogram table at most once per interval_ms; call from loop()
+ */
+template <typename Out>
+inline void debug_histogram_print_every(Out& out, uint32_t interval_ms) {
+  static uint32_t last = 0;
+  uint32_t now = (uint32_t)millis();
+  if (now - last < interval_ms) return;
+  last = now;
+  debug_histogram_print(out);
+}
+
+#if DEBUG_TRACE == 1
+
+/**
+ * Sample the calling core's cycle counter against the shared microsecond
+ * clock (esp_timer; host: steady_clock). Runs on each core via esp_ipc.
+ */
+inline void debug_trace_sample_clock(void* arg) {
+  DebugTraceClock* c = (DebugTraceClock*)arg;
+  c->core = debug_trace_core();
+#if defined(ESP_PLATFORM)
+  c->us = (uint64_t)esp_timer_get_time();
+#else
+  c->us = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+  c->cycles = debug_cycles();
+}
+
+/**
+ * Dump the trace buffer as binary frames with scope names from the profile
+ * table and a clock anchor per core; convert the capture with
+ * tools/debug_trace.cpp
+ */
+template <typename Out>
+inline void debug_trace_print(Out& out) {
+  DebugProfileTable& t = debug_profile_table();
+  const char* names[DEBUG_PROFILE_SLOTS];
+  uint32_t n = t.used.load(std::memory_order_acquire);
+  for (uint32_t i = 0; i < n; i++) names[i] = t.slots[i].name;
+
+#if defined(ESP_PLATFORM) && portNUM_PROCESSORS > 1
+  DebugTraceClock clocks[portNUM_PROCESSORS];
+  uint32_t cores = portNUM_PROCESSORS;
+  for (uint32_t c = 0; c < cores; c++) {
+    if (c == (uint32_t)xPortGetCoreID()) {
+      debug_trace_sample_clock(&clocks[c]);
+    } else {
+      esp_ipc_call_blocking(c, debug_trace_sample_clock, &clocks[c]);
+    }
+  }
+#else
+  DebugTraceClock clocks[1];
+  uint32_t cores = 1;
+  debug_trace_sample_clock(&clocks[0]);
+#endif
+  debug_trace_write(out, debug_cycles_per_us(), names, n, clocks, cores);
+}
+
+#endif  // DEBUG_TRACE
+
+/**
+ * Clear all accumulated timings (scope names stay registered)
+ */
+inline void debug_profile_reset() {
+  DebugProfileTable& t = debug_profile_table();
+  uint32_t n = t.used.load(std::memory_order_acquire);
+  t.lock.lock();
+  for (uint32_t i = 0; i < n; i++) {
+    t.slots[i].count = 0;
+    t.slots[i].total = 0;
+    t.slots[i].min = UINT32_MAX;
+    t.slots[i].max = 0;
+    if (t.slots[i].histogram) {
+      for (uint32_t b = 0; b < DEBUG_HISTOGRAM_BUCKETS; b++) {
+        t.slots[i].histogram->buckets[b].store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+  t.lock.unlock();
+}
+
+#define DEBUG_CONCAT2(a, b) a##b
+#define DEBUG_CONCAT(a, b) DEBUG_CONCAT2(a, b)
+
+/**
+ * Time the rest of the enclosing block under name (a string literal or
+ * any string that outlives the program)
+ */
+#define DEBUG_SCOPE(name) \
+  static DebugProfileSlot* const DEBUG_CONCAT(_debug_slot_, __LINE__) = debug_profile_slot(name); \
+  DebugScope DEBUG_CONCAT(_debug_scope_, __LINE__)(DEBUG_CONCAT(_debug_slot_, __LINE__))
+
+/**
+ * Like DEBUG_SCOPE, and also keep a latency histogram for name
+ */
+#define DEBUG_SCOPE_HISTOGRAM(name) \
+  static DebugProfileSlot* const DEBUG_CONCAT(_debug_slot_, __LINE__) = debug_profile_slot(name, true); \
+  DebugScope DEBUG_CONCAT(_debug_scope_, __LINE__)(DEBUG_CONCAT(_debug_slot_, __LINE__))
+
+#endif  // DEBUG_PROFILE_H
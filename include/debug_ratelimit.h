@@ -0,0 +1,50 @@
+/**
+ * @file debug_ratelimit.h
+ * @brief Per-call-site token-bucket rate limiting for debug_ratelimit()
+ *
+ * Each debug_ratelimit() call site owns an 8-byte static state. The bucket
+ * is kept in GCRA form (the "theoretical arrival time" of the next token),
+ * so a suppressed call costs one micros() read, a compare and an increment;
+ * nothing is formatted. When a call is allowed again after suppression, a
+ * "[RATELIMIT] N suppressed" line is printed just before the message.
+ *
+ * State is not atomic: concurrent callers of the same site may miscount a
+ * suppressed message, but never corrupt output.
+ */
+
+#ifndef DEBUG_RATELIMIT_H
+#define DEBUG_RATELIMIT_H
+
+#pragma once
+#include <stdint.h>
+
+struct DebugRateLimit {
+  uint32_t tat;         // Time (µs) when the bucket is next full enough
+  uint32_t suppressed;  // Calls dropped since the last emitted message
+};
+
+/**
+ * Token bucket of `burst` tokens refilled at `rate` per second.
+ * Returns true if the call may log; *suppressed then holds the number of
+ * calls dropped since the previous allowed one.
+ */
+inline bool debug_ratelimit_allow(DebugRateLimit& s, uint32_t rate, uint32_t burst,
+                                  uint32_t* suppressed) {
+  uint32_t now = (uint32_t)micros();
+  uint32_t interval = 1000000UL / (rate ? rate : 1);
+  uint32_t tolerance = interval * (burst ? burst - 1 : 0);
+
+  // tat never runs further ahead than tolerance + interval; anything
+  // outside that window is a stale value from before a micros() wrap
+  int32_t ahead = (int32_t)(s.tat - now);
+  if (ahead > (int32_t)tolerance && ahead <= (int32_t)(tolerance + interval)) {
+    s.suppressed++;
+    return false;
+  }
+  s.tat = (ahead > 0 ? s.tat : now) + interval;
+  *suppressed = s.suppressed;
+  s.suppressed = 0;
+  return true;
+}
+
+#endif  // DEBUG_RATELIMIT_H
@@ -0,0 +1,285 @@
+/**
+ * @file debug_ring.h
+ * @brief Fixed-size lock-free record ring used by the async debug output mode
+ *
+ * The ring is statically sized and never allocates. Any number of tasks on
+ * either core may write concurrently without taking a lock; each write()
+ * lands as one contiguous record, so lines never interleave. It has no Arduino
+ * dependency so it can be compiled natively on a Linux host (for example
+ * to benchmark throughput) as well as on the ESP32.
+ *
+ * Usage:
+ *   static DebugRing<4096> ring;
+ *   ring.write(data, len, DEBUG_DROP_NEWEST);   // producer side
+ *   size_t n = ring.read(chunk, sizeof(chunk)); // single consumer
+ */
+
+#ifndef DEBUG_RING_H
+#define DEBUG_RING_H
+
+#pragma once
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+
+#if defined(ESP_PLATFORM)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#else
+#include <thread>
+#endif
+
+// ============================================================================
+// OVERFLOW POLICY - What to do when a write does not fit
+// ============================================================================
+
+enum DebugOverflowPolicy : uint8_t {
+  DEBUG_DROP_NEWEST = 0,  // Discard the whole incoming write (lines stay intact)
+  DEBUG_DROP_OLDEST = 1,  // Overwrite the oldest buffered bytes
+  DEBUG_BLOCK = 2         // Wait until the drain task frees enough space
+};
+
+// ============================================================================
+// SPIN LOCK - Short critical sections (profile table)
+// ============================================================================
+
+/**
+ * Minimal lock for short table updates.
+ * On ESP32 this is a portMUX critical section (safe from both cores and
+ * from ISRs); on the host it is an atomic_flag spin lock.
+ */
+class DebugSpinLock {
+ public:
+#if defined(ESP_PLATFORM)
+  DebugSpinLock() : mux_(portMUX_INITIALIZER_UNLOCKED) {}
+  void lock() { portENTER_CRITICAL_SAFE(&mux_); }
+  void unlock() { portEXIT_CRITICAL_SAFE(&mux_); }
+
+ private:
+  portMUX_TYPE mux_;
+#else
+  DebugSpinLock() { flag_.clear(); }
+  void lock() {
+    while (flag_.test_and_set(std::memory_order_acquire)) std::this_thread::yield();
+  }
+  void unlock() { flag_.clear(std::memory_order_release); }
+
+ private:
+  std::atomic_flag flag_;
+#endif
+};
+
+/**
+ * Give the consumer a chance to run while a producer waits for space
+ */
+inline void debug_ring_wait() {
+#if defined(ESP_PLATFORM)
+  vTaskDelay(1);
+#else
+  std::this_thread::yield();
+#endif
+}
+
+// ============================================================================
+// RING BUFFER - Lock-free multi-producer, single-consumer record queue
+// ============================================================================
+
+/**
+ * Each write() becomes exactly one record (at most record_max() bytes of
+ * payload): a 12-byte header {tag, len, stamp} followed by the payload,
+ * padded to 8 bytes. The stamp is an opaque
+ * caller-supplied timestamp (used to merge per-core rings). Producers reserve space by advancing
+ * head_ with compare-and-swap, copy their bytes without any lock, then
+ * publish the record by storing tag = position | 1. The consumer only
+ * takes records whose tag matches, so a line is never torn or interleaved
+ * with another producer's output.
+ *
+ * DEBUG_DROP_OLDEST lets a producer advance tail_ past the oldest committed
+ * record; the consumer copies a record first and then claims it with a CAS
+ * on tail_, discarding the copy if a producer evicted it meanwhile.
+ *
+ * A record reserved but not yet committed holds back the consumer (and
+ * cannot be evicted) until its producer finishes the memcpy.
+ *
+ * N must be a power of two so wrap-around is a mask, not a division.
+ */
+template <size_t N>
+class DebugRing {
+  static_assert(N >= 64 && (N & (N - 1)) == 0, "DebugRing size must be a power of two >= 64");
+
+  static const uint32_t kHeader = 12;
+  static const uint32_t kPad = 0x80000000u;  // len flag: filler up to the end of the buffer
+
+ public:
+  /** Longest payload stored as a single record; longer writes are truncated */
+  static constexpr size_t record_max() { return N / 4 < 256 ? N / 4 : 256; }
+
+  DebugRing() : head_(0), tail_(0), dropped_(0), truncated_(0) {}
+
+  /**
+   * Append bytes as one record according to the overflow policy. Writes
+   * longer than record_max() keep their first record_max() bytes: splitting
+   * them would let another producer's record land between the pieces, or
+   * DEBUG_DROP_NEWEST keep the head and drop the tail. The cut bytes count
+   * as dropped and the write as truncated. Returns the bytes accepted.
+   */
+  size_t write(const uint8_t* data, size_t len, DebugOverflowPolicy policy, uint32_t stamp = 0) {
+    size_t n = len;
+    if (n > record_max()) {
+      n = record_max();
+      truncated_.fetch_add(1, std::memory_order_relaxed);
+      dropped_.fetch_add((uint32_t)(len - n), std::memory_order_relaxed);
+    }
+    if (!put(data, (uint32_t)n, policy, stamp)) {
+      dropped_.fetch_add((uint32_t)n, std::memory_order_relaxed);
+      return 0;
+    }
+    return n;
+  }
+
+  /**
+   * Remove whole records into out (up to max bytes, at least one record if
+   * max >= record_max()). Single consumer only. Returns bytes copied.
+   */
+  size_t read(uint8_t* out, size_t max) {
+    size_t copied = 0;
+    int n;
+    while ((n = pop(out + copied, max - copied, NULL)) >= 0) copied += n;
+    return copied;
+  }
+
+  /**
+   * Remove the oldest record into out and return its length, or -1 if the
+   * ring is empty, the oldest record is still being written or it is longer
+   * than max. The record's stamp is stored in *stamp when given.
+   */
+  int pop(uint8_t* out, size_t max, uint32_t* stamp) {
+    for (;;) {
+      uint32_t tail = tail_.load(std::memory_order_acquire);
+      if (tail == head_.load(std::memory_order_acquire)) return -1;
+      uint8_t* rec = buf_ + (tail & (N - 1));
+      if (__atomic_load_n((uint32_t*)rec, __ATOMIC_ACQUIRE) != (tail | 1)) return -1;  // Not committed
+      uint32_t len;
+      memcpy(&len, rec + 4, 4);
+      uint32_t size = (len & kPad) ? (len & ~kPad) : record_size(len);
+      if (size > N) continue;  // Torn read of an evicted record; tail_ has moved
+      if (!(len & kPad)) {
+        if (len > max) return -1;
+        memcpy(out, rec + kHeader, len);
+        if (stamp) memcpy(stamp, rec + 8, 4);
+      }
+      if (!tail_.compare_exchange_strong(tail, tail + size, std::memory_order_release,
+                                         std::memory_order_relaxed)) {
+        continue;  // Evicted by a DEBUG_DROP_OLDEST producer; copy is stale
+      }
+      if (!(len & kPad)) return (int)len;
+    }
+  }
+
+  /** Bytes currently reserved, including record headers */
+  size_t used() const {
+    return head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_relaxed);
+  }
+
+  /** Total bytes discarded by the overflow policy or truncation since start-up */
+  uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+  /** Writes cut to record_max() since start-up */
+  uint32_t truncated() const { return truncated_.load(std::memory_order_relaxed); }
+
+  /**
+   * Count bytes a caller cut before writing (a formatted line longer than
+   * its buffer) as dropped and the write as truncated
+   */
+  void discard(size_t cut) {
+    truncated_.fetch_add(1, std::memory_order_relaxed);
+    dropped_.fetch_add((uint32_t)cut, std::memory_order_relaxed);
+  }
+
+  static constexpr size_t capacity() { return N; }
+
+ private:
+  static uint32_t record_size(uint32_t len) { return (kHeader + len + 7) & ~7u; }
+
+  bool put(const uint8_t* data, uint32_t len, DebugOverflowPolicy policy, uint32_t stamp) {
+    uint32_t size = record_size(len);
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    uint32_t pad;
+    for (;;) {
+      uint32_t room = N - (head & (N - 1));
+      pad = room < size ? room : 0;  // Records never wrap; fill the end instead
+      uint32_t tail = tail_.load(std::memory_order_acquire);
+      if (head + pad + size - tail > N) {
+        if (policy == DEBUG_DROP_NEWEST) return false;
+        if (policy == DEBUG_BLOCK) {
+          debug_ring_wait();
+        } else if (!evict(tail)) {
+          return false;
+        }
+        head = head_.load(std::memory_order_relaxed);
+        continue;
+      }
+      if (head_.compare_exchange_weak(head, head + pad + size, std::memory_order_relaxed,
+                                      std::memory_order_relaxed)) {
+        break;
+      }
+    }
+
+    if (pad) {
+      commit(head, pad | kPad);
+      head += pad;
+    }
+    uint8_t* rec = buf_ + (head & (N - 1));
+    memcpy(rec + 8, &stamp, 4);
+    memcpy(rec + kHeader, data, len);
+    commit(head, len);
+    return true;
+  }
+
+  void commit(uint32_t pos, uint32_t len) {
+    uint8_t* rec = buf_ + (pos & (N - 1));
+    memcpy(rec + 4, &len, 4);
+    __atomic_store_n((uint32_t*)rec, pos | 1, __ATOMIC_RELEASE);
+  }
+
+  // DEBUG_DROP_OLDEST: skip the oldest record if it is committed
+  bool evict(uint32_t tail) {
+    uint8_t* rec = buf_ + (tail & (N - 1));
+    if (__atomic_load_n((uint32_t*)rec, __ATOMIC_ACQUIRE) != (tail | 1)) return false;
+    uint32_t len;
+    memcpy(&len, rec + 4, 4);
+    uint32_t size = (len & kPad) ? (len & ~kPad) : record_size(len);
+    if (size > N) return true;  // Stale header; tail_ has already moved
+    if (tail_.compare_exchange_strong(tail, tail + size, std::memory_order_release,
+                                      std::memory_order_relaxed) &&
+        !(len & kPad)) {
+      dropped_.fetch_add(len, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  alignas(8) uint8_t buf_[N];
+  std::atomic<uint32_t> head_;
+  std::atomic<uint32_t> tail_;
+  std::atomic<uint32_t> dropped_;
+  std::atomic<uint32_t> truncated_;
+};
+
+/**
+ * vsnprintf into a fixed line buffer, as the buffered outputs' printf()
+ * does. Returns the bytes kept (0 on an encoding error); the bytes beyond
+ * size - 1 are stored in *cut when given.
+ */
+inline size_t debug_vformat_line(char* line, size_t size, const char* fmt, va_list args,
+                                 size_t* cut = NULL) {
+  int n = vsnprintf(line, size, fmt, args);
+  size_t kept = n > 0 ? (size_t)n : 0;
+  if (kept >= size) kept = size - 1;
+  if (cut) *cut = n > 0 ? (size_t)n - kept : 0;
+  return kept;
+}
+
+#endif  // DEBUG_RING_H
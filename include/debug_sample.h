@@ -0,0 +1,56 @@
+/**
+ * @file debug_sample.h
+ * @brief Per-call-site sampling for high-frequency trace points
+ *
+ * debug_sample(N, ...) logs every Nth call of its call site using a
+ * countdown; debug_sample_random(N, ...) logs each call with probability
+ * 1/N using a per-site xorshift32 generator (no periodic aliasing with
+ * loops that run at a multiple of N). A skipped call costs an increment,
+ * a decrement (or one xorshift step) and a branch; nothing is formatted.
+ *
+ * Emitted lines carry "[SAMPLE emitted/total]" so rates can be scaled back
+ * up. State is not atomic: concurrent callers of one site may miscount.
+ */
+
+#ifndef DEBUG_SAMPLE_H
+#define DEBUG_SAMPLE_H
+
+#pragma once
+#include <stdint.h>
+
+struct DebugSample {
+  uint32_t total;    // Calls seen
+  uint32_t emitted;  // Calls logged
+  uint32_t state;    // Countdown, or xorshift state for the random mode
+};
+
+/**
+ * 1-in-n: true on the 1st, (n+1)th, (2n+1)th ... call
+ */
+inline bool debug_sample_every(DebugSample& s, uint32_t n) {
+  s.total++;
+  if (s.state) {
+    s.state--;
+    return false;
+  }
+  s.state = n ? n - 1 : 0;
+  s.emitted++;
+  return true;
+}
+
+/**
+ * Probability 1/n per call
+ */
+inline bool debug_sample_chance(DebugSample& s, uint32_t n) {
+  s.total++;
+  uint32_t x = s.state ? s.state : (2463534242u ^ (uint32_t)(uintptr_t)&s) | 1;  // Seed per site
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  s.state = x;
+  if (x > 0xFFFFFFFFu / (n ? n : 1)) return false;
+  s.emitted++;
+  return true;
+}
+
+#endif  // DEBUG_SAMPLE_H
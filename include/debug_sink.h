@@ -0,0 +1,291 @@
+/**
+ * @file debug_sink.h
+ * @brief Multi-sink output: one formatted record fanned out to several sinks
+ *
+ * With DEBUG_SINKS=1, DEBUG_OUT is a DebugSinks dispatcher. A record is
+ * formatted once into a stack buffer and the same bytes are handed to every
+ * registered sink whose level threshold admits it:
+ *
+ *   static DebugPrintSink uart(Serial);
+ *   static DebugRingSink<4096> recent;          // last 4 KB in RAM
+ *   static DebugPrintSink flash(debug_flash_output(), DEBUG_SINK_BUFFERED | DEBUG_SINK_PERSISTENT);
+ *
+ *   void setup() {
+ *     debug_sink_add(uart, DEBUG_LEVEL_TRACE);  // everything
+ *     debug_sink_add(recent, DEBUG_LEVEL_DEBUG);
+ *     debug_sink_add(flash, DEBUG_LEVEL_WARN);  // only warnings and errors
+ *   }
+ *
+ * Levels: debug_error() ... debug_trace() carry their own level; all other
+ * output (debugf, debug, debug_val ...) counts as DEBUG_SINK_DEFAULT_LEVEL.
+ * A record no sink wants is not formatted at all.
+ *
+ * Sinks buffer on their own terms (stdio buffer, RAM ring, flash batch);
+ * flush() reaches only sinks with DEBUG_SINK_BUFFERED. Registration is
+ * append-only and meant for setup(); each sink's write() must be safe to
+ * call from several tasks.
+ */
+
+#ifndef DEBUG_SINK_H
+#define DEBUG_SINK_H
+
+#pragma once
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include "debug_ring.h"
+
+#ifndef DEBUG_SINK_MAX
+#define DEBUG_SINK_MAX 6  // Registered sinks
+#endif
+
+#ifndef DEBUG_SINK_LINE_MAX
+#define DEBUG_SINK_LINE_MAX 256  // Longest single formatted write (truncated beyond)
+#endif
+
+#ifndef DEBUG_SINK_DEFAULT_LEVEL
+#define DEBUG_SINK_DEFAULT_LEVEL 4  // DEBUG_LEVEL_DEBUG: level of output without a level macro
+#endif
+
+// ============================================================================
+// SINK INTERFACE
+// ============================================================================
+
+enum DebugSinkCaps : uint8_t {
+  DEBUG_SINK_BUFFERED = 1,   // Holds data back; flush() pushes it out
+  DEBUG_SINK_PERSISTENT = 2, // Survives a reset (flash, file)
+  DEBUG_SINK_REMOTE = 4      // Leaves the device (network)
+};
+
+class DebugSink {
+ public:
+  explicit DebugSink(uint8_t caps = 0) : level(5), caps_(caps) {}
+  virtual ~DebugSink() {}
+
+  /** Take one record (a whole formatted write); may be called concurrently */
+  virtual size_t write(const uint8_t* data, size_t len) = 0;
+  virtual void flush() {}
+  uint8_t caps() const { return caps_; }
+
+  uint8_t level;  // Highest level accepted (DEBUG_LEVEL_ERROR=1 ... TRACE=5)
+
+ private:
+  uint8_t caps_;
+};
+
+/**
+ * Any Print object as a sink: Serial, Serial1, debug_async_output(),
+ * debug_flash_output() ...
+ */
+class DebugPrintSink : public DebugSink {
+ public:
+  explicit DebugPrintSink(Print& out, uint8_t caps = 0) : DebugSink(caps), out_(out) {}
+  size_t write(const uint8_t* data, size_t len) override { return out_.write(data, len); }
+  void flush() override { out_.flush(); }
+
+ private:
+  Print& out_;
+};
+
+/**
+ * Last N bytes of output in RAM (lock-free ring, oldest records dropped);
+ * read() them back e.g. from a shell command or before a reset
+ */
+template <size_t N>
+class DebugRingSink : public DebugSink {
+ public:
+  DebugRingSink() : DebugSink(DEBUG_SINK_BUFFERED) {}
+  size_t write(const uint8_t* data, size_t len) override { return ring_.write(data, len, DEBUG_DROP_OLDEST); }
+
+  /** Move buffered records to out, oldest first */
+  template <typename Out>
+  void dump(Out& out) {
+    uint8_t rec[DebugRing<N>::record_max()];
+    int n;
+    while ((n = ring_.pop(rec, sizeof(rec), NULL)) >= 0) out.write(rec, (size_t)n);
+  }
+
+  DebugRing<N>& ring() { return ring_; }
+
+ private:
+  DebugRing<N> ring_;
+};
+
+/**
+ * Fixed-size RAM buffer that keeps the first N bytes and counts the rest;
+ * for tests and benchmarks on the host
+ */
+template <size_t N>
+class DebugMemorySink : public DebugSink {
+ public:
+  DebugMemorySink() : len_(0), total_(0) {}
+
+  size_t write(const uint8_t* data, size_t len) override {
+    lock_.lock();
+    size_t n = N - len_ < len ? N - len_ : len;
+    memcpy(buf_ + len_, data, n);
+    len_ += n;
+    total_ += len;
+    lock_.unlock();
+    return len;
+  }
+
+  const char* data() const { return (const char*)buf_; }
+  size_t size() const { return len_; }
+  uint64_t total() const { return total_; }  // Including bytes beyond N
+  void clear() {
+    lock_.lock();
+    len_ = 0;
+    total_ = 0;
+    lock_.unlock();
+  }
+
+ private:
+  uint8_t buf_[N];
+  size_t len_;
+  uint64_t total_;
+  DebugSpinLock lock_;
+};
+
+/**
+ * stdio stream (host file, or a VFS file on SPIFFS/LittleFS/SD on the
+ * ESP32); buffer_size sets the stdio buffer (0 keeps the default)
+ */
+class DebugFileSink : public DebugSink {
+ public:
+  explicit DebugFileSink(FILE* file, size_t buffer_size = 0)
+      : DebugSink(DEBUG_SINK_BUFFERED | DEBUG_SINK_PERSISTENT), file_(file) {
+    if (file_ && buffer_size) setvbuf(file_, NULL, _IOFBF, buffer_size);
+  }
+  size_t write(const uint8_t* data, size_t len) override { return file_ ? fwrite(data, 1, len, file_) : 0; }
+  void flush() override {
+    if (file_) fflush(file_);
+  }
+
+ private:
+  FILE* file_;
+};
+
+// ============================================================================
+// DISPATCHER
+// ============================================================================
+
+class DebugSinks;
+
+/**
+ * DEBUG_OUT for one level: a Print whose output is dispatched at that
+ * level (used by the level macros via DEBUG_OUT_AT)
+ */
+class DebugSinkLevel : public Print {
+ public:
+  DebugSinkLevel() : sinks_(NULL), level_(DEBUG_SINK_DEFAULT_LEVEL) {}
+  void bind(DebugSinks* sinks, uint8_t level) {
+    sinks_ = sinks;
+    level_ = level;
+  }
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* data, size_t len) override;
+  using Print::write;
+  size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+  void flush() override;
+
+ private:
+  DebugSinks* sinks_;
+  uint8_t level_;
+};
+
+class DebugSinks : public Print {
+ public:
+  DebugSinks() : count_(0), max_level_(0) {
+    for (uint8_t l = 0; l < 8; l++) levels_[l].bind(this, l);
+  }
+
+  /** Register a sink accepting records up to level; false when full */
+  bool add(DebugSink& sink, uint8_t level) {
+    uint8_t n = count_.load(std::memory_order_relaxed);
+    if (n >= DEBUG_SINK_MAX) return false;
+    sink.level = level;
+    sinks_[n] = &sink;
+    if (level > max_level_.load(std::memory_order_relaxed)) max_level_.store(level, std::memory_order_relaxed);
+    count_.store(n + 1, std::memory_order_release);  // Publish after the slot is filled
+    return true;
+  }
+
+  /** True if any sink accepts level - otherwise nothing is formatted */
+  bool wants(uint8_t level) const { return level <= max_level_.load(std::memory_order_relaxed); }
+
+  /** Hand one record to every sink that accepts level */
+  size_t dispatch(uint8_t level, const uint8_t* data, size_t len) {
+    uint8_t n = count_.load(std::memory_order_acquire);
+    for (uint8_t i = 0; i < n; i++) {
+      if (level <= sinks_[i]->level) sinks_[i]->write(data, len);
+    }
+    return len;
+  }
+
+  size_t vprintf(uint8_t level, const char* fmt, va_list args) {
+    if (!wants(level)) return 0;
+    char line[DEBUG_SINK_LINE_MAX];
+    size_t n = debug_vformat_line(line, sizeof(line), fmt, args);
+    return n ? dispatch(level, (const uint8_t*)line, n) : 0;
+  }
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* data, size_t len) override {
+    return wants(DEBUG_SINK_DEFAULT_LEVEL) ? dispatch(DEBUG_SINK_DEFAULT_LEVEL, data, len) : 0;
+  }
+  using Print::write;
+
+  size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+    va_list args;
+    va_start(args, fmt);
+    size_t n = vprintf(DEBUG_SINK_DEFAULT_LEVEL, fmt, args);
+    va_end(args);
+    return n;
+  }
+
+  /** Flush sinks that buffer (DEBUG_SINK_BUFFERED) */
+  void flush() override {
+    uint8_t n = count_.load(std::memory_order_acquire);
+    for (uint8_t i = 0; i < n; i++) {
+      if (sinks_[i]->caps() & DEBUG_SINK_BUFFERED) sinks_[i]->flush();
+    }
+  }
+
+  /** Output object for one level (1-7), for DEBUG_OUT_AT */
+  DebugSinkLevel& at(uint8_t level) { return levels_[level & 7]; }
+
+ private:
+  DebugSink* sinks_[DEBUG_SINK_MAX];
+  std::atomic<uint8_t> count_;
+  std::atomic<uint8_t> max_level_;
+  DebugSinkLevel levels_[8];
+};
+
+inline size_t DebugSinkLevel::write(const uint8_t* data, size_t len) {
+  return sinks_->wants(level_) ? sinks_->dispatch(level_, data, len) : 0;
+}
+
+inline size_t DebugSinkLevel::printf(const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  size_t n = sinks_->vprintf(level_, fmt, args);
+  va_end(args);
+  return n;
+}
+
+inline void DebugSinkLevel::flush() { sinks_->flush(); }
+
+/**
+ * The dispatcher behind DEBUG_OUT (statically allocated on first use)
+ */
+inline DebugSinks& debug_sinks() {
+  static DebugSinks sinks;
+  return sinks;
+}
+
+inline bool debug_sink_add(DebugSink& sink, uint8_t level) { return debug_sinks().add(sink, level); }
+
+#endif  // DEBUG_SINK_H
@@ -0,0 +1,156 @@
+/**
+ * @file debug_tags.h
+ * @brief Runtime per-tag filtering for debug_tagf()
+ *
+ * Tags are declared once, at compile time, as an X-macro list before
+ * debug.h is included (typically from a shared project header):
+ *
+ *   #define DEBUG_TAG_LIST(X) X(CAN) X(SENSOR) X(WIFI)
+ *   #include <debug.h>
+ *
+ * Each tag becomes a small integer ID (DEBUG_TAG_CAN, ...). A 32-bit mask
+ * decides at runtime which tags print, so a disabled trace point costs one
+ * load, one bit test and a branch - the arguments are never formatted.
+ *
+ * The mask can be changed from code or over Serial:
+ *   debug_tag_enable(DEBUG_TAG_CAN, true);
+ *   debug_tag_poll(Serial);   // in loop(): accepts "+CAN", "-SENSOR", "+*", "-*", "=0x5", "?"
+ */
+
+#ifndef DEBUG_TAGS_H
+#define DEBUG_TAGS_H
+
+#pragma once
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <atomic>
+
+#ifndef DEBUG_TAG_LIST
+#define DEBUG_TAG_LIST(X)  // No tags declared
+#endif
+
+#ifndef DEBUG_TAG_DEFAULT_MASK
+#define DEBUG_TAG_DEFAULT_MASK 0xFFFFFFFFu  // All tags enabled at boot
+#endif
+
+#ifndef DEBUG_TAG_CMD_MAX
+#define DEBUG_TAG_CMD_MAX 32  // Longest accepted Serial command line
+#endif
+
+// ============================================================================
+// TAG IDS AND NAMES
+// ============================================================================
+
+#define DEBUG_TAG_ENUM(name) DEBUG_TAG_##name,
+#define DEBUG_TAG_NAME(name) #name,
+
+enum DebugTagId : uint8_t { DEBUG_TAG_LIST(DEBUG_TAG_ENUM) DEBUG_TAG_COUNT };
+
+static_assert(DEBUG_TAG_COUNT <= 32, "At most 32 debug tags fit in the filter mask");
+
+inline const char* const* debug_tag_names() {
+  static const char* const names[] = {DEBUG_TAG_LIST(DEBUG_TAG_NAME) ""};
+  return names;
+}
+
+// ============================================================================
+// FILTER MASK
+// ============================================================================
+
+/**
+ * Bit N set = tag N enabled. Constant-initialized, so reading it needs no
+ * guard check.
+ */
+inline std::atomic<uint32_t>& debug_tag_mask() {
+  static std::atomic<uint32_t> mask(DEBUG_TAG_DEFAULT_MASK);
+  return mask;
+}
+
+inline bool debug_tag_enabled(uint8_t id) {
+  return (debug_tag_mask().load(std::memory_order_relaxed) >> id) & 1u;
+}
+
+inline void debug_tag_enable(uint8_t id, bool on) {
+  if (on) {
+    debug_tag_mask().fetch_or(1u << id, std::memory_order_relaxed);
+  } else {
+    debug_tag_mask().fetch_and(~(1u << id), std::memory_order_relaxed);
+  }
+}
+
+/**
+ * Tag ID for name (case-insensitive), or -1 when unknown
+ */
+inline int debug_tag_find(const char* name) {
+  for (int i = 0; i < DEBUG_TAG_COUNT; i++) {
+    if (strcasecmp(debug_tag_names()[i], name) == 0) return i;
+  }
+  return -1;
+}
+
+// ============================================================================
+// SERIAL CONTROL
+// ============================================================================
+
+/**
+ * Apply one filter command. Returns false for an unknown command/tag.
+ *   +NAME / -NAME   enable / disable one tag
+ *   +* / -*         enable / disable all tags
+ *   =MASK           set the raw mask (decimal or 0x hex)
+ */
+inline bool debug_tag_command(const char* cmd) {
+  while (*cmd == ' ') cmd++;
+  if (*cmd == '=') {
+    debug_tag_mask().store((uint32_t)strtoul(cmd + 1, NULL, 0), std::memory_order_relaxed);
+    return true;
+  }
+  if (*cmd != '+' && *cmd != '-') return false;
+  bool on = *cmd++ == '+';
+  if (strcmp(cmd, "*") == 0) {
+    debug_tag_mask().store(on ? 0xFFFFFFFFu : 0u, std::memory_order_relaxed);
+    return true;
+  }
+  int id = debug_tag_find(cmd);
+  if (id < 0) return false;
+  debug_tag_enable((uint8_t)id, on);
+  return true;
+}
+
+/**
+ * Print every tag and whether it is enabled
+ */
+template <typename Out>
+inline void debug_tag_status(Out& out) {
+  for (int i = 0; i < DEBUG_TAG_COUNT; i++) {
+    out.printf("[TAGS] %c%s\n", debug_tag_enabled((uint8_t)i) ? '+' : '-', debug_tag_names()[i]);
+  }
+}
+
+/**
+ * Read filter commands from a stream without blocking; call from loop().
+ * "?" prints the current tag states.
+ */
+template <typename In>
+inline void debug_tag_poll(In& in) {
+  static char line[DEBUG_TAG_CMD_MAX];
+  static size_t len = 0;
+  while (in.available() > 0) {
+    char c = (char)in.read();
+    if (c != '\n' && c != '\r') {
+      if (len < sizeof(line) - 1) line[len++] = c;
+      continue;
+    }
+    if (!len) continue;
+    line[len] = '\0';
+    len = 0;
+    if (strcmp(line, "?") == 0) {
+      debug_tag_status(in);
+    } else if (!debug_tag_command(line)) {
+      in.printf("[TAGS] unknown command '%s'\n", line);
+    }
+  }
+}
+
+#endif  // DEBUG_TAGS_H
@@ -0,0 +1,152 @@
+/**
+ * @file debug_token.h
+ * @brief Compile-time format-string tokenization
+ *
+ * With DEBUG_TOKENIZE=1, debugf/debugfln/debug_if/debug_tag hash their
+ * format literal at compile time into a 32-bit token (FNV-1a). The literal
+ * itself is placed in a non-loaded ELF section (.log_tokens.*), so it costs
+ * no flash in the image, and only the token plus compactly encoded
+ * arguments are sent at runtime.
+ *
+ * Frame payload (see debug_deferred.h for the frame header):
+ *   u32 token, then per argument, chosen by the argument's C++ type:
+ *     integers, enums, pointers -> zigzag varint (1-10 bytes)
+ *     float, double             -> 4-byte float (doubles are narrowed)
+ *     strings                   -> u8 length + bytes
+ *
+ * The encoder never looks at the format. The decoder (DebugTokenReader)
+ * walks the format's conversions to read the arguments back, so each
+ * conversion must match its argument's kind; DEBUG_FMT_CHECK, on by
+ * default with DEBUG_TOKENIZE, enforces this at compile time.
+ *
+ * tools/debug_tokens.cpp extracts the token database from the ELF and
+ * tools/debug_decode.cpp detokenizes captures.
+ *
+ * Limitation: GCC ignores section attributes on statics inside function
+ * templates (GCC bug 88061); tokens logged from templates are sent but
+ * cannot be found in the database.
+ */
+
+#ifndef DEBUG_TOKEN_H
+#define DEBUG_TOKEN_H
+
+#pragma once
+#include <type_traits>
+#include "debug_deferred.h"
+
+// ============================================================================
+// COMPILE-TIME HASH
+// ============================================================================
+
+/**
+ * 32-bit FNV-1a of a NUL-terminated string. Written as a single-return
+ * recursion so it is a C++11 constant expression.
+ */
+constexpr uint32_t debug_token_hash(const char* s, uint32_t h = 2166136261u) {
+  return *s ? debug_token_hash(s + 1, (h ^ (uint8_t)*s) * 16777619u) : h;
+}
+
+// ============================================================================
+// STRING DATABASE SECTION
+// ============================================================================
+
+#define DEBUG_TOKEN_STR2(x) #x
+#define DEBUG_TOKEN_STR(x) DEBUG_TOKEN_STR2(x)
+
+/**
+ * Each literal gets its own section so inline and non-inline functions do
+ * not conflict. The trailing '#' comments out the flags GCC appends, which
+ * leaves the section without the ALLOC flag: the linker keeps it in the ELF
+ * but it is never loaded into flash.
+ */
+#ifndef DEBUG_TOKEN_SECTION
+#define DEBUG_TOKEN_SECTION(id) ".log_tokens." DEBUG_TOKEN_STR(id) ",\"\",@progbits #"
+#endif
+
+#define DEBUG_TOKEN_ENTRY __attribute__((section(DEBUG_TOKEN_SECTION(__COUNTER__)), used))
+
+// ============================================================================
+// VARINT ENCODER
+// ============================================================================
+
+inline void debug_token_varint(DebugEncoder& e, uint64_t v) {
+  uint8_t tmp[10];
+  size_t n = 0;
+  do {
+    tmp[n++] = (uint8_t)((v & 0x7F) | (v > 0x7F ? 0x80 : 0));
+    v >>= 7;
+  } while (v);
+  if (e.reserve(n)) e.put(tmp, n);
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+debug_token_arg(DebugEncoder& e, T value) {
+  int64_t v = (int64_t)value;
+  debug_token_varint(e, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));  // zigzag
+}
+
+inline void debug_token_arg(DebugEncoder& e, double value) {
+  float f = (float)value;
+  if (e.reserve(4)) e.put(&f, 4);
+}
+
+inline void debug_token_arg(DebugEncoder& e, const char* str) {
+  if (!str) str = "(null)";
+  size_t len = strlen(str);
+  if (len > 255) len = 255;
+  if (!e.reserve(1)) return;
+  size_t room = (size_t)(e.end - e.pos) - 1;
+  if (len > room) len = room;
+  *e.pos++ = (uint8_t)len;
+  e.put(str, len);
+}
+
+inline void debug_token_arg(DebugEncoder& e, char* str) { debug_token_arg(e, (const char*)str); }
+
+template <typename T>
+inline void debug_token_arg(DebugEncoder& e, const T* ptr) {
+  debug_token_arg(e, (uintptr_t)ptr);
+}
+
+inline void debug_token_args(DebugEncoder&) {}
+
+template <typename T, typename... Rest>
+inline void debug_token_args(DebugEncoder& e, T first, Rest... rest) {
+  debug_token_arg(e, first);
+  debug_token_args(e, rest...);
+}
+
+/**
+ * Encode one token frame and write it with a single out.write()
+ */
+template <typename Out, typename... Args>
+inline void debug_token_log(Out& out, uint8_t kind, uint32_t token, Args... args) {
+  uint8_t frame[3 + DEBUG_DEFERRED_MAX];
+  DebugEncoder e(frame + 3, frame + sizeof(frame));
+  e.reserve(4);
+  e.put(&token, 4);
+  debug_token_args(e, args...);
+  frame[0] = DEBUG_FRAME_MARK;
+  frame[1] = kind;
+  frame[2] = (uint8_t)(e.pos - (frame + 3));
+  out.write(frame, (size_t)(e.pos - frame));
+}
+
+/**
+ * Record fmt in the token section and log its token with the arguments.
+ * fmt must be a string literal.
+ */
+#define DEBUG_TOKEN_LOG(kind, fmt, ...) DEBUG_TOKEN_LOG_TO(DEBUG_OUT, kind, fmt, ##__VA_ARGS__)
+
+/**
+ * Same, to a given output object
+ */
+#define DEBUG_TOKEN_LOG_TO(out, kind, fmt, ...) do { \
+  static const char _debug_token_str[] DEBUG_TOKEN_ENTRY = fmt; \
+  (void)_debug_token_str; \
+  debug_token_log(out, kind, \
+                  std::integral_constant<uint32_t, debug_token_hash(fmt)>::value, ##__VA_ARGS__); \
+} while(0)
+
+#endif  // DEBUG_TOKEN_H
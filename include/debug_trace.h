@@ -0,0 +1,222 @@
+/**
+ * @file debug_trace.h
+ * @brief Span recording for timeline (Chrome Trace / Perfetto) export
+ *
+ * With DEBUG_TRACE=1 every DEBUG_SCOPE also records a begin and an end
+ * event into a static flight-recorder buffer (oldest events are
+ * overwritten). Events are 8 bytes: cycle timestamp, scope ID, task ID,
+ * core ID and type.
+ *
+ * debug_trace_dump() writes the buffer as binary frames (debug_frame.h);
+ * tools/debug_trace.cpp converts a capture into Chrome Trace Event JSON
+ * that opens in https://ui.perfetto.dev with one track per core and task.
+ *
+ * Each core stamps events with its own cycle counter, and the counters of
+ * the two ESP32 cores are not synchronized. The dump therefore also writes
+ * one clock anchor per core (that core's cycle count sampled together with
+ * the shared esp_timer microseconds), and the converter places each core's
+ * events on the common timeline through its own anchor.
+ */
+
+#ifndef DEBUG_TRACE_H
+#define DEBUG_TRACE_H
+
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include "debug_frame.h"
+
+#if defined(ESP_PLATFORM)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#else
+#include <thread>
+#endif
+
+#ifndef DEBUG_TRACE_EVENTS
+#define DEBUG_TRACE_EVENTS 1024  // Buffered events (power of two), 8 bytes each
+#endif
+
+#ifndef DEBUG_TRACE_TASKS
+#define DEBUG_TRACE_TASKS 16  // Distinct tasks named in the trace
+#endif
+
+static_assert((DEBUG_TRACE_EVENTS & (DEBUG_TRACE_EVENTS - 1)) == 0,
+              "DEBUG_TRACE_EVENTS must be a power of two");
+
+// ============================================================================
+// EVENT BUFFER
+// ============================================================================
+
+enum DebugTraceType : uint8_t {
+  DEBUG_TRACE_BEGIN = 0,
+  DEBUG_TRACE_END = 1
+};
+
+/**
+ * One span boundary. Packed to 8 bytes; also the wire format.
+ */
+struct DebugTraceEvent {
+  uint32_t cycles;
+  uint8_t name;  // Profile slot index
+  uint8_t task;  // Index into the trace task table
+  uint8_t core;
+  uint8_t type;  // DebugTraceType
+};
+
+static_assert(sizeof(DebugTraceEvent) == 8, "DebugTraceEvent must stay 8 bytes");
+
+/**
+ * One core's cycle counter sampled at a shared-clock time
+ */
+struct DebugTraceClock {
+  uint8_t core;
+  uint32_t cycles;
+  uint64_t us;  // esp_timer_get_time() (host: steady_clock)
+};
+
+struct DebugTraceBuffer {
+  DebugTraceEvent events[DEBUG_TRACE_EVENTS];
+  std::atomic<uint32_t> head;       // Total events ever recorded
+  std::atomic<bool> paused;         // Set while dumping
+  std::atomic<uint32_t> writers;    // Records in progress; the dump waits for 0
+  const char* tasks[DEBUG_TRACE_TASKS];
+  std::atomic<uint32_t> task_count;
+};
+
+inline DebugTraceBuffer& debug_trace_buffer() {
+  static DebugTraceBuffer buffer;
+  return buffer;
+}
+
+/**
+ * Small per-task ID, assigned on the task's first event
+ */
+inline uint8_t debug_trace_task() {
+  static thread_local uint8_t id = 0xFF;
+  if (id != 0xFF) return id;
+  DebugTraceBuffer& b = debug_trace_buffer();
+  uint32_t n = b.task_count.fetch_add(1, std::memory_order_relaxed);
+  if (n >= DEBUG_TRACE_TASKS) {
+    id = DEBUG_TRACE_TASKS - 1;  // Overflow tasks share the last ID
+    return id;
+  }
+#if defined(ESP_PLATFORM)
+  b.tasks[n] = pcTaskGetName(NULL);
+#else
+  b.tasks[n] = "thread";
+#endif
+  id = (uint8_t)n;
+  return id;
+}
+
+inline uint8_t debug_trace_core() {
+#if defined(ESP_PLATFORM)
+  return (uint8_t)xPortGetCoreID();
+#else
+  return 0;
+#endif
+}
+
+/**
+ * Append one event. Lock-free: a slot is claimed with fetch_add and the
+ * ring simply wraps, overwriting the oldest events.
+ *
+ * The writer count is raised before `paused` is checked (both sequentially
+ * consistent), so once the dump has set `paused` and seen the count reach
+ * zero, no producer can still be writing into the buffer.
+ */
+inline void debug_trace_record(uint8_t name, uint8_t type, uint32_t cycles) {
+  DebugTraceBuffer& b = debug_trace_buffer();
+  b.writers.fetch_add(1);
+  if (!b.paused.load()) {
+    uint32_t i = b.head.fetch_add(1, std::memory_order_relaxed) & (DEBUG_TRACE_EVENTS - 1);
+    DebugTraceEvent& e = b.events[i];
+    e.cycles = cycles;
+    e.name = name;
+    e.task = debug_trace_task();
+    e.core = debug_trace_core();
+    e.type = type;
+  }
+  b.writers.fetch_sub(1, std::memory_order_release);
+}
+
+/**
+ * Wait for producers that passed the `paused` check before it was set
+ */
+inline void debug_trace_quiesce() {
+  DebugTraceBuffer& b = debug_trace_buffer();
+  while (b.writers.load(std::memory_order_acquire)) {
+#if defined(ESP_PLATFORM)
+    vTaskDelay(1);  // The writer may be a preempted lower-priority task
+#else
+    std::this_thread::yield();
+#endif
+  }
+}
+
+// ============================================================================
+// DUMP
+// ============================================================================
+
+/**
+ * Write the trace as frames: info, clock anchors, scope names, task names,
+ * then events oldest first. names/count come from the profile table and
+ * clocks holds one anchor per core. Recording is paused (and in-flight
+ * records finished) while dumping, and the buffer is cleared afterwards.
+ */
+template <typename Out>
+inline void debug_trace_write(Out& out, uint32_t cycles_per_us, const char* const* names,
+                              uint32_t name_count, const DebugTraceClock* clocks,
+                              uint32_t clock_count) {
+  DebugTraceBuffer& b = debug_trace_buffer();
+  b.paused.store(true);
+  debug_trace_quiesce();
+  uint8_t payload[DEBUG_FRAME_MAX];
+
+  debug_frame_write(out, DEBUG_FRAME_TRACE_INFO, &cycles_per_us, 4);
+
+  for (uint32_t i = 0; i < clock_count; i++) {
+    payload[0] = clocks[i].core;
+    memcpy(payload + 1, &clocks[i].cycles, 4);
+    memcpy(payload + 5, &clocks[i].us, 8);
+    debug_frame_write(out, DEBUG_FRAME_TRACE_CLOCK, payload, 13);
+  }
+
+  for (uint32_t i = 0; i < name_count; i++) {
+    size_t len = strlen(names[i]);
+    if (len > DEBUG_FRAME_MAX - 1) len = DEBUG_FRAME_MAX - 1;
+    payload[0] = (uint8_t)i;
+    memcpy(payload + 1, names[i], len);
+    debug_frame_write(out, DEBUG_FRAME_TRACE_NAME, payload, len + 1);
+  }
+
+  uint32_t tasks = b.task_count.load(std::memory_order_relaxed);
+  if (tasks > DEBUG_TRACE_TASKS) tasks = DEBUG_TRACE_TASKS;
+  for (uint32_t i = 0; i < tasks; i++) {
+    const char* name = b.tasks[i] ? b.tasks[i] : "?";
+    size_t len = strlen(name);
+    if (len > DEBUG_FRAME_MAX - 1) len = DEBUG_FRAME_MAX - 1;
+    payload[0] = (uint8_t)i;
+    memcpy(payload + 1, name, len);
+    debug_frame_write(out, DEBUG_FRAME_TRACE_TASK, payload, len + 1);
+  }
+
+  uint32_t head = b.head.load(std::memory_order_relaxed);
+  uint32_t count = head < DEBUG_TRACE_EVENTS ? head : DEBUG_TRACE_EVENTS;
+  const uint32_t per_frame = DEBUG_FRAME_MAX / sizeof(DebugTraceEvent);
+  for (uint32_t i = head - count; i != head;) {
+    uint32_t n = 0;
+    for (; n < per_frame && i != head; n++, i++) {
+      memcpy(payload + n * sizeof(DebugTraceEvent), &b.events[i & (DEBUG_TRACE_EVENTS - 1)],
+             sizeof(DebugTraceEvent));
+    }
+    debug_frame_write(out, DEBUG_FRAME_TRACE_EVENTS, payload, n * sizeof(DebugTraceEvent));
+  }
+
+  b.head.store(0, std::memory_order_relaxed);
+  b.paused.store(false, std::memory_order_release);
+}
+
+#endif  // DEBUG_TRACE_H
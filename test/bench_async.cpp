@@ -0,0 +1,50 @@
+/**
+ * @file bench_async.cpp
+ * @brief ns/call of the DEBUG_ASYNC backend: the caller's cost (format and
+ *        ring write) with the ring drained between calls, and when full
+ *
+ * The host Serial is an in-memory string, so the synchronous baseline
+ * has none of the UART wait the ring exists to hide; what the async lines
+ * show is the caller's own cost. Host numbers are for comparing changes,
+ * not predictions of ESP32 cost.
+ */
+
+#define DEBUG 1
+#define DEBUG_LEVEL DEBUG_LEVEL_INFO
+#define DEBUG_ASYNC 1
+
+#include <debug.h>
+#include "debug_bench.h"
+
+int main() {
+  volatile int x = 1234;
+  DebugAsyncOutput& out = debug_async_output();
+  unsigned n = 0;
+
+  // Drain every 32 calls: the ring never fills, the drain is amortized
+  debug_bench("async debug(\"text\") (drain/32)", [&] {
+    debug("text");
+    if (++n % 32 == 0) out.flush();
+  });
+  debug_bench("async debugfln(\"x=%d y=%s\") (drain/32)", [&] {
+    debugfln("x=%d y=%s", x, "abc");
+    if (++n % 32 == 0) out.flush();
+  });
+  debug_bench("async debug_info (drain/32)", [&] {
+    debug_info("x=%d", x);
+    if (++n % 32 == 0) out.flush();
+  });
+  debug_bench("async debugfln + drain every call", [&] {
+    debugfln("x=%d y=%s", x, "abc");
+    out.flush();
+  });
+
+  // Nobody drains: every write is refused (DEBUG_DROP_NEWEST)
+  for (int i = 0; i < 1000; i++) debugfln("fill %d", i);
+  debug_bench("async debugfln, ring full (dropped)", [&] { debugfln("x=%d y=%s", x, "abc"); });
+  out.flush();
+
+  debug_bench("sync Serial.printf (baseline)", [&] { Serial.printf("x=%d y=%s\n", (int)x, "abc"); });
+  printf("dropped %lu bytes\n", (unsigned long)debug_async_dropped());
+  return 0;
+}
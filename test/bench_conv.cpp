@@ -0,0 +1,40 @@
+/**
+ * @file bench_conv.cpp
+ * @brief ns/call of the debug_conv.h kernels next to the snprintf calls
+ *        they replace
+ */
+
+#define DEBUG 1
+
+#include <debug.h>
+#include "debug_bench.h"
+
+int main() {
+  static const uint32_t ints[8] = {0, 7, 42, 1234, 98765, 4000000, 123456789, 4294967295u};
+  static const float floats[8] = {0.0f, 1.5f, -21.75f, 3.14159f, 1234.5678f, -0.001f, 98765.43f, 1e12f};
+  unsigned i = 0;
+  char buf[64];
+
+  debug_bench("debug_conv_u32", [&] {
+    char* end = buf + 12;
+    debug_bench_keep(debug_conv_u32(end, ints[i++ & 7]));
+  });
+  debug_bench("snprintf %u", [&] { debug_bench_keep(snprintf(buf, sizeof(buf), "%u", ints[i++ & 7])); });
+  debug_bench("debug_conv_u64", [&] {
+    char* end = buf + 24;
+    debug_bench_keep(debug_conv_u64(end, (uint64_t)ints[i & 7] * ints[(i + 3) & 7]));
+    i++;
+  });
+  debug_bench("snprintf %llu", [&] {
+    debug_bench_keep(snprintf(buf, sizeof(buf), "%llu", (unsigned long long)ints[i & 7] * ints[(i + 3) & 7]));
+    i++;
+  });
+  debug_bench("debug_conv_hex", [&] { debug_bench_keep(debug_conv_hex(buf, ints[i++ & 7], 2)); });
+  debug_bench("snprintf %02X", [&] { debug_bench_keep(snprintf(buf, sizeof(buf), "%02X", ints[i++ & 7])); });
+  debug_bench("debug_conv_bin (32 bits)", [&] { debug_bench_keep(debug_conv_bin(buf, ints[i++ & 7], 32)); });
+  debug_bench("debug_conv_float (2 decimals)", [&] { debug_bench_keep(debug_conv_float(buf, floats[i++ & 7], 2)); });
+  debug_bench("snprintf %.2f", [&] {
+    debug_bench_keep(snprintf(buf, sizeof(buf), "%.2f", (double)floats[i++ & 7]));
+  });
+  return 0;
+}
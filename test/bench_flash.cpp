@@ -0,0 +1,66 @@
+/**
+ * @file bench_flash.cpp
+ * @brief Write amplification of the flash log on the simulated device:
+ *        bytes programmed and sectors erased per payload byte, batched
+ *        (flush task) against one block per line (flush after every line)
+ *
+ * Amplification counts programmed bytes; "with erases" adds a full
+ * sector per erase, the cost that wears the flash. Host time per line is
+ * for comparing changes only (the file stands in for the flash).
+ */
+
+#define DEBUG 1
+#define DEBUG_FLASH 1
+#define DEBUG_FLASH_ECHO 0
+
+#include <unistd.h>
+#include <chrono>
+#include <debug.h>
+
+static void run(const char* name, size_t line_len, bool flush_each) {
+  char path[] = "/tmp/debug_flash_bench_XXXXXX";
+  close(mkstemp(path));
+  unlink(path);
+  DebugFlashFile* file = new DebugFlashFile(path, 64 * DEBUG_FLASH_SECTOR);
+  DebugFlashOutput* out = new DebugFlashOutput();
+  out->mount(*file);
+  uint64_t programmed0 = file->programmed();
+  uint32_t erases0 = file->erases();
+
+  char line[256];
+  memset(line, 'x', line_len);
+  line[line_len - 1] = '\n';
+  const size_t payload = 1024 * 1024;
+  size_t lines = payload / line_len;
+  typedef std::chrono::steady_clock clock;
+  clock::time_point start = clock::now();
+  for (size_t i = 0; i < lines; i++) {
+    out->write((const uint8_t*)line, line_len);
+    if (flush_each) {
+      out->flush();
+    } else {
+      out->flush_step(false);
+    }
+  }
+  out->flush();
+  double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count() / lines;
+
+  double bytes = (double)(lines * line_len);
+  double programmed = (double)(file->programmed() - programmed0);
+  double erased = (double)(file->erases() - erases0) * DEBUG_FLASH_SECTOR;
+  printf("%-34s %5.2fx, with erases %5.2fx, %6.1f erases/MB, %8.0f ns/line\n", name, programmed / bytes,
+         (programmed + erased) / bytes, (file->erases() - erases0) / (bytes / (1024 * 1024)), ns);
+  delete out;
+  delete file;
+  unlink(path);
+}
+
+int main() {
+  run("batched, 16-byte lines", 16, false);
+  run("batched, 64-byte lines", 64, false);
+  run("batched, 200-byte lines", 200, false);
+  run("block per line, 16-byte lines", 16, true);
+  run("block per line, 64-byte lines", 64, true);
+  run("block per line, 200-byte lines", 200, true);
+  return 0;
+}
@@ -0,0 +1,63 @@
+/**
+ * @file bench_formatter.cpp
+ * @brief DEBUG_FAST_FORMAT against Serial.printf (vsnprintf) for the same
+ *        lines, ns/call on the host shim
+ *
+ * Both columns end in the same captured Serial, so the difference is the
+ * formatting. Host numbers are for comparing changes, not predictions of
+ * ESP32 cost, where newlib's float printing is much slower than glibc's.
+ */
+
+#define DEBUG 1
+#define DEBUG_FAST_FORMAT 1
+
+#include <debug.h>
+#include "debug_bench.h"
+
+static void row(const char* name, double printf_ns, double template_ns) {
+  printf("  -> %-34s %6.2fx\n", name, printf_ns / template_ns);
+}
+
+int main() {
+  static const int ints[8] = {0, 7, -42, 1234, 98765, -4000000, 123456789, 2147483647};
+  static const float floats[8] = {0.0f, 1.5f, -21.75f, 3.14159f, 1234.5678f, -0.001f, 98765.43f, 21.5f};
+  static const char* names[4] = {"IDLE", "CONNECTING", "RUN", "FAULT"};
+  unsigned i = 0;
+
+  double a = debug_bench("Serial.printf ints", [&] {
+    Serial.printf("X=%d, Y=%u, Z=0x%08X\n", ints[i & 7], (unsigned)ints[(i + 1) & 7], (unsigned)ints[(i + 2) & 7]);
+    i++;
+  });
+  double b = debug_bench("debugf ints", [&] {
+    debugf("X=%d, Y=%u, Z=0x%08X\n", ints[i & 7], (unsigned)ints[(i + 1) & 7], (unsigned)ints[(i + 2) & 7]);
+    i++;
+  });
+  row("ints", a, b);
+
+  a = debug_bench("Serial.printf floats", [&] {
+    Serial.printf("T=%.2f H=%.1f\n", (double)floats[i & 7], (double)floats[(i + 3) & 7]);
+    i++;
+  });
+  b = debug_bench("debugf floats", [&] {
+    debugf("T=%.2f H=%.1f\n", floats[i & 7], floats[(i + 3) & 7]);
+    i++;
+  });
+  row("floats", a, b);
+
+  a = debug_bench("Serial.printf %g", [&] {
+    Serial.printf("v=%g\n", (double)floats[i++ & 7]);
+  });
+  b = debug_bench("debugf %g", [&] { debugf("v=%g\n", floats[i++ & 7]); });
+  row("%g", a, b);
+
+  a = debug_bench("Serial.printf strings", [&] {
+    Serial.printf("[%s] state=%s n=%d\n", "NET", names[i & 3], ints[i & 7]);
+    i++;
+  });
+  b = debug_bench("debugf strings", [&] {
+    debugf("[%s] state=%s n=%d\n", "NET", names[i & 3], ints[i & 7]);
+    i++;
+  });
+  row("strings", a, b);
+  return 0;
+}
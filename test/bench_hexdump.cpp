@@ -0,0 +1,62 @@
+/**
+ * @file bench_hexdump.cpp
+ * @brief debug_array() throughput against the printf-per-byte macro it
+ *        replaced, and the number of output writes per dump
+ *
+ * Host numbers are for comparing changes, not predictions of ESP32 cost;
+ * on the device every write is also a trip into the UART driver.
+ */
+
+#define DEBUG 1
+#define DEBUG_LEVEL DEBUG_LEVEL_INFO
+
+#include <debug.h>
+#include "debug_bench.h"
+
+// The debug_array() of earlier releases: one printf per byte, no ASCII column
+template <typename Out>
+static void old_debug_array(Out& out, const void* data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    out.printf("%02X ", ((const uint8_t*)data)[i]);
+    if ((i + 1) % 16 == 0) out.println();
+  }
+  out.println();
+}
+
+// Counts write() calls and discards the bytes
+class CountingPrint : public Print {
+ public:
+  CountingPrint() : writes(0) {}
+  size_t write(uint8_t) override {
+    writes++;
+    return 1;
+  }
+  size_t write(const uint8_t*, size_t n) override {
+    writes++;
+    return n;
+  }
+  using Print::write;
+  unsigned long writes;
+};
+
+int main() {
+  static uint8_t data[4096];
+  for (size_t i = 0; i < sizeof(data); i++) data[i] = (uint8_t)(i * 7 + 3);
+  const size_t sizes[] = {16, 256, 4096};
+
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    size_t len = sizes[s];
+    char name[64];
+    snprintf(name, sizeof(name), "old macro, %u bytes", (unsigned)len);
+    double old_ns = debug_bench(name, [&] { old_debug_array(Serial, data, len); });
+    snprintf(name, sizeof(name), "debug_array, %u bytes", (unsigned)len);
+    double new_ns = debug_bench(name, [&] { debug_array(data, len); });
+
+    CountingPrint old_out, new_out;
+    old_debug_array(old_out, data, len);
+    debug_hexdump(new_out, data, len);
+    printf("  %.0f vs %.0f MB/s, %lu vs %lu writes per dump\n", len * 1e3 / old_ns, len * 1e3 / new_ns,
+           old_out.writes, new_out.writes);
+  }
+  return 0;
+}
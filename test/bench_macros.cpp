@@ -0,0 +1,44 @@
+/**
+ * @file bench_macros.cpp
+ * @brief ns/call of each output macro against the in-memory native Serial
+ *
+ * Host numbers are for comparing changes, not predictions of ESP32 cost.
+ */
+
+#define DEBUG 1
+#define DEBUG_LEVEL DEBUG_LEVEL_INFO
+#define DEBUG_TAG_LIST(X) X(CAN)
+
+#include <debug.h>
+#include "debug_bench.h"
+
+int main() {
+  volatile int x = 1234;
+  volatile float f = 21.5f;
+  static const uint8_t data[64] = {0x42, 0x12, 'H', 'i'};
+
+  debug_bench("debug(int)", [&] { debug(x); });
+  debug_bench("debugln(\"text\")", [&] { debugln("text"); });
+  debug_bench("debugf(\"x=%d\")", [&] { debugf("x=%d", x); });
+  debug_bench("debugfln(\"x=%d y=%s\")", [&] { debugfln("x=%d y=%s", x, "abc"); });
+  debug_bench("debug_hex", [&] { debug_hex(x); });
+  debug_bench("debug_bin", [&] { debug_bin(x); });
+  debug_bench("debug_binw(16)", [&] { debug_binw(x, 16); });
+  debug_bench("debug_bits(3 fields)", [&] { debug_bits(x, "EN:1,MODE:3,IRQ:4"); });
+  debug_bench("debug_array(64)", [&] { debug_array(data, sizeof(data)); });
+  debug_bench("debug_val(int)", [&] { debug_val("x", (int)x); });
+  debug_bench("debug_val(float)", [&] { debug_val("f", (float)f); });
+  debug_bench("debug_tag", [&] { debug_tag("[CAN]", "rx"); });
+  debug_bench("debug_if(false)", [&] { debug_if(x < 0, "x=%d", x); });
+  debug_bench("debug_info", [&] { debug_info("x=%d", x); });
+  debug_bench("debug_debug (below level)", [&] { debug_debug("x=%d", x); });
+  debug_bench("debug_tagf (enabled)", [&] { debug_tagf(CAN, "x=%d", x); });
+  debug_bench("debug_ratelimit (suppressed)", [&] { debug_ratelimit(1, 1, "x=%d", x); });
+  debug_bench("debug_sample(1000)", [&] { debug_sample(1000, "x=%d", x); });
+  debug_bench("DEBUG_SCOPE", [&] { DEBUG_SCOPE("bench"); });
+  debug_bench("debugf_isr + drain", [&] {
+    debugf_isr("x=%d", x);
+    debug_isr_drain();
+  });
+  return 0;
+}
@@ -0,0 +1,96 @@
+/**
+ * @file bench_ring.cpp
+ * @brief Producer cost of DebugRing against a mutex-protected ring as the
+ *        number of writing threads grows
+ *
+ * Each producer writes 48-byte lines while one consumer drains. Reported
+ * figure is wall time per write across all producers. The mutex ring is
+ * the same record layout behind std::mutex, i.e. what the async backend
+ * did before the lock-free queue.
+ */
+
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <debug_ring.h>
+
+static const size_t kRing = 8192;
+static const uint32_t kWrites = 200000;  // Per producer
+
+class MutexRing {
+ public:
+  MutexRing() : head_(0), tail_(0) {}
+
+  size_t write(const uint8_t* data, size_t len, DebugOverflowPolicy, uint32_t = 0) {
+    for (;;) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (head_ - tail_ + len + 2 <= kRing) {
+          put((uint8_t)len);
+          put((uint8_t)(len >> 8));
+          for (size_t i = 0; i < len; i++) put(data[i]);
+          return len;
+        }
+      }
+      std::this_thread::yield();  // DEBUG_BLOCK
+    }
+  }
+
+  int pop(uint8_t* out, size_t, uint32_t*) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (head_ == tail_) return -1;
+    size_t len = get() | (size_t)get() << 8;
+    for (size_t i = 0; i < len; i++) out[i] = get();
+    return (int)len;
+  }
+
+ private:
+  void put(uint8_t b) { buf_[head_++ & (kRing - 1)] = b; }
+  uint8_t get() { return buf_[tail_++ & (kRing - 1)]; }
+
+  std::mutex mutex_;
+  uint8_t buf_[kRing];
+  size_t head_, tail_;
+};
+
+template <typename Ring>
+static double run(Ring& ring, int producers) {
+  std::atomic<int> running(producers);
+  std::atomic<bool> go(false);
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; p++) {
+    threads.push_back(std::thread([&] {
+      uint8_t line[48];
+      memset(line, 'x', sizeof(line));
+      while (!go.load()) std::this_thread::yield();
+      for (uint32_t i = 0; i < kWrites; i++) ring.write(line, sizeof(line), DEBUG_BLOCK);
+      running--;
+    }));
+  }
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  go = true;
+  uint8_t rec[256];
+  while (running.load() || ring.pop(rec, sizeof(rec), NULL) >= 0) {
+    while (ring.pop(rec, sizeof(rec), NULL) >= 0) {
+    }
+    std::this_thread::yield();  // Let producers run on small machines
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  for (size_t t = 0; t < threads.size(); t++) threads[t].join();
+  return ns / ((double)kWrites * producers);
+}
+
+int main() {
+  static DebugRing<kRing> lockfree;
+  static MutexRing locked;
+  printf("%-10s %14s %14s\n", "producers", "mutex ns/op", "lock-free ns/op");
+  for (int p = 1; p <= 4; p *= 2) {
+    double m = run(locked, p);
+    double l = run(lockfree, p);
+    printf("%-10d %14.1f %14.1f\n", p, m, l);
+  }
+  return 0;
+}
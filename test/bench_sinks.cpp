@@ -0,0 +1,92 @@
+/**
+ * @file bench_sinks.cpp
+ * @brief DebugSinks dispatch overhead: one record written straight to a
+ *        sink against the dispatcher fanning it out to 1, 2 and 4 memory
+ *        and file sinks, and format-once against formatting per sink
+ *
+ * File sinks write to /dev/null through a 4 KB stdio buffer, so their
+ * rows are stdio cost, not disk cost.
+ */
+
+#define DEBUG 1
+
+#include <debug.h>
+#include <debug_sink.h>
+#include "debug_bench.h"
+
+static const char line[] = "[W] battery low: 3.41 V, 12 % left, uptime 123456 ms\n";
+static const size_t line_len = sizeof(line) - 1;
+
+typedef DebugMemorySink<1 << 16> MemorySink;
+
+// Keep copying, not just counting, once a sink is full
+static void drain(MemorySink* sinks, int n) {
+  for (int i = 0; i < n; i++) {
+    if (sinks[i].size() > (1 << 15)) sinks[i].clear();
+  }
+}
+
+int main() {
+  static MemorySink mem[4];
+  FILE* null_files[4];
+  DebugFileSink* files[4];
+  for (int i = 0; i < 4; i++) {
+    null_files[i] = fopen("/dev/null", "w");
+    files[i] = new DebugFileSink(null_files[i], 4096);
+  }
+
+  double direct = debug_bench("memory sink, direct write", [&] {
+    mem[0].write((const uint8_t*)line, line_len);
+    drain(mem, 1);
+  });
+  static DebugSinks to_mem[3];
+  static const int fan[3] = {1, 2, 4};
+  for (int k = 0; k < 3; k++) {
+    for (int i = 0; i < fan[k]; i++) to_mem[k].add(mem[i], DEBUG_LEVEL_TRACE);
+    char name[48];
+    snprintf(name, sizeof(name), "dispatch to %d memory sink(s)", fan[k]);
+    double ns = debug_bench(name, [&] {
+      to_mem[k].at(DEBUG_LEVEL_WARN).write((const uint8_t*)line, line_len);
+      drain(mem, fan[k]);
+    });
+    printf("  -> %.1f ns over %d direct write(s)\n", ns - fan[k] * direct, fan[k]);
+  }
+  debug_bench("dispatch, level no sink accepts", [&] {
+    debug_bench_keep(to_mem[2].at(DEBUG_LEVEL_TRACE + 1).write((const uint8_t*)line, line_len));
+  });
+
+  direct = debug_bench("file sink, direct write", [&] { files[0]->write((const uint8_t*)line, line_len); });
+  static DebugSinks to_file[3];
+  for (int k = 0; k < 3; k++) {
+    for (int i = 0; i < fan[k]; i++) to_file[k].add(*files[i], DEBUG_LEVEL_TRACE);
+    char name[48];
+    snprintf(name, sizeof(name), "dispatch to %d file sink(s)", fan[k]);
+    double ns = debug_bench(name, [&] { to_file[k].at(DEBUG_LEVEL_WARN).write((const uint8_t*)line, line_len); });
+    printf("  -> %.1f ns over %d direct write(s)\n", ns - fan[k] * direct, fan[k]);
+  }
+
+  // Formatted records: the dispatcher formats once for all sinks
+  int i = 0;
+  debug_bench("printf once, 4 memory sinks", [&] {
+    to_mem[2].at(DEBUG_LEVEL_WARN).printf("[W] battery low: %.2f V, %d %% left, uptime %lu ms\n", 3.41, 12 - (i & 3),
+                                           123456ul + i);
+    drain(mem, 4);
+    i++;
+  });
+  debug_bench("snprintf per sink, 4 memory sinks", [&] {
+    for (int s = 0; s < 4; s++) {
+      char buf[DEBUG_SINK_LINE_MAX];
+      int n = snprintf(buf, sizeof(buf), "[W] battery low: %.2f V, %d %% left, uptime %lu ms\n", 3.41, 12 - (i & 3),
+                       123456ul + i);
+      mem[s].write((const uint8_t*)buf, (size_t)n);
+    }
+    drain(mem, 4);
+    i++;
+  });
+
+  for (int k = 0; k < 4; k++) {
+    delete files[k];
+    fclose(null_files[k]);
+  }
+  return 0;
+}
@@ -0,0 +1,43 @@
+/**
+ * @file bench_tags.cpp
+ * @brief ns/call of debug_tagf() with its tag disabled (one load, one bit
+ *        test, a branch) against a name lookup and the enabled path
+ *
+ * "strcmp filter" is the alternative the bit mask replaces: scan a table
+ * of enabled tag names for every call. Host numbers are for comparing
+ * changes, not predictions of ESP32 cost.
+ */
+
+#define DEBUG 1
+#define DEBUG_LEVEL DEBUG_LEVEL_INFO
+#define DEBUG_TAG_LIST(X) X(CAN) X(SENSOR) X(WIFI) X(MQTT) X(OTA) X(UI) X(GPS) X(BLE)
+
+#include <string.h>
+#include <debug.h>
+#include "debug_bench.h"
+
+static const char* enabled_names[] = {"SENSOR", "WIFI", "MQTT", "OTA", "UI", "GPS", "BLE"};
+
+__attribute__((noinline)) static bool name_enabled(const char* tag) {
+  for (size_t i = 0; i < sizeof(enabled_names) / sizeof(enabled_names[0]); i++) {
+    if (!strcmp(enabled_names[i], tag)) return true;
+  }
+  return false;
+}
+
+int main() {
+  volatile int x = 1234;
+  debug_tag_enable(DEBUG_TAG_CAN, false);
+
+  debug_bench("empty call (loop overhead)", [&] { debug_bench_keep(x); });
+  debug_bench("debug_tagf (disabled)", [&] { debug_tagf(CAN, "x=%d", x); });
+  debug_bench("strcmp filter over 7 names (disabled)", [&] {
+    if (name_enabled("CAN")) debugfln("[CAN] x=%d", x);
+  });
+  debug_bench("debug_tagf (enabled)", [&] { debug_tagf(SENSOR, "x=%d", x); });
+  debug_bench("debug_tag_enable toggle", [&] {
+    debug_tag_enable(DEBUG_TAG_WIFI, false);
+    debug_tag_enable(DEBUG_TAG_WIFI, true);
+  });
+  return 0;
+}
@@ -0,0 +1,102 @@
+/**
+ * @file bench_trace.cpp
+ * @brief tools/debug_trace conversion throughput: a large synthetic dump
+ *        converted to Chrome Trace JSON, in events per second
+ *
+ * The capture has one clock anchor and nested spans from two cores and
+ * four tasks, far more events than a device buffer holds, so the number
+ * is the converter's cost per event rather than process start-up. JSON
+ * goes to /dev/null; the best of several runs is reported.
+ */
+
+#define DEBUG 1
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <debug.h>
+#include <debug_trace.h>
+
+#ifndef BENCH_TRACE_EVENTS
+#define BENCH_TRACE_EVENTS 1000000
+#endif
+
+#ifndef BENCH_TRACE_RUNS
+#define BENCH_TRACE_RUNS 3
+#endif
+
+struct TraceCapture {
+  std::string bytes;
+  size_t write(const uint8_t* p, size_t n) {
+    bytes.append((const char*)p, n);
+    return n;
+  }
+};
+
+int main() {
+  TraceCapture cap;
+  uint32_t per_us = 240;
+  debug_frame_write(cap, DEBUG_FRAME_TRACE_INFO, &per_us, 4);
+  uint8_t clock[13] = {0};
+  uint32_t cycles = 0;
+  uint64_t us = 1000000;
+  memcpy(clock + 1, &cycles, 4);
+  memcpy(clock + 5, &us, 8);
+  debug_frame_write(cap, DEBUG_FRAME_TRACE_CLOCK, clock, sizeof(clock));
+  static const char* names[4] = {"loop", "sensor", "net", "flush"};
+  for (uint8_t i = 0; i < 4; i++) {
+    uint8_t payload[16] = {i};
+    size_t len = strlen(names[i]);
+    memcpy(payload + 1, names[i], len);
+    debug_frame_write(cap, DEBUG_FRAME_TRACE_NAME, payload, len + 1);
+  }
+
+  // Per task: outer span, inner span, inner end, outer end
+  const uint32_t per_frame = DEBUG_FRAME_MAX / sizeof(DebugTraceEvent);
+  DebugTraceEvent frame[DEBUG_FRAME_MAX / sizeof(DebugTraceEvent)];
+  uint32_t n = 0;
+  for (uint32_t i = 0; i < BENCH_TRACE_EVENTS; i++) {
+    DebugTraceEvent& e = frame[n++];
+    uint32_t step = (i / 4) % 4;
+    static const uint8_t type[4] = {DEBUG_TRACE_BEGIN, DEBUG_TRACE_BEGIN, DEBUG_TRACE_END, DEBUG_TRACE_END};
+    static const uint8_t name[4] = {0, 1, 1, 0};
+    e.task = (uint8_t)(i % 4);
+    e.core = e.task & 1;
+    e.cycles = cycles += 97;
+    e.type = type[step];
+    e.name = (uint8_t)(name[step] + (e.task & 2));
+    if (n == per_frame) {
+      debug_frame_write(cap, DEBUG_FRAME_TRACE_EVENTS, frame, n * sizeof(DebugTraceEvent));
+      n = 0;
+    }
+  }
+  if (n) debug_frame_write(cap, DEBUG_FRAME_TRACE_EVENTS, frame, n * sizeof(DebugTraceEvent));
+
+  char path[] = "/tmp/bench_trace_XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0 || write(fd, cap.bytes.data(), cap.bytes.size()) != (ssize_t)cap.bytes.size()) {
+    fprintf(stderr, "cannot write %s\n", path);
+    return 1;
+  }
+  close(fd);
+  std::string cmd = std::string(DEBUG_TRACE_TOOL) + " " + path + " > /dev/null 2>&1";
+
+  typedef std::chrono::steady_clock clock_type;
+  double best = 0;
+  for (int run = 0; run < BENCH_TRACE_RUNS; run++) {
+    clock_type::time_point start = clock_type::now();
+    if (system(cmd.c_str()) != 0) {
+      fprintf(stderr, "%s failed\n", cmd.c_str());
+      unlink(path);
+      return 1;
+    }
+    double s = std::chrono::duration<double>(clock_type::now() - start).count();
+    if (run == 0 || s < best) best = s;
+  }
+  unlink(path);
+  printf("%-40s %10.1f ms (%u events, %.1f MB)\n", "debug_trace convert", best * 1e3,
+         (unsigned)BENCH_TRACE_EVENTS, cap.bytes.size() / 1e6);
+  printf("  -> %.2f M events/s\n", BENCH_TRACE_EVENTS / best / 1e6);
+  return 0;
+}
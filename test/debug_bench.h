@@ -0,0 +1,52 @@
+/**
+ * @file debug_bench.h
+ * @brief Host timing helpers for the bench_* programs in test/
+ *
+ * debug_bench() calls a function in batches until at least
+ * DEBUG_BENCH_MIN_MS have passed and prints the mean cost per call.
+ * Captured Serial output is cleared between batches so it does not grow
+ * without bound; the clear is timed with the batch but amortized over
+ * DEBUG_BENCH_BATCH calls.
+ */
+
+#ifndef DEBUG_BENCH_H
+#define DEBUG_BENCH_H
+
+#pragma once
+#include <stdio.h>
+#include <chrono>
+
+#ifndef DEBUG_BENCH_MIN_MS
+#define DEBUG_BENCH_MIN_MS 200
+#endif
+
+#ifndef DEBUG_BENCH_BATCH
+#define DEBUG_BENCH_BATCH 1000
+#endif
+
+// Keep the compiler from discarding a value computed only for timing
+template <typename T>
+inline void debug_bench_keep(const T& value) {
+  __asm__ __volatile__("" : : "g"(&value) : "memory");
+}
+
+/**
+ * Time fn() and print "name  ns/call"; returns ns per call
+ */
+template <typename Fn>
+inline double debug_bench(const char* name, Fn fn) {
+  typedef std::chrono::steady_clock clock;
+  unsigned long calls = 0;
+  clock::time_point start = clock::now(), now;
+  do {
+    for (int i = 0; i < DEBUG_BENCH_BATCH; i++) fn();
+    calls += DEBUG_BENCH_BATCH;
+    Serial.clear();
+    now = clock::now();
+  } while (now - start < std::chrono::milliseconds(DEBUG_BENCH_MIN_MS));
+  double ns = std::chrono::duration<double, std::nano>(now - start).count() / calls;
+  printf("%-40s %10.1f ns/call\n", name, ns);
+  return ns;
+}
+
+#endif  // DEBUG_BENCH_H
@@ -0,0 +1,124 @@
+/**
+ * @file debug_test.h
+ * @brief Minimal host test runner for the test/ suite
+ *
+ * Each test program is one translation unit built with its own DEBUG_*
+ * flags (see CMakeLists.txt). Cases register themselves with TEST() and
+ * run in declaration order; DEBUG_TEST_MAIN() runs them all and returns
+ * non-zero if any CHECK failed. Macro output lands in the in-memory
+ * Serial of debug_native.h, so CHECK_OUTPUT() compares and clears it.
+ */
+
+#ifndef DEBUG_TEST_H
+#define DEBUG_TEST_H
+
+#pragma once
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+struct DebugTestCase {
+  const char* name;
+  void (*fn)();
+  DebugTestCase* next;
+};
+
+struct DebugTestRun {
+  DebugTestCase* head;
+  DebugTestCase** tail;
+  int failures;  // Failed checks in the current case
+};
+
+inline DebugTestRun& debug_test_run() {
+  static DebugTestRun run = {NULL, NULL, 0};
+  if (!run.tail) run.tail = &run.head;
+  return run;
+}
+
+struct DebugTestRegister {
+  explicit DebugTestRegister(DebugTestCase* c) {
+    DebugTestRun& run = debug_test_run();
+    *run.tail = c;
+    run.tail = &c->next;
+  }
+};
+
+inline void debug_test_fail(const char* file, int line, const std::string& what) {
+  debug_test_run().failures++;
+  fprintf(stderr, "  %s:%d: %s\n", file, line, what.c_str());
+}
+
+/**
+ * Quote a captured string for failure messages, showing control bytes
+ */
+inline std::string debug_test_quote(const std::string& s) {
+  std::string q = "\"";
+  for (size_t i = 0; i < s.size(); i++) {
+    unsigned char c = (unsigned char)s[i];
+    if (c == '\n') {
+      q += "\\n";
+    } else if (c == '\r') {
+      q += "\\r";
+    } else if (c < 0x20 || c >= 0x7F) {
+      char hex[8];
+      snprintf(hex, sizeof(hex), "\\x%02X", c);
+      q += hex;
+    } else {
+      q += (char)c;
+    }
+  }
+  return q + "\"";
+}
+
+inline int debug_test_main() {
+  int failed = 0, total = 0;
+  for (DebugTestCase* c = debug_test_run().head; c; c = c->next) {
+    debug_test_run().failures = 0;
+    c->fn();
+    total++;
+    if (debug_test_run().failures) {
+      failed++;
+      fprintf(stderr, "[FAIL] %s\n", c->name);
+    } else {
+      printf("[ OK ] %s\n", c->name);
+    }
+  }
+  printf("%d/%d passed\n", total - failed, total);
+  return failed ? 1 : 0;
+}
+
+#define TEST(name) \
+  static void debug_test_##name(); \
+  static DebugTestCase debug_test_case_##name = {#name, debug_test_##name, NULL}; \
+  static DebugTestRegister debug_test_reg_##name(&debug_test_case_##name); \
+  static void debug_test_##name()
+
+#define CHECK(cond) do { \
+  if (!(cond)) debug_test_fail(__FILE__, __LINE__, "CHECK(" #cond ")"); \
+} while(0)
+
+#define CHECK_EQ(actual, expected) do { \
+  if (!((actual) == (expected))) { \
+    debug_test_fail(__FILE__, __LINE__, "CHECK_EQ(" #actual ", " #expected ") got " + \
+                    std::to_string((long long)(actual)) + ", expected " + \
+                    std::to_string((long long)(expected))); \
+  } \
+} while(0)
+
+#define CHECK_STR(actual, expected) do { \
+  std::string debug_test_a_(actual), debug_test_e_(expected); \
+  if (debug_test_a_ != debug_test_e_) { \
+    debug_test_fail(__FILE__, __LINE__, "got " + debug_test_quote(debug_test_a_) + \
+                    ", expected " + debug_test_quote(debug_test_e_)); \
+  } \
+} while(0)
+
+// Compare everything written to Serial since the last check, then clear it
+#define CHECK_OUTPUT(expected) do { \
+  CHECK_STR(Serial.output(), expected); \
+  Serial.clear(); \
+} while(0)
+
+#define DEBUG_TEST_MAIN() int main() { return debug_test_main(); }
+
+#endif  // DEBUG_TEST_H
@@ -0,0 +1,40 @@
+/**
+ * @file test_async.cpp
+ * @brief DEBUG_ASYNC: output reaches Serial only when drained, and bytes
+ *        lost to a full ring or cut from long lines count as dropped
+ */
+
+#define DEBUG 1
+#define DEBUG_ASYNC 1
+
+#include <debug.h>
+#include "debug_test.h"
+
+TEST(output_waits_for_drain) {
+  debugfln("x=%d", 1);
+  debug("y");
+  CHECK_OUTPUT("");
+  debug_async_output().flush();
+  CHECK_OUTPUT("x=1\r\ny");
+  CHECK_EQ(debug_async_dropped(), 0);
+}
+
+TEST(long_printf_line_counts_cut_bytes_as_dropped) {
+  std::string line(DEBUG_ASYNC_LINE_MAX + 10, 'x');
+  debugf("%s", line.c_str());
+  CHECK_EQ(debug_async_dropped(), 11);
+  debug_async_output().flush();
+  CHECK_OUTPUT(line.substr(0, DEBUG_ASYNC_LINE_MAX - 1));
+}
+
+TEST(full_ring_counts_refused_records) {
+  uint32_t before = debug_async_dropped();
+  for (int i = 0; i < 1000; i++) debugf("fill %03d\n", i);  // Nobody drains
+  CHECK(debug_async_dropped() > before);
+  debug_async_output().flush();
+  std::string out = Serial.output();
+  Serial.clear();
+  CHECK_EQ(out.size() + (debug_async_dropped() - before), 1000 * 9);
+}
+
+DEBUG_TEST_MAIN()
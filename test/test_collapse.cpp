@@ -0,0 +1,80 @@
+/**
+ * @file test_collapse.cpp
+ * @brief DEBUG_COLLAPSE repeat folding, runs ended by other output, and
+ *        the record comparison behind it
+ */
+
+#define DEBUG 1
+#define DEBUG_LEVEL DEBUG_LEVEL_TRACE
+#define DEBUG_COLLAPSE 1
+
+#include <debug.h>
+#include "debug_test.h"
+
+static void line(int v) { debugfln("v=%d", v); }
+
+TEST(repeats_fold_into_count) {
+  for (int i = 0; i < 4; i++) line(1);
+  line(2);
+  CHECK_OUTPUT("v=1\r\n[last message repeated 3 times]\nv=2\r\n");
+}
+
+TEST(strings_compare_by_content) {
+  char a[] = "bus-off", b[] = "bus-off";
+  debug_tag("[CAN]", a);
+  debug_tag("[CAN]", b);
+  debug_tag("[CAN]", "bus-on");
+  CHECK_OUTPUT("[CAN] bus-off\n[last message repeated 1 times]\n[CAN] bus-on\n");
+}
+
+TEST(other_output_ends_the_run) {
+  line(3);
+  line(3);
+  debugf("x\n");
+  line(3);
+  CHECK_OUTPUT("v=3\r\n[last message repeated 1 times]\nx\nv=3\r\n");
+  line(3);
+  debug_val("n", 5);
+  line(3);
+  debug("y");
+  line(3);
+  CHECK_OUTPUT("[last message repeated 1 times]\nn=5\nv=3\r\nyv=3\r\n");
+}
+
+TEST(poll_flushes_old_count) {
+  line(4);
+  line(4);
+  debug_collapse_flush(Serial, 0);
+  CHECK_OUTPUT("v=4\r\n[last message repeated 1 times]\n");
+  line(4);
+  CHECK_OUTPUT("");
+  debug_collapse_break(Serial);
+  CHECK_OUTPUT("[last message repeated 1 times]\n");
+}
+
+TEST(equal_hash_with_different_bytes_is_emitted) {
+  DebugCollapseKey a, b;
+  debug_collapse_key(a, 1, 2);
+  debug_collapse_key(b, 2, 1);
+  b.hash = a.hash;  // Forced collision
+  CHECK(debug_collapse_check(Serial, 99, a));
+  CHECK(debug_collapse_check(Serial, 99, b));
+  CHECK(!debug_collapse_check(Serial, 99, b));
+  debug_collapse_break(Serial);
+  CHECK_OUTPUT("[last message repeated 1 times]\n");
+}
+
+TEST(equal_hash_with_different_length_is_emitted) {
+  // Past DEBUG_COLLAPSE_KEY_BYTES only the length and hash are left
+  std::string long_a(DEBUG_COLLAPSE_KEY_BYTES, 'a');
+  DebugCollapseKey a, b;
+  debug_collapse_key(a, long_a.c_str());
+  debug_collapse_key(b, (long_a + "b").c_str());
+  b.hash = a.hash;
+  CHECK(debug_collapse_check(Serial, 99, a));
+  CHECK(debug_collapse_check(Serial, 99, b));
+  debug_collapse_break(Serial);
+  CHECK_OUTPUT("");
+}
+
+DEBUG_TEST_MAIN()
@@ -0,0 +1,148 @@
+/**
+ * @file test_conv.cpp
+ * @brief debug_conv.h kernels against the C library's printf
+ *
+ * Integers must match snprintf exactly. Floats are computed in single
+ * precision and round halves up, so away from the listed boundary cases a
+ * sweep allows one unit in the last printed decimal.
+ */
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <debug_conv.h>
+#include "debug_test.h"
+
+static uint32_t rng_state = 2463534242u;
+
+static uint32_t next_rand() {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+static std::string conv_u64(uint64_t v) {
+  char buf[24];
+  char* end = buf + sizeof(buf);
+  char* p = debug_conv_u64(end, v);
+  return std::string(p, end);
+}
+
+static std::string conv_i32(int32_t v) {
+  char buf[12];
+  return std::string(buf, debug_conv_i32(buf, v));
+}
+
+static std::string conv_hex(uint32_t v, int digits) {
+  char buf[8];
+  return std::string(buf, debug_conv_hex(buf, v, digits));
+}
+
+static std::string conv_float(float v, int decimals) {
+  char buf[32];
+  return std::string(buf, debug_conv_float(buf, v, decimals));
+}
+
+static std::string printf_str(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+static std::string printf_str(const char* fmt, ...) {
+  char buf[64];
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(buf, sizeof(buf), fmt, args);
+  va_end(args);
+  return buf;
+}
+
+TEST(integer_boundaries_match_printf) {
+  const int32_t signed_cases[] = {0, 1, -1, 9, 10, -10, 99, 100, 999, 1000, 2147483647, -2147483647 - 1};
+  for (size_t i = 0; i < sizeof(signed_cases) / sizeof(signed_cases[0]); i++) {
+    CHECK_STR(conv_i32(signed_cases[i]), printf_str("%d", (int)signed_cases[i]));
+  }
+  const uint64_t unsigned_cases[] = {0, 9, 10, 4294967295u, 4294967296ull, 9999999999ull,
+                                     10000000000000000000ull, 18446744073709551615ull};
+  for (size_t i = 0; i < sizeof(unsigned_cases) / sizeof(unsigned_cases[0]); i++) {
+    CHECK_STR(conv_u64(unsigned_cases[i]), printf_str("%llu", (unsigned long long)unsigned_cases[i]));
+  }
+  CHECK_STR(conv_hex(0, 2), "00");
+  CHECK_STR(conv_hex(0xFFFFFFFFu, 2), "FFFFFFFF");
+  CHECK_STR(conv_hex(0xABC, 8), "00000ABC");
+}
+
+TEST(integer_sweep_matches_printf) {
+  for (int i = 0; i < 200000; i++) {
+    uint32_t r = next_rand() >> (next_rand() & 31);  // Spread over all digit counts
+    CHECK_STR(conv_i32((int32_t)r), printf_str("%d", (int)(int32_t)r));
+    CHECK_STR(conv_hex(r, 2), printf_str("%02X", (unsigned)r));
+    uint64_t w = ((uint64_t)next_rand() << 32 | next_rand()) >> (next_rand() & 63);
+    CHECK_STR(conv_u64(w), printf_str("%llu", (unsigned long long)w));
+    if (debug_test_run().failures) return;  // One report is enough
+  }
+}
+
+TEST(binary_digits) {
+  char buf[32];
+  CHECK_STR(std::string(buf, debug_conv_bin(buf, 0, 0)), "0");
+  CHECK_STR(std::string(buf, debug_conv_bin(buf, 0x80000000u, 0)), "1" + std::string(31, '0'));
+  CHECK_STR(std::string(buf, debug_conv_bin(buf, 5, 8)), "00000101");
+  CHECK_STR(std::string(buf, debug_conv_bin(buf, 0xFFFFFFFFu, 64)), std::string(32, '1'));
+}
+
+TEST(float_boundaries_match_printf) {
+  CHECK_STR(conv_float(0.0f, 2), "0.00");
+  CHECK_STR(conv_float(-0.0f, 2), "-0.00");
+  CHECK_STR(conv_float(21.5f, 2), printf_str("%.2f", 21.5));
+  CHECK_STR(conv_float(-3.25f, 1), printf_str("%.1f", -3.3));
+  CHECK_STR(conv_float(123456.789f, 0), "123457");
+  CHECK_STR(conv_float(16777216.0f, 2), "16777216.00");
+  // Fixed-point up to the float below 4294967040 (largest below 2^32), exponent form from there
+  CHECK_STR(conv_float(4294966784.0f, 1), printf_str("%.1f", 4294966784.0));
+  CHECK_STR(conv_float(4294967040.0f, 2), "4.29e+09");
+  CHECK_STR(conv_float(NAN, 2), "nan");
+  CHECK_STR(conv_float(INFINITY, 2), "inf");
+  CHECK_STR(conv_float(-INFINITY, 2), "-inf");
+}
+
+TEST(float_rounding_carry) {
+  CHECK_STR(conv_float(0.999f, 2), "1.00");
+  CHECK_STR(conv_float(9.9999f, 2), "10.00");
+  CHECK_STR(conv_float(99.9999f, 3), "100.000");
+  CHECK_STR(conv_float(-0.9999f, 0), "-1");
+  // Carry in exponent form renormalizes instead of printing 10.00e+09
+  CHECK_STR(conv_float(9.9999e9f, 2), printf_str("%.2e", (double)9.9999e9f));
+  CHECK_STR(conv_float(9.9999e37f, 2), printf_str("%.2e", (double)9.9999e37f));
+}
+
+TEST(float_large_exponents_match_printf) {
+  const float mantissas[] = {1.0f, 1.5f, 2.5f, 3.14159f, 9.9999f};
+  for (int e = 10; e <= 38; e++) {
+    for (size_t m = 0; m < sizeof(mantissas) / sizeof(mantissas[0]); m++) {
+      float v = mantissas[m] * powf(10.0f, (float)e);
+      if (isinf(v)) continue;
+      CHECK_STR(conv_float(v, 2), printf_str("%.2e", (double)v));
+    }
+  }
+  CHECK_STR(conv_float(3.4028235e38f, 2), "3.40e+38");
+  CHECK_STR(conv_float(-1e20f, 1), "-1.0e+20");
+}
+
+TEST(float_sweep_within_one_last_digit) {
+  for (int decimals = 0; decimals <= DEBUG_CONV_FLOAT_DIGITS; decimals++) {
+    double unit = pow(10.0, -decimals);
+    for (int i = 0; i < 20000; i++) {
+      uint32_t r = next_rand();
+      float v = (float)(r % 100000000u) / (float)(1 + (r >> 27));
+      if (next_rand() & 1) v = -v;
+      double ours = strtod(conv_float(v, decimals).c_str(), NULL);
+      double ref = strtod(printf_str("%.*f", decimals, (double)v).c_str(), NULL);
+      if (fabs(ours - ref) > unit * 1.01 + fabs(ref) * 1e-15) {
+        debug_test_fail(__FILE__, __LINE__, "decimals " + std::to_string(decimals) + ": " +
+                                                conv_float(v, decimals) + " vs " +
+                                                printf_str("%.*f", decimals, (double)v));
+        return;
+      }
+    }
+  }
+}
+
+DEBUG_TEST_MAIN()
@@ -0,0 +1,173 @@
+/**
+ * @file test_crashlog.cpp
+ * @brief DEBUG_CRASHLOG region layout, dump after a simulated reset, ring
+ *        wrap, and recovery from torn, corrupted and foreign contents
+ *
+ * On the host the region is an ordinary static; a reset is simulated by
+ * calling debug_crashlog_dump() again, which is what debug_crashlog_begin()
+ * does in setup().
+ */
+
+#define DEBUG 1
+#define DEBUG_LEVEL DEBUG_LEVEL_TRACE
+#define DEBUG_CRASHLOG 1
+#define DEBUG_CRASHLOG_SIZE 512
+
+#include <debug.h>
+#include "debug_test.h"
+
+static uint8_t* region_bytes() { return (uint8_t*)debug_crashlog_region().data; }
+
+// Dump as at boot; the output with every "@<ms>]" shortened to "@]"
+static std::string reboot(bool keep = false) {
+  Serial.clear();
+  debug_crashlog_dump(Serial, keep);
+  std::string out = Serial.output(), s;
+  Serial.clear();
+  for (size_t i = 0; i < out.size(); i++) {
+    s += out[i];
+    if (out[i] == '@' && i + 1 < out.size() && isdigit((unsigned char)out[i + 1])) {
+      while (i + 1 < out.size() && isdigit((unsigned char)out[i + 1])) i++;
+    }
+  }
+  return s;
+}
+
+// Clean region, recording
+static void power_on() {
+  memset(&debug_crashlog_region(), 0xA5, sizeof(DebugCrashRegion));
+  CHECK_STR(reboot(), "");
+}
+
+TEST(power_on_garbage_resets_region) {
+  power_on();
+  const DebugCrashHeader& h = debug_crashlog_region().header;
+  CHECK_EQ(h.magic, DEBUG_CRASHLOG_MAGIC);
+  CHECK_EQ(h.layout, (uint32_t)DEBUG_CRASHLOG_VERSION << 24 | DEBUG_CRASHLOG_SIZE);
+  CHECK_EQ(h.crc, debug_crashlog_header_crc(h));
+  CHECK_EQ(sizeof(DebugCrashRegion), sizeof(DebugCrashHeader) + DEBUG_CRASHLOG_SIZE);
+  CHECK_EQ(region_bytes()[0], 0);
+}
+
+TEST(record_layout) {
+  power_on();
+  debugfln("v=%d", 5);
+  Serial.clear();
+  const uint8_t* p = region_bytes();
+  uint16_t len;
+  uint32_t seq, crc;
+  memcpy(&len, p + 2, 2);
+  memcpy(&seq, p + 4, 4);
+  memcpy(&crc, p + 12, 4);
+  CHECK_EQ(p[0], DEBUG_CRASHLOG_MARK);
+  CHECK_EQ(p[1], 1);                            // Line macro
+  CHECK_EQ(len, sizeof(const char*) + 5);       // Format pointer + I32 tag and value
+  CHECK_EQ(seq, 0);
+  CHECK_EQ(p[DEBUG_CRASHLOG_RECORD_HEADER + sizeof(const char*)], DEBUG_ARG_I32);
+  CHECK_EQ(crc, debug_crc32(debug_crc32(0, p, 12), p + DEBUG_CRASHLOG_RECORD_HEADER, len));
+  DebugCrashRecord r = DebugCrashRecord();
+  CHECK(debug_crashlog_parse(debug_crashlog_region(), 0, r));
+  CHECK_EQ(r.size, (DEBUG_CRASHLOG_RECORD_HEADER + len + 3u) & ~3u);
+  CHECK_EQ(p[r.size], 0);  // Nothing after it yet
+}
+
+TEST(records_survive_reset_in_order) {
+  power_on();
+  debugfln("boot %d", 1);
+  debug_warn("low %s", "batt");
+  debugf("x=%u ", 7u);
+  debug_tag("[CAN]", "bus-off");
+  Serial.clear();
+  CHECK_STR(reboot(),
+            "[CRASHLOG] 4 records from previous boot\n"
+            "[CRASHLOG #0 @] boot 1\n"
+            "[CRASHLOG #1 @] [W] low batt\n"
+            "[CRASHLOG #2 @] x=7 \n"
+            "[CRASHLOG #3 @] [CAN] bus-off\n");
+  // Not kept: the next boot has nothing, and numbering continues
+  debugfln("after");
+  Serial.clear();
+  CHECK_STR(reboot(), "[CRASHLOG] 1 records from previous boot\n[CRASHLOG #4 @] after\n");
+}
+
+TEST(wrap_keeps_newest_records_oldest_first) {
+  power_on();
+  for (int i = 0; i < 100; i++) debugfln("n=%d", i);
+  Serial.clear();
+  std::string out = reboot();
+  // 32-byte records: 16 fit in 512 bytes
+  CHECK(out.compare(0, 40, "[CRASHLOG] 16 records from previous boot") == 0);
+  std::string expected;
+  for (int i = 84; i < 100; i++) {
+    expected += "[CRASHLOG #" + std::to_string(i) + " @] n=" + std::to_string(i) + "\n";
+  }
+  CHECK_STR(out.substr(out.find('\n') + 1), expected);
+}
+
+TEST(corrupted_and_torn_records_are_skipped) {
+  power_on();
+  for (int i = 0; i < 4; i++) debugfln("r=%d", i);
+  Serial.clear();
+  region_bytes()[32 + DEBUG_CRASHLOG_RECORD_HEADER + 9] ^= 0x40;  // Value byte of record 1
+  // Record 4 torn by the reset: header written, CRC and payload not
+  uint8_t* torn = region_bytes() + 4 * 32;
+  torn[0] = DEBUG_CRASHLOG_MARK;
+  torn[2] = 13;
+  CHECK_STR(reboot(),
+            "[CRASHLOG] 3 records from previous boot\n"
+            "[CRASHLOG #0 @] r=0\n"
+            "[CRASHLOG #2 @] r=2\n"
+            "[CRASHLOG #3 @] r=3\n");
+}
+
+TEST(overwritten_remains_do_not_end_the_dump) {
+  power_on();
+  for (int i = 0; i < 16; i++) debugfln("a=%d", i);
+  // A longer record lands on top of the oldest two, leaving the tail of the second
+  debugfln("long %d %d %d %d", 1, 2, 3, 4);
+  Serial.clear();
+  std::string out = reboot();
+  CHECK(out.compare(0, 40, "[CRASHLOG] 15 records from previous boot") == 0);
+  CHECK(out.find("[CRASHLOG #2 @] a=2\n") != std::string::npos);
+  CHECK(out.find("[CRASHLOG #1 @]") == std::string::npos);
+  const std::string last = "[CRASHLOG #16 @] long 1 2 3 4\n";
+  CHECK(out.size() > last.size() && out.compare(out.size() - last.size(), last.size(), last) == 0);
+}
+
+TEST(bad_header_discards_records) {
+  power_on();
+  debugfln("lost");
+  Serial.clear();
+  debug_crashlog_region().header.layout ^= 1;  // Another DEBUG_CRASHLOG_SIZE
+  CHECK_STR(reboot(), "");
+  CHECK_EQ(region_bytes()[0], 0);
+  CHECK_EQ(debug_crashlog_region().header.crc, debug_crashlog_header_crc(debug_crashlog_region().header));
+}
+
+TEST(other_firmware_is_hex_dumped) {
+  power_on();
+  debugfln("v=%d", 0x41424344);
+  Serial.clear();
+  DebugCrashHeader& h = debug_crashlog_region().header;
+  h.image ^= 0x10;
+  h.crc = debug_crashlog_header_crc(h);
+  std::string out = reboot();
+  CHECK(out.find("(other firmware)\n") != std::string::npos);
+  CHECK(out.find("0000: 01 44 43 42 41") != std::string::npos);  // DEBUG_ARG_I32, then the value
+  CHECK(out.find("v=") == std::string::npos);  // Format pointer not followed
+}
+
+TEST(keep_appends_after_dumped_records) {
+  power_on();
+  debugfln("one");
+  Serial.clear();
+  CHECK(reboot(true).find("#0 @] one") != std::string::npos);
+  debugfln("two");
+  Serial.clear();
+  CHECK_STR(reboot(true),
+            "[CRASHLOG] 2 records from previous boot\n"
+            "[CRASHLOG #0 @] one\n"
+            "[CRASHLOG #1 @] two\n");
+}
+
+DEBUG_TEST_MAIN()
@@ -0,0 +1,175 @@
+/**
+ * @file test_decode.cpp
+ * @brief Encode -> decode round trips for deferred and tokenized frames,
+ *        and DebugElfImage on malformed files
+ *
+ * Deferred frames carry format addresses, so this test resolves them
+ * against its own executable (built without PIE, see CMakeLists.txt).
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+#include "debug_decode.h"
+#include "debug_test.h"
+
+struct FrameCapture {
+  std::string bytes;
+  size_t write(const uint8_t* p, size_t n) {
+    bytes.append((const char*)p, n);
+    return n;
+  }
+};
+
+static const DebugElfImage& self_image() {
+  static DebugElfImage image;
+  static bool loaded = image.load("/proc/self/exe");
+  (void)loaded;
+  return image;
+}
+
+// Split a capture and render every frame as debug_decode does
+static std::string decode(const std::string& capture, const DebugTokenDatabase& tokens) {
+  DebugFrameParser parser;
+  std::string out;
+  parser.feed(
+      (const uint8_t*)capture.data(), capture.size(), [&](char c) { out += c; },
+      [&](uint8_t kind, const uint8_t* payload, size_t len) {
+        if (kind == DEBUG_FRAME_DEFERRED || kind == DEBUG_FRAME_DEFERRED_LN) {
+          debug_render_deferred(self_image(), kind, payload, len, out);
+        } else {
+          debug_render_token(tokens, kind, payload, len, out);
+        }
+      });
+  return out;
+}
+
+static std::string write_temp(const std::vector<uint8_t>& bytes) {
+  char path[] = "/tmp/debug_elf_XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0) return "";
+  ssize_t n = write(fd, bytes.data(), bytes.size());
+  close(fd);
+  return n == (ssize_t)bytes.size() ? path : "";
+}
+
+static bool load_bytes(const std::vector<uint8_t>& bytes) {
+  std::string path = write_temp(bytes);
+  DebugElfImage image;
+  bool ok = image.load(path.c_str());
+  unlink(path.c_str());
+  return ok;
+}
+
+/**
+ * Minimal ELF32 with a null section and a .shstrtab; the string table's
+ * contents are supplied by the caller
+ */
+static std::vector<uint8_t> tiny_elf(const std::string& strtab, uint16_t shstrndx) {
+  std::vector<uint8_t> f(52 + strtab.size() + 2 * 40, 0);
+  memcpy(&f[0], "\x7f" "ELF", 4);
+  f[4] = 1;  // ELFCLASS32
+  f[5] = 1;  // Little-endian
+  uint32_t shoff = (uint32_t)(52 + strtab.size());
+  uint16_t shentsize = 40, shnum = 2;
+  memcpy(&f[0x20], &shoff, 4);
+  memcpy(&f[0x2E], &shentsize, 2);
+  memcpy(&f[0x30], &shnum, 2);
+  memcpy(&f[0x32], &shstrndx, 2);
+  memcpy(&f[52], strtab.data(), strtab.size());
+  uint8_t* h = &f[shoff + 40];
+  uint32_t name = 1, type = 3 /* SHT_STRTAB */, offset = 52, size = (uint32_t)strtab.size();
+  memcpy(h, &name, 4);
+  memcpy(h + 4, &type, 4);
+  memcpy(h + 16, &offset, 4);
+  memcpy(h + 20, &size, 4);
+  return f;
+}
+
+TEST(deferred_round_trip) {
+  CHECK(self_image().lookup(0) == NULL);
+  FrameCapture cap;
+  cap.bytes += "boot\n";
+  debug_deferred_log(cap, DEBUG_FRAME_DEFERRED_LN, "i=%d u=%u x=%08X", -5, 4000000000u, 0xBEEFu);
+  debug_deferred_log(cap, DEBUG_FRAME_DEFERRED_LN, "ll=%lld s=%s c=%c", -1234567890123LL, "abc", 'z');
+  debug_deferred_log(cap, DEBUG_FRAME_DEFERRED, "f=%.2f d=%.3f", 21.5f, -0.125);
+  cap.bytes += "\n";
+  CHECK_STR(decode(cap.bytes, DebugTokenDatabase()),
+            "boot\ni=-5 u=4000000000 x=0000BEEF\nll=-1234567890123 s=abc c=z\nf=21.50 d=-0.125\n");
+}
+
+TEST(deferred_truncates_arguments_that_do_not_fit) {
+  FrameCapture cap;
+  std::string big(200, 'y');
+  debug_deferred_log(cap, DEBUG_FRAME_DEFERRED_LN, "n=%d s=%s", 7, big.c_str());
+  std::string out = decode(cap.bytes, DebugTokenDatabase());
+  CHECK(out.compare(0, 6, "n=7 s=") == 0);
+  CHECK(out.size() > 8 && out.size() < 120);  // The string is cut, not dropped
+  CHECK_EQ(out.find_first_not_of('y', 6), out.size() - 1);
+  CHECK_EQ(out.back(), '\n');
+}
+
+TEST(token_round_trip) {
+  FrameCapture cap;
+  DEBUG_TOKEN_LOG_TO(cap, DEBUG_FRAME_TOKEN_LN, "id=0x%X temp=%d name=%s", 0x123, -40, "can0");
+  DEBUG_TOKEN_LOG_TO(cap, DEBUG_FRAME_TOKEN, "big=%llu f=%.1f", 18446744073709551615ULL, 2.5);
+  DebugTokenDatabase db;
+  db.load(self_image());
+  CHECK(db.lookup(debug_token_hash("id=0x%X temp=%d name=%s")) != NULL);
+  CHECK_STR(decode(cap.bytes, db), "id=0x123 temp=-40 name=can0\nbig=18446744073709551615 f=2.5");
+}
+
+TEST(token_collision_keeps_first_string_and_is_reported) {
+  static_assert(debug_token_hash("costarring") == debug_token_hash("liquid"), "known FNV-1a collision");
+  DebugTokenDatabase db;
+  CHECK(db.add("costarring"));
+  CHECK(db.add("costarring"));  // Same literal from another section
+  CHECK(!db.add("liquid"));
+  CHECK_STR(db.lookup(debug_token_hash("liquid")), "costarring");
+  CHECK_EQ(db.entries().size(), 1);
+  CHECK_EQ(db.collisions().size(), 1);
+  CHECK_EQ(db.collisions()[0].token, debug_token_hash("liquid"));
+  CHECK_STR(db.collisions()[0].kept, "costarring");
+  CHECK_STR(db.collisions()[0].other, "liquid");
+}
+
+TEST(unknown_token_is_reported) {
+  FrameCapture cap;
+  debug_token_log(cap, DEBUG_FRAME_TOKEN_LN, 0xDEADBEEFu, 1);
+  CHECK_STR(decode(cap.bytes, DebugTokenDatabase()), "<unknown token deadbeef>\n");
+}
+
+TEST(elf_accepts_well_formed_table) {
+  CHECK(load_bytes(tiny_elf(std::string("\0.shstrtab\0", 11), 1)));
+}
+
+TEST(elf_rejects_string_table_index_past_table) {
+  CHECK(!load_bytes(tiny_elf(std::string("\0.shstrtab\0", 11), 2)));
+  CHECK(!load_bytes(tiny_elf(std::string("\0.shstrtab\0", 11), 0xFFFF)));
+}
+
+TEST(elf_rejects_truncated_section_table) {
+  std::vector<uint8_t> f = tiny_elf(std::string("\0.shstrtab\0", 11), 1);
+  f.resize(f.size() - 20);
+  CHECK(!load_bytes(f));
+}
+
+TEST(elf_rejects_string_table_outside_file) {
+  std::vector<uint8_t> f = tiny_elf(std::string("\0.shstrtab\0", 11), 1);
+  uint32_t size = 0x10000;
+  memcpy(&f[52 + 11 + 40 + 20], &size, 4);
+  CHECK(!load_bytes(f));
+}
+
+TEST(elf_ignores_name_without_terminator) {
+  // ".shstrtab" runs to the end of the table with no NUL
+  std::string path = write_temp(tiny_elf(std::string("\0.shstrtab", 10), 1));
+  DebugElfImage image;
+  CHECK(image.load(path.c_str()));
+  unlink(path.c_str());
+  int named = 0;
+  image.for_each_section(".shstrtab", [&](const std::string&, const uint8_t*, size_t) { named++; });
+  CHECK_EQ(named, 0);
+}
+
+DEBUG_TEST_MAIN()
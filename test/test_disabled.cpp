@@ -0,0 +1,53 @@
+/**
+ * @file test_disabled.cpp
+ * @brief With DEBUG=0 and no level every macro compiles to nothing:
+ *        no output and no evaluation of its arguments
+ */
+
+#define DEBUG 0
+
+#include <debug.h>
+#include "debug_test.h"
+
+static int evaluated = 0;
+
+static int touch() { return ++evaluated; }
+
+TEST(macros_produce_no_output) {
+  uint8_t data[4] = {1, 2, 3, 4};
+  debug("x");
+  debugln("x");
+  debugf("%d", touch());
+  debugfln("%d", touch());
+  debug_hex(touch());
+  debug_bin(touch());
+  debug_binw(touch(), 8);
+  debug_bits(touch(), "A:1");
+  debug_array(data, sizeof(data));
+  debug_val("v", touch());
+  debug_tag("[T]", "x");
+  debug_if(touch(), "x");
+  debug_assert(touch() < 0, "x");
+  debug_elapsed(touch(), "x");
+  debug_stack();
+  debug_error("%d", touch());
+  debug_warn("%d", touch());
+  debug_info("%d", touch());
+  debug_debug("%d", touch());
+  debug_trace("%d", touch());
+  debug_ratelimit(1, 1, "%d", touch());
+  debug_sample(1, "%d", touch());
+  debug_isr("x");
+  debugf_isr("%d", touch());
+  debug_isr_drain();
+  debug_profile_report();
+  debug_histogram_report();
+  debugg("%d%d", touch(), touch());
+  (void)data;  // Only referenced by the removed macros
+  (void)&touch;
+  CHECK_EQ(debug_micros(), 0);
+  CHECK_EQ(evaluated, 0);
+  CHECK_OUTPUT("");
+}
+
+DEBUG_TEST_MAIN()
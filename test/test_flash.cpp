@@ -0,0 +1,180 @@
+/**
+ * @file test_flash.cpp
+ * @brief DebugFlashLog on the simulated NOR device: round trip, remount,
+ *        wrap, and recovery from a power cut at every point of a write
+ *
+ * Payload lengths are multiples of 4, so a block whose write completed is
+ * exactly a block append() reported as written (no padding to cut into).
+ */
+
+#define DEBUG 1
+#define DEBUG_FLASH 1
+#define DEBUG_FLASH_ECHO 0
+
+#include <unistd.h>
+#include <vector>
+#include <debug.h>
+#include "debug_test.h"
+
+typedef std::vector<std::string> Blocks;
+
+// A fresh, erased simulated partition; removed when it goes out of scope
+struct TempFlash {
+  char path[32];
+  uint32_t sectors;
+  DebugFlashFile* file;
+
+  explicit TempFlash(uint32_t sectors = 4) : sectors(sectors) {
+    strcpy(path, "/tmp/debug_flash_XXXXXX");
+    close(mkstemp(path));
+    unlink(path);  // DebugFlashFile creates it erased
+    file = new DebugFlashFile(path, sectors * DEBUG_FLASH_SECTOR);
+  }
+  ~TempFlash() {
+    delete file;
+    unlink(path);
+  }
+
+  // Power cycle: a new file handle and a new log, as after a reset
+  void reboot() {
+    delete file;
+    file = new DebugFlashFile(path, sectors * DEBUG_FLASH_SECTOR);
+  }
+};
+
+static std::string payload(int i, size_t len) {
+  std::string s(len, 'a' + i % 26);
+  snprintf(&s[0], len, "%06d", i);
+  s[6] = '|';
+  return s;
+}
+
+static Blocks stored(DebugFlashLog& log) {
+  Blocks out;
+  log.for_each([&out](const uint8_t* data, size_t len) { out.push_back(std::string((const char*)data, len)); });
+  return out;
+}
+
+TEST(round_trip_and_remount) {
+  TempFlash flash;
+  Blocks written;
+  {
+    DebugFlashLog log;
+    CHECK(log.mount(*flash.file));
+    for (int i = 0; i < 10; i++) {
+      written.push_back(payload(i, 100));
+      CHECK(log.append((const uint8_t*)written.back().data(), written.back().size()));
+    }
+    CHECK(stored(log) == written);
+  }
+  flash.reboot();
+  DebugFlashLog log;
+  CHECK(log.mount(*flash.file));
+  CHECK_EQ(log.offset(), DEBUG_FLASH_SEGMENT_HEADER + 10 * (DEBUG_FLASH_BLOCK_HEADER + 100));
+  written.push_back(payload(10, 8));
+  CHECK(log.append((const uint8_t*)written.back().data(), written.back().size()));
+  CHECK(stored(log) == written);
+}
+
+TEST(wrap_keeps_newest_segments_in_order) {
+  TempFlash flash;
+  DebugFlashLog log;
+  CHECK(log.mount(*flash.file));
+  Blocks written;
+  for (int i = 0; i < 200; i++) {  // ~10 sectors of 400-byte blocks through 4
+    written.push_back(payload(i, 400));
+    CHECK(log.append((const uint8_t*)written.back().data(), written.back().size()));
+  }
+  Blocks got = stored(log);
+  // Erase-ahead leaves 3 of the 4 segments readable, the last one partly filled
+  CHECK(got.size() > 2 * 9 && got.size() < 4 * 10);
+  CHECK(Blocks(written.end() - (long)got.size(), written.end()) == got);
+}
+
+TEST(unformatted_device_is_formatted_on_mount) {
+  TempFlash flash;
+  uint8_t junk[64];
+  memset(junk, 0x5A, sizeof(junk));
+  CHECK(flash.file->write(0, junk, sizeof(junk)));
+  DebugFlashLog log;
+  CHECK(log.mount(*flash.file));
+  CHECK(stored(log).empty());
+  CHECK(log.append((const uint8_t*)"abcd", 4));
+  CHECK(stored(log) == Blocks(1, "abcd"));
+}
+
+TEST(power_cut_at_every_point_keeps_completed_blocks) {
+  // Block sizes vary so cuts land in headers, payloads and segment headers
+  const size_t sizes[] = {60, 200, 500, 12, 340};
+  const long span = 3 * DEBUG_FLASH_SECTOR;  // Crosses at least two segment switches
+  int cases = 0;
+  for (long cut = 0; cut < span; cut += 37) {
+    // Room to spare: recovery opens a fresh segment and erases the one after
+    // it, which must not be a segment holding acknowledged blocks
+    TempFlash flash(8);
+    Blocks acked;
+    {
+      DebugFlashLog log;
+      CHECK(log.mount(*flash.file));
+      flash.file->power_cut_after(cut);
+      for (int i = 0; i < 200; i++) {
+        std::string p = payload(i, sizes[i % 5]);
+        if (log.append((const uint8_t*)p.data(), p.size())) acked.push_back(p);
+      }
+    }
+    flash.reboot();
+    DebugFlashLog log;
+    if (!log.mount(*flash.file)) {
+      debug_test_fail(__FILE__, __LINE__, "mount failed after cut at " + std::to_string(cut));
+      return;
+    }
+    Blocks got = stored(log);
+    if (got != acked) {
+      debug_test_fail(__FILE__, __LINE__,
+                      "cut at " + std::to_string(cut) + ": " + std::to_string(acked.size()) + " acknowledged, " +
+                          std::to_string(got.size()) + " recovered");
+      return;
+    }
+    // Logging resumes after the damage and keeps everything before it
+    std::string after = payload(999, 16);
+    CHECK(log.append((const uint8_t*)after.data(), after.size()));
+    acked.push_back(after);
+    CHECK(stored(log) == acked);
+    cases++;
+  }
+  CHECK(cases > 300);
+}
+
+TEST(flash_output_batches_records) {
+  TempFlash flash;
+  DebugFlashOutput& out = debug_flash_output();
+  CHECK(out.mount(*flash.file));
+  std::string expected;
+  for (int i = 0; i < 100; i++) {
+    out.printf("line %d\n", i);
+    expected += "line " + std::to_string(i) + "\n";
+    out.flush_step(false);
+  }
+  out.flush();
+  CHECK(flash.file->programmed() < expected.size() * 11 / 10 + DEBUG_FLASH_SEGMENT_HEADER * 2);
+  Serial.clear();
+  out.dump(Serial);
+  CHECK_OUTPUT(expected);
+  CHECK_EQ(out.dropped(), 0);
+}
+
+TEST(long_printf_line_counts_cut_bytes_as_dropped) {
+  TempFlash flash;
+  DebugFlashOutput& out = debug_flash_output();
+  CHECK(out.mount(*flash.file));
+  uint32_t dropped = out.dropped();
+  std::string line(DEBUG_FLASH_LINE_MAX + 10, 'x');
+  CHECK_EQ(out.printf("%s", line.c_str()), DEBUG_FLASH_LINE_MAX - 1);
+  CHECK_EQ(out.dropped() - dropped, 11);  // Cut by the line buffer, not the ring
+  out.flush();
+  Serial.clear();
+  out.dump(Serial);
+  CHECK_OUTPUT(line.substr(0, DEBUG_FLASH_LINE_MAX - 1));
+}
+
+DEBUG_TEST_MAIN()
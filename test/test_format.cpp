@@ -0,0 +1,23 @@
+/**
+ * @file test_format.cpp
+ * @brief Default printf mode leaves DEBUG_FMT_CHECK off, so formats held
+ *        in variables still compile (the checker is tested in test_macros)
+ */
+
+#define DEBUG 1
+
+#include <debug.h>
+#include "debug_test.h"
+
+static_assert(DEBUG_FMT_CHECK == 0, "plain printf builds must not require literal formats");
+
+TEST(non_literal_format_compiles) {
+  char fmt[16];
+  snprintf(fmt, sizeof(fmt), "n=%s", "%d");
+  debugf(fmt, 5);
+  const char* plain = "text";
+  debugfln(plain);
+  CHECK_OUTPUT("n=5text\r\n");
+}
+
+DEBUG_TEST_MAIN()
@@ -0,0 +1,146 @@
+/**
+ * @file test_formatter.cpp
+ * @brief DEBUG_FAST_FORMAT output compared with the host's snprintf for
+ *        integer, string, pointer and float conversions, and the number of
+ *        writes per line
+ */
+
+#define DEBUG 1
+#define DEBUG_LEVEL DEBUG_LEVEL_TRACE
+#define DEBUG_FAST_FORMAT 1
+
+#include <math.h>
+#include <debug.h>
+#include "debug_test.h"
+
+// The spec is decoded at compile time
+static_assert(debug_fmt_decode("-08.3lf").flags == (DEBUG_FMT_LEFT | DEBUG_FMT_ZERO), "flags");
+static_assert(debug_fmt_decode("-08.3lf").width == 8 && debug_fmt_decode("-08.3lf").prec == 3, "width, prec");
+static_assert(debug_fmt_decode("-08.3lf").length == 'l' && debug_fmt_decode("-08.3lf").conv == 'f', "conv");
+static_assert(debug_fmt_decode("*.*hhd").width_star && debug_fmt_decode("*.*hhd").prec_star, "stars");
+static_assert(debug_fmt_decode("*.*hhd").length == 'H' && *debug_fmt_decode("*.*hhd").end == 0, "end");
+
+/**
+ * debugf(fmt, ...) must print exactly what snprintf(fmt, ...) does
+ */
+#define CHECK_FMT(fmt, ...) do { \
+  char expected_[512]; \
+  snprintf(expected_, sizeof(expected_), fmt, ##__VA_ARGS__); \
+  debugf(fmt, ##__VA_ARGS__); \
+  if (Serial.output() != expected_) { \
+    debug_test_fail(__FILE__, __LINE__, std::string(fmt) + ": got " + debug_test_quote(Serial.output()) + \
+                    ", expected " + debug_test_quote(expected_)); \
+  } \
+  Serial.clear(); \
+} while(0)
+
+// Counts write() calls
+struct CountingPrint {
+  int writes;
+  std::string text;
+  CountingPrint() : writes(0) {}
+  size_t write(const uint8_t* data, size_t len) {
+    writes++;
+    text.append((const char*)data, len);
+    return len;
+  }
+};
+
+TEST(integers_match_snprintf) {
+  static const int ints[] = {0, 1, -1, 7, -42, 300, 40000, -40000, 123456789, INT32_MAX, INT32_MIN};
+  for (size_t i = 0; i < sizeof(ints) / sizeof(ints[0]); i++) {
+    int v = ints[i];
+    CHECK_FMT("[%d|%i|%5d|%-5d|%05d|%+d|% d|%.3d|%.0d|%+.0d]", v, v, v, v, v, v, v, v, v, v);
+    CHECK_FMT("[%u|%x|%#x|%#X|%08x|%-#10x|%o|%#o|%.0o|%#.0o]", v, v, v, v, v, v, v, v, v, v);
+    CHECK_FMT("[%hd|%hhd|%hu|%hhu|%hx|%hhX|%#hho]", v, v, v, v, v, v, v);
+  }
+}
+
+TEST(wide_integers_match_snprintf) {
+  static const long long wide[] = {0, -1, 4294967296LL, -9000000000000000000LL, INT64_MAX, INT64_MIN};
+  for (size_t i = 0; i < sizeof(wide) / sizeof(wide[0]); i++) {
+    long long v = wide[i];
+    CHECK_FMT("[%lld|%llu|%llx|%#llo|%20lld|%-+20lld]", v, (unsigned long long)v, (unsigned long long)v,
+              (unsigned long long)v, v, v);
+    CHECK_FMT("[%ld|%lu|%zu|%zd|%jd]", (long)v, (unsigned long)v, (size_t)v, (ssize_t)v, (intmax_t)v);
+  }
+}
+
+TEST(chars_strings_and_pointers_match_snprintf) {
+  int x = 0;
+  CHECK_FMT("[%c|%3c|%-3c|%c]", 'a', 'b', 'c', 65);
+  CHECK_FMT("[%s|%.2s|%10s|%-10s|%.0s|%s]", "hello", "hello", "hello", "hello", "hello", "");
+  CHECK_FMT("[%p|%20p|%-20p]", (void*)&x, (void*)&x, (void*)&x);
+  CHECK_FMT("100%% [%d%%] %%s", 5);
+  CHECK_FMT("no conversions\n");
+}
+
+TEST(star_width_and_precision_match_snprintf) {
+  CHECK_FMT("[%*d|%-*d|%*d]", 6, 42, 6, 42, -6, 42);
+  CHECK_FMT("[%.*f|%*.*f|%.*s|%.*d]", 3, 3.14159, 10, 2, -2.5, 3, "abcdef", 5, 42);
+  CHECK_FMT("[%.*f]", -1, 1.5);  // Negative precision: as if not given
+}
+
+TEST(floats_match_snprintf) {
+  static const double values[] = {0.0, -0.0, 0.5, 1.5, 2.5, -1.5, 0.125, 1.0, 9.5, 99.5, 999999.5,
+                                  0.1, 1.0 / 3, 2.0 / 3, 2.675, 123.456, -1234567.891, 1e-5, 1.5e-5,
+                                  9.9999996, 0.00012345678901234567, 3.14159265358979, 1e15, 1e18,
+                                  12345678901234567.0, 9.99999999999999e18, 4.35, 1e-10, 5e-324};
+  for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+    double v = values[i];
+    CHECK_FMT("[%f|%.0f|%.1f|%.3f|%.10f|%.17f|%#.0f|%+.2f|% .2f]", v, v, v, v, v, v, v, v, v);
+    CHECK_FMT("[%12.3f|%-12.3f|%012.3f|%F]", v, v, v, v);
+    if (v != 0 && fabs(v) < 1e-10) continue;  // %e/%g digits are exact from 1e-10 up
+    CHECK_FMT("[%e|%.0e|%.3E|%.16e|%.17e|%#.0e|% e|%-14.2e|%014.2e]", v, v, v, v, v, v, v, v, v);
+    CHECK_FMT("[%g|%.0g|%.1g|%.3g|%.10g|%.15g|%.17g|%#.3g|%G|%+g|%012g]", v, v, v, v, v, v, v, v, v, v, v);
+  }
+}
+
+TEST(float_boundaries_match_snprintf) {
+  float f = 21.5f;
+  CHECK_FMT("[%f|%g|%.2f]", f, f, f);  // Promoted to double, as by printf
+  CHECK_FMT("[%g|%g|%g|%g]", 999999.5, 9999995.0, 0.0001, 0.00009999995);
+  CHECK_FMT("[%.15g|%.15g|%.17g]", 0.1, 123456789.123456789, 0.1);
+  CHECK_FMT("[%f|%F|%e|%E|%g|%G|%5f|%-5f|]", NAN, NAN, INFINITY, -INFINITY, INFINITY, -NAN, INFINITY,
+            -INFINITY);
+  CHECK_FMT("[%.3e|%.3e|%.3e|%.3g]", 1e300, 1.5e-300, 6.02214076e23, 1e100);
+  CHECK_FMT("[%#g|%#g|%#g|%#.1g]", 0.0, 1.5, 123456.0, 0.05);
+}
+
+TEST(documented_differences_from_glibc) {
+  debugf("%#g", 999999.5);  // C keeps the zeros; glibc prints "1.e+06"
+  CHECK_OUTPUT("1.00000e+06");
+  debugf("%f|%.2f", 1e19, -2.5e25);  // %e form from 1e19 up
+  CHECK_OUTPUT("1.000000e+19|-2.50e+25");
+  debugf("%p", (void*)0);  // newlib; glibc prints "(nil)"
+  CHECK_OUTPUT("0x0");
+}
+
+TEST(star_precision_beyond_limit_is_zero_padded) {
+  debugf("%.*f|%.*e", 20, 0.5, 20, 0.5);
+  CHECK_OUTPUT("0.50000000000000000000|5.00000000000000000000e-01");
+}
+
+TEST(line_is_one_write) {
+  CountingPrint out;
+  DEBUG_FORMAT_TO(out, "[I] x=%d y=%.2f s=%s\n", 42, 1.25, "ok");
+  CHECK_EQ(out.writes, 1);
+  CHECK_STR(out.text, "[I] x=42 y=1.25 s=ok\n");
+}
+
+TEST(long_line_takes_chunked_writes) {
+  CountingPrint out;
+  std::string pad(300, 'x');
+  DEBUG_FORMAT_TO(out, "%s|%d", pad.c_str(), 7);
+  CHECK_EQ(out.writes, (300 + 2 + DEBUG_FORMAT_CHUNK - 1) / DEBUG_FORMAT_CHUNK);
+  CHECK_STR(out.text, pad + "|7");
+}
+
+TEST(line_macros_use_the_formatter) {
+  debugfln("v=%hhd", 300);
+  debug_warn("t=%.1f", 21.25);
+  debug_if(true, "n=%u", 3u);
+  CHECK_OUTPUT("v=44\r\n[W] t=21.2\nn=3\r\n");
+}
+
+DEBUG_TEST_MAIN()
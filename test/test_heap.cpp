@@ -0,0 +1,158 @@
+/**
+ * @file test_heap.cpp
+ * @brief DEBUG_HEAP on the host: glibc malloc interposed, site and block
+ *        tables checked through the tracker's own accessors
+ *
+ * Built with -fno-builtin (see CMakeLists.txt) so the compiler cannot
+ * drop a malloc/free pair the test makes on purpose.
+ */
+
+#define DEBUG 1
+#define DEBUG_HEAP 1
+#define DEBUG_HEAP_BLOCKS 256
+
+#include <debug.h>
+#include "debug_test.h"
+
+static void* volatile keep;
+
+// Each helper is its own call site
+__attribute__((noinline)) static void* alloc_a(size_t n) {
+  void* p = malloc(n);
+  keep = p;
+  return p;
+}
+
+__attribute__((noinline)) static void* alloc_b(size_t n) {
+  void* p = calloc(1, n);
+  keep = p;
+  return p;
+}
+
+__attribute__((noinline)) static void* grow(void* p, size_t n) {
+  p = realloc(p, n);
+  keep = p;
+  return p;
+}
+
+/**
+ * Site slot whose counters match exactly; -1 if none or several
+ */
+static int find_site(size_t live, uint32_t blocks, uint32_t allocs, uint32_t frees) {
+  int found = -1;
+  for (size_t i = 0; i < DebugHeapTable::slots(); i++) {
+    DebugHeapSite s;
+    if (!debug_heap_table().site(i, &s)) continue;
+    if (s.live == live && s.blocks == blocks && s.allocs == allocs && s.frees == frees) {
+      if (found >= 0) return -1;
+      found = (int)i;
+    }
+  }
+  return found;
+}
+
+TEST(malloc_and_free_are_attributed_to_the_caller) {
+  DebugHeapTotals before = debug_heap_table().totals();
+  void* p[3];
+  for (int i = 0; i < 3; i++) p[i] = alloc_a(7771);
+  DebugHeapTotals mid = debug_heap_table().totals();
+  int site = find_site(3 * 7771, 3, 3, 0);
+  for (int i = 0; i < 3; i++) free(p[i]);
+  DebugHeapTotals after = debug_heap_table().totals();
+
+  CHECK_EQ(mid.live - before.live, 3 * 7771);
+  CHECK_EQ(mid.blocks - before.blocks, 3);
+  CHECK(site >= 0 && site < DEBUG_HEAP_SITES);
+  CHECK_EQ(after.live, before.live);
+  CHECK_EQ(after.blocks, before.blocks);
+  DebugHeapSite s;
+  CHECK(debug_heap_table().site((size_t)site, &s));
+  CHECK_EQ(s.live, 0);
+  CHECK_EQ(s.frees, 3);
+}
+
+TEST(calloc_and_realloc_move_the_block) {
+  DebugHeapTotals before = debug_heap_table().totals();
+  void* p = alloc_b(5003);
+  CHECK(find_site(5003, 1, 1, 0) >= 0);
+  p = grow(p, 90001);
+  DebugHeapTotals mid = debug_heap_table().totals();
+  CHECK_EQ(mid.live - before.live, 90001);
+  CHECK_EQ(mid.blocks - before.blocks, 1);
+  CHECK(find_site(0, 0, 1, 1) >= 0);          // calloc site: freed by realloc
+  CHECK(find_site(90001, 1, 1, 0) >= 0);      // realloc site
+  free(p);
+  CHECK_EQ(debug_heap_table().totals().live, before.live);
+}
+
+TEST(new_is_attributed_to_its_caller) {
+  DebugHeapTotals before = debug_heap_table().totals();
+  char* a = new char[6007];
+  keep = a;
+  CHECK_EQ(debug_heap_table().totals().live - before.live, 6007);
+  CHECK(find_site(6007, 1, 1, 0) >= 0);
+  delete[] a;
+  CHECK_EQ(debug_heap_table().totals().live, before.live);
+}
+
+TEST(nested_free_still_erases_tracked_block) {
+  DebugHeapTotals before = debug_heap_table().totals();
+  void* p = alloc_a(4099);
+  {
+    DebugHeapGuard outer;  // As inside debug_heap_report()
+    free(p);
+    void* q = alloc_a(4099);  // Likely the same address; not recorded
+    CHECK_EQ(debug_heap_table().totals().blocks, before.blocks);
+    free(q);
+  }
+  // The address comes back outside the guard: exactly one entry for it
+  p = alloc_a(4099);
+  CHECK_EQ(debug_heap_table().totals().blocks - before.blocks, 1);
+  free(p);
+  DebugHeapTotals after = debug_heap_table().totals();
+  CHECK_EQ(after.blocks, before.blocks);
+  CHECK_EQ(after.live, before.live);
+}
+
+TEST(nested_realloc_erases_old_block) {
+  DebugHeapTotals before = debug_heap_table().totals();
+  void* p = alloc_a(3001);
+  {
+    DebugHeapGuard outer;
+    p = grow(p, 120000);
+  }
+  DebugHeapTotals mid = debug_heap_table().totals();
+  CHECK_EQ(mid.blocks, before.blocks);
+  CHECK_EQ(mid.live, before.live);
+  free(p);
+  CHECK_EQ(debug_heap_table().totals().blocks, before.blocks);
+}
+
+TEST(full_block_table_counts_untracked) {
+  DebugHeapTotals before = debug_heap_table().totals();
+  void* p[DEBUG_HEAP_BLOCKS];
+  for (int i = 0; i < DEBUG_HEAP_BLOCKS; i++) p[i] = alloc_a(16);
+  DebugHeapTotals mid = debug_heap_table().totals();
+  for (int i = 0; i < DEBUG_HEAP_BLOCKS; i++) free(p[i]);
+  DebugHeapTotals after = debug_heap_table().totals();
+  CHECK(mid.untracked > before.untracked);
+  CHECK(mid.blocks <= DEBUG_HEAP_BLOCKS / 8 * 7);
+  CHECK_EQ(after.blocks, before.blocks);
+  CHECK_EQ(after.live, before.live);
+}
+
+TEST(report_lists_sites_by_live_bytes) {
+  void* big = alloc_b(65521);
+  void* small = alloc_a(1021);
+  debug_heap_report();
+  std::string out = Serial.output();
+  Serial.clear();
+  free(big);
+  free(small);
+  CHECK(out.compare(0, 12, "[HEAP] live ") == 0);
+  size_t b = out.find("    65521    65521       1");
+  size_t s = out.find("     1021 ");
+  CHECK(b != std::string::npos && s != std::string::npos && b < s);
+}
+
+DEBUG_TEST_MAIN()
@@ -0,0 +1,75 @@
+/**
+ * @file test_levels.cpp
+ * @brief Release build (DEBUG=0, DEBUG_LEVEL=WARN): levels above the
+ *        threshold leave no code, no argument evaluation and no format
+ *        literal in the executable
+ *
+ * The executable is scanned for each level's marker text. The needles are
+ * built reversed at run time, so the scan itself puts no copy in the
+ * binary.
+ */
+
+#define DEBUG 0
+#define DEBUG_LEVEL DEBUG_LEVEL_WARN
+
+#include <algorithm>
+#include <debug.h>
+#include "debug_test.h"
+
+static int evaluated = 0;
+
+static int touch() { return ++evaluated; }
+
+__attribute__((noinline)) static void log_all_levels() {
+  debug_error("error-marker %d", 1);
+  debug_warn("warn-marker %d", 2);
+  debug_info("info-marker %d", touch());
+  debug_debug("debug-marker %d", touch());
+  debug_trace("trace-marker %d", touch());
+}
+
+static std::string self_exe() {
+  std::string s;
+  FILE* f = fopen("/proc/self/exe", "rb");
+  if (!f) return s;
+  char buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) s.append(buf, n);
+  fclose(f);
+  return s;
+}
+
+static bool in_binary(const std::string& exe, const char* reversed) {
+  std::string needle(reversed);
+  std::reverse(needle.begin(), needle.end());
+  return exe.find(needle) != std::string::npos;
+}
+
+TEST(levels_at_or_below_threshold_print) {
+  log_all_levels();
+  CHECK_OUTPUT("[E] error-marker 1\n[W] warn-marker 2\n");
+  CHECK_EQ(evaluated, 0);
+}
+
+TEST(levels_above_threshold_leave_no_literal) {
+  std::string exe = self_exe();
+  CHECK(exe.size() > 0);
+  CHECK(in_binary(exe, "rekram-rorre"));
+  CHECK(in_binary(exe, "rekram-nraw"));
+  CHECK(!in_binary(exe, "rekram-ofni"));
+  CHECK(!in_binary(exe, "rekram-gubed"));
+  CHECK(!in_binary(exe, "rekram-ecart"));
+}
+
+TEST(debug_off_macros_leave_no_literal) {
+  debugf("debugf-marker %d", touch());
+  debug_tag("[T]", "tag-marker");
+  (void)&touch;  // Only referenced by the removed macros
+  CHECK_OUTPUT("");
+  CHECK_EQ(evaluated, 0);
+  std::string exe = self_exe();
+  CHECK(!in_binary(exe, "rekram-fgubed"));
+  CHECK(!in_binary(exe, "rekram-gat"));
+}
+
+DEBUG_TEST_MAIN()
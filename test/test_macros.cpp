@@ -0,0 +1,280 @@
+/**
+ * @file test_macros.cpp
+ * @brief One case per public macro in the default text output mode
+ */
+
+#define DEBUG 1
+#define DEBUG_LEVEL DEBUG_LEVEL_TRACE
+#define DEBUG_FMT_CHECK 1
+#define DEBUG_TAG_LIST(X) X(CAN) X(SENSOR)
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <debug.h>
+#include "debug_test.h"
+
+TEST(debug_prints_without_newline) {
+  debug("a");
+  debug(42);
+  CHECK_OUTPUT("a42");
+}
+
+TEST(debugln_appends_crlf) {
+  debugln("hello");
+  debugln(-7);
+  CHECK_OUTPUT("hello\r\n-7\r\n");
+}
+
+TEST(debugf_formats) {
+  debugf("x=%d y=%s", 3, "abc");
+  debugf("plain");
+  CHECK_OUTPUT("x=3 y=abcplain");
+}
+
+TEST(debugfln_formats_line) {
+  debugfln("v=%u", 12u);
+  debugfln("done");
+  CHECK_OUTPUT("v=12\r\ndone\r\n");
+}
+
+TEST(debug_hex) {
+  debug_hex(0xFF);
+  debug(' ');
+  debug_hex(0x5);
+  debug(' ');
+  debug_hex(0xDEADBEEF);
+  CHECK_OUTPUT("FF 05 DEADBEEF");
+}
+
+TEST(debug_bin) {
+  debug_bin(0b1010);
+  debug(' ');
+  debug_bin(0);
+  CHECK_OUTPUT("1010 0");
+}
+
+TEST(debug_binw) {
+  debug_binw(0x2C, 8);
+  debug('|');
+  debug_binw(0x2C, 12);
+  debug('|');
+  debug_binw(1, 1);
+  CHECK_OUTPUT("0010 1100|0000 0010 1100|1");
+}
+
+TEST(debug_binw_clamps_width) {
+  debug_binw(0x80000001u, 40);
+  CHECK_OUTPUT("1000 0000 0000 0000 0000 0000 0000 0001");
+}
+
+TEST(debug_bits) {
+  debug_bits(0xAB, "EN:1,MODE:3,IRQ:4");
+  CHECK_OUTPUT("EN=1 MODE=101 IRQ=1010\n");
+}
+
+TEST(debug_array) {
+  const uint8_t data[] = {0x42, 0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC, 0xDE,
+                          'H', 'e', 'l', 'l', 'o', 0x00, 0x01, 0x02, 'A'};
+  debug_array(data, sizeof(data));
+  CHECK_OUTPUT("0000: 42 12 34 56 78 9A BC DE 48 65 6C 6C 6F 00 01 02  |B.4Vx...Hello...|\n"
+               "0010: 41                                               |A|\n");
+}
+
+TEST(debug_val) {
+  debug_val("count", 42);
+  debug_val("big", 5000000000LL);
+  debug_val("temp", 21.5f);
+  CHECK_OUTPUT("count=42\nbig=5000000000\ntemp=21.50\n");
+}
+
+TEST(debug_tag) {
+  debug_tag("[CAN]", "Message received");
+  CHECK_OUTPUT("[CAN] Message received\n");
+}
+
+TEST(debug_if) {
+  debug_if(false, "never %d", 1);
+  debug_if(1 + 1 == 2, "code %d", 7);
+  CHECK_OUTPUT("code 7\r\n");
+}
+
+TEST(debug_assert_passes_silently) {
+  debug_assert(true, "unused");
+  CHECK_OUTPUT("");
+}
+
+TEST(debug_assert_prints_and_halts) {
+  // The failing path never returns: run it in a child, read its output
+  // from a pipe, then check it is still spinning
+  int fds[2];
+  CHECK(pipe(fds) == 0);
+  fflush(stdout);  // Or the child inherits and re-emits our pending output
+  pid_t pid = fork();
+  if (pid == 0) {
+    dup2(fds[1], STDOUT_FILENO);
+    Serial.echo(true);
+    debug_assert(1 > 2, "boom");
+    _exit(0);
+  }
+  close(fds[1]);
+  std::string got;
+  char buf[64];
+  ssize_t n;
+  struct pollfd pfd = {fds[0], POLLIN, 0};
+  while (got.find('\n') == std::string::npos && poll(&pfd, 1, 2000) > 0 &&
+         (n = read(fds[0], buf, sizeof(buf))) > 0) {
+    got.append(buf, (size_t)n);
+  }
+  close(fds[0]);
+  usleep(20000);
+  int status;
+  CHECK(waitpid(pid, &status, WNOHANG) == 0);  // Still halted
+  kill(pid, SIGKILL);
+  waitpid(pid, &status, 0);
+  CHECK_STR(got, "[ASSERT] boom\n");
+}
+
+TEST(debug_micros_and_elapsed) {
+  unsigned long start = debug_micros();
+  delay(2);
+  CHECK(debug_micros() - start >= 2000);
+  debug_elapsed(start, "op");
+  std::string out = Serial.output();
+  CHECK(out.compare(0, 10, "[PERF] op:") == 0);
+  CHECK(out.size() > 4 && out.compare(out.size() - 4, 4, "µs\n") == 0);
+  Serial.clear();
+}
+
+TEST(debug_stack) {
+  debug_stack();
+  CHECK_OUTPUT("[STACK] not available on host\n");
+}
+
+TEST(level_macros) {
+  debug_error("e%d", 1);
+  debug_warn("w%d", 2);
+  debug_info("i%d", 3);
+  debug_debug("d%d", 4);
+  debug_trace("t%d", 5);
+  CHECK_OUTPUT("[E] e1\n[W] w2\n[I] i3\n[D] d4\n[T] t5\n");
+}
+
+TEST(debug_tagf_filters_by_tag) {
+  debug_tagf(CAN, "id=0x%X", 0x123);
+  debug_tag_enable(DEBUG_TAG_CAN, false);
+  debug_tagf(CAN, "hidden");
+  debug_tagf(SENSOR, "t=%d", 20);
+  CHECK_OUTPUT("[CAN] id=0x123\n[SENSOR] t=20\n");
+  CHECK(debug_tag_command("+CAN"));
+  CHECK(!debug_tag_command("+NOPE"));
+  debug_tagf(CAN, "back");
+  CHECK_OUTPUT("[CAN] back\n");
+}
+
+TEST(debug_tag_poll) {
+  Serial.inject("-SENSOR\n?\nbogus\n");
+  debug_tag_poll(Serial);
+  CHECK_OUTPUT("[TAGS] +CAN\n[TAGS] -SENSOR\n[TAGS] unknown command 'bogus'\n");
+  debug_tag_command("+*");
+}
+
+TEST(debug_ratelimit) {
+  for (int i = 0; i < 5; i++) debug_ratelimit(1, 2, "hot %d", i);
+  CHECK_OUTPUT("hot 0\nhot 1\n");
+}
+
+// One call site: 10 per second, burst of 2
+static void ratelimited(int i) { debug_ratelimit(10, 2, "warm %d", i); }
+
+TEST(debug_ratelimit_refill_reports_suppressed) {
+  for (int i = 0; i < 5; i++) ratelimited(i);
+  CHECK_OUTPUT("warm 0\nwarm 1\n");
+  delay(1000 / 10 + 20);  // One token back, not two
+  ratelimited(5);
+  ratelimited(6);
+  CHECK_OUTPUT("[RATELIMIT] 3 suppressed\nwarm 5\n");
+  delay(2 * 1000 / 10 + 20);  // Full burst again
+  for (int i = 7; i < 10; i++) ratelimited(i);
+  CHECK_OUTPUT("[RATELIMIT] 1 suppressed\nwarm 7\nwarm 8\n");
+}
+
+TEST(debug_sample) {
+  for (int i = 0; i < 7; i++) debug_sample(3, "s%d", i);
+  CHECK_OUTPUT("[SAMPLE 1/1] s0\n[SAMPLE 2/4] s3\n[SAMPLE 3/7] s6\n");
+}
+
+TEST(debug_sample_random) {
+  for (int i = 0; i < 4000; i++) debug_sample_random(4, "r");
+  std::string out = Serial.output();
+  size_t lines = 0;
+  for (size_t i = 0; i < out.size(); i++) lines += out[i] == '\n';
+  CHECK(lines > 800 && lines < 1200);  // 1000 expected
+  Serial.clear();
+}
+
+TEST(debug_scope_and_profile_report) {
+  for (int i = 0; i < 3; i++) {
+    DEBUG_SCOPE("unit");
+  }
+  debug_profile_report();
+  std::string out = Serial.output();
+  CHECK(out.find("[PROFILE] scope") == 0);
+  CHECK(out.find("[PROFILE] unit") != std::string::npos);
+  Serial.clear();
+  debug_profile_reset();
+}
+
+TEST(debug_scope_histogram_report) {
+  for (int i = 0; i < 10; i++) {
+    DEBUG_SCOPE_HISTOGRAM("hist");
+  }
+  debug_histogram_report();
+  std::string out = Serial.output();
+  CHECK(out.find("[LATENCY] hist") != std::string::npos);
+  CHECK(out.find(" 10 ") != std::string::npos);
+  Serial.clear();
+}
+
+TEST(debug_isr_and_drain) {
+  debug_isr("edge");
+  debugf_isr("gpio=%d n=%u", 4, 9u);
+  CHECK_OUTPUT("");  // Nothing formatted until drained
+  CHECK_EQ(debug_isr_drain(), 2);
+  std::string out = Serial.output();
+  CHECK(out.find("[ISR c0 L") == 0);
+  CHECK(out.find("] edge\n[ISR c0 L") != std::string::npos);
+  CHECK(out.find("] gpio=4 n=9\n") != std::string::npos);
+  Serial.clear();
+  debug_isr_report();
+  CHECK(Serial.output().find("2 logged, 0 dropped") != std::string::npos);
+  Serial.clear();
+}
+
+#define FMT_RESULT(fmt, ...) debug_fmt_check(fmt, false, decltype(debug_fmt_types(__VA_ARGS__))())
+
+TEST(format_check_results) {
+  static_assert(FMT_RESULT("%d %s", 1, "a") == DEBUG_FMT_OK, "matching arguments");
+  static_assert(FMT_RESULT("%d", 1.0f) == DEBUG_FMT_MISMATCH, "float for %d");
+  static_assert(FMT_RESULT("%lld", 1) == DEBUG_FMT_MISMATCH, "int for %lld");
+  static_assert(FMT_RESULT("%d %d", 1) == DEBUG_FMT_TOO_FEW, "missing argument");
+  static_assert(FMT_RESULT("%d", 1, 2) == DEBUG_FMT_TOO_MANY, "extra argument");
+  static_assert(FMT_RESULT("%b", 1) == DEBUG_FMT_BAD_SPEC, "no %b in newlib");
+  // Documented limit: signedness is not checked
+  static_assert(FMT_RESULT("%u", -1) == DEBUG_FMT_OK, "%u given an int passes");
+}
+
+TEST(debugf_isr_format_limits) {
+  static_assert(debug_fmt_isr_safe("a=%d b=%u c=%hx s=%s p=%p %*d", false), "32-bit conversions");
+  static_assert(!debug_fmt_isr_safe("v=%lld", false), "64-bit integer");
+  static_assert(!debug_fmt_isr_safe("v=%d f=%.2f", false), "floating point");
+  static_assert(!debug_fmt_isr_safe("v=%jd", false), "intmax_t");
+}
+
+TEST(debugg_legacy) {
+  debugg("%d-%d\n", 1, 2);
+  CHECK_OUTPUT("1-2\n");
+}
+
+DEBUG_TEST_MAIN()
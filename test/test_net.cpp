@@ -0,0 +1,179 @@
+/**
+ * @file test_net.cpp
+ * @brief DebugNetSink over loopback against tools/debug_netrecv (UDP and
+ *        TCP), and the dropped-record count in the datagram header
+ */
+
+#define DEBUG 1
+#define DEBUG_LEVEL DEBUG_LEVEL_TRACE
+#define DEBUG_SINKS 1
+
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <debug.h>
+#include <debug_net.h>
+#include "debug_test.h"
+
+static std::string read_file(const std::string& path) {
+  std::string s;
+  FILE* f = fopen(path.c_str(), "rb");
+  if (!f) return s;
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) s.append(buf, n);
+  fclose(f);
+  return s;
+}
+
+/**
+ * debug_netrecv on a port of its own, stdout and stderr in temp files
+ */
+struct Receiver {
+  pid_t pid;
+  uint16_t port;
+  std::string out_path, err_path;
+
+  explicit Receiver(const char* flag) : pid(-1) {
+    static uint16_t next_port = (uint16_t)(20000 + getpid() % 20000);
+    port = next_port++;
+    char out[] = "/tmp/debug_net_out_XXXXXX", err[] = "/tmp/debug_net_err_XXXXXX";
+    close(mkstemp(out));
+    close(mkstemp(err));
+    out_path = out;
+    err_path = err;
+    std::string port_arg = std::to_string(port);
+    fflush(stdout);  // Or the child repeats the buffered report
+    pid = fork();
+    if (pid == 0) {
+      if (!freopen(out, "w", stdout) || !freopen(err, "w", stderr)) _exit(127);
+      execl(DEBUG_NETRECV_TOOL, DEBUG_NETRECV_TOOL, flag, port_arg.c_str(), (char*)NULL);
+      _exit(127);
+    }
+    // Datagrams sent before the bind would be lost
+    for (int i = 0; i < 500 && err_text().find("listening") == std::string::npos; i++) delay(10);
+  }
+
+  ~Receiver() {
+    stop();
+    unlink(out_path.c_str());
+    unlink(err_path.c_str());
+  }
+
+  std::string out_text() const { return read_file(out_path); }
+  std::string err_text() const { return read_file(err_path); }
+
+  bool wait_for(size_t bytes) const {
+    for (int i = 0; i < 500; i++) {
+      if (out_text().size() >= bytes) return true;
+      delay(10);
+    }
+    return false;
+  }
+
+  int stop() {
+    if (pid <= 0) return -1;
+    kill(pid, SIGINT);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    pid = -1;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+  }
+};
+
+// The sender task is detached and runs forever, so sinks are never freed
+static DebugNetSink& started_sink(const Receiver& rx, DebugNetProto proto) {
+  DebugNetSink* net = new DebugNetSink();
+  net->begin("127.0.0.1", rx.port, proto);
+  return *net;
+}
+
+static std::string send_lines(DebugNetSink& net, int count) {
+  std::string expected;
+  for (int i = 0; i < count; i++) {
+    char line[32];
+    int n = snprintf(line, sizeof(line), "line %d\n", i);
+    CHECK_EQ(net.write((const uint8_t*)line, (size_t)n), (size_t)n);
+    expected.append(line, (size_t)n);
+    if (i % 100 == 99) net.flush();  // Stay well inside the ring
+  }
+  net.flush();
+  return expected;
+}
+
+TEST(udp_lines_arrive_complete_and_in_order) {
+  Receiver rx("-m");
+  DebugNetSink& net = started_sink(rx, DEBUG_NET_UDP);
+  std::string expected = send_lines(net, 2000);
+  CHECK(rx.wait_for(expected.size() + 2000 * 13));  // "[     0.123] " per line
+  CHECK_EQ(rx.stop(), 0);
+  std::string out = rx.out_text();
+  std::string stripped;
+  for (size_t i = 0; i < out.size();) {
+    CHECK(out[i] == '[');
+    size_t end = out.find('\n', i);
+    if (out[i] != '[' || end == std::string::npos) break;
+    stripped += out.substr(i + 13, end + 1 - (i + 13));
+    i = end + 1;
+  }
+  CHECK(stripped == expected);
+  CHECK(rx.err_text().find("lost") == rx.err_text().rfind("lost"));  // Only in the summary
+  CHECK_EQ(net.dropped(), 0);
+  CHECK_EQ(net.send_errors(), 0);
+}
+
+TEST(tcp_lines_arrive_complete_and_in_order) {
+  Receiver rx("-t");
+  DebugNetSink& net = started_sink(rx, DEBUG_NET_TCP);
+  for (int i = 0; i < 200 && !net.connected(); i++) delay(10);
+  std::string expected = send_lines(net, 2000);
+  CHECK(rx.wait_for(expected.size()));
+  CHECK_EQ(rx.stop(), 0);
+  CHECK(rx.out_text() == expected);
+  CHECK(rx.err_text().find("connected") != std::string::npos);
+}
+
+TEST(level_macros_reach_the_receiver) {
+  Receiver rx("-t");
+  DebugNetSink& net = started_sink(rx, DEBUG_NET_TCP);
+  debug_sink_add(net, DEBUG_LEVEL_WARN);
+  for (int i = 0; i < 200 && !net.connected(); i++) delay(10);
+  debug_warn("over temp %d", 91);
+  debug_info("not sent");
+  debug_error("fault %s", "E42");
+  net.flush();
+  CHECK(rx.wait_for(26));
+  CHECK_EQ(rx.stop(), 0);
+  CHECK_STR(rx.out_text(), "[W] over temp 91\n[E] fault E42\n");
+  net.level = 0;  // Later cases write to the sink directly
+  Serial.clear();
+}
+
+TEST(dropped_records_are_reported_as_records) {
+  Receiver rx("-m");
+  // Fill the ring before the sender starts: nothing leaves until begin()
+  DebugNetSink* net = new DebugNetSink();
+  std::string accepted;
+  for (int i = 0; i < 1000; i++) {
+    char line[32];
+    int n = snprintf(line, sizeof(line), "queued %d\n", i);
+    if (net->write((const uint8_t*)line, (size_t)n)) accepted.append(line, (size_t)n);
+  }
+  uint32_t dropped = net->dropped();
+  CHECK(dropped > 0 && dropped < 1000);
+  net->begin("127.0.0.1", rx.port, DEBUG_NET_UDP);
+  net->flush();
+  for (int i = 0; i < 200 && net->sent() == 0; i++) {
+    delay(10);
+    net->flush();
+  }
+  CHECK(rx.wait_for(accepted.size()));
+  CHECK_EQ(rx.stop(), 0);
+  std::string err = rx.err_text();
+  std::string note = "device dropped " + std::to_string(dropped) + " record(s)";
+  CHECK(err.find(note) != std::string::npos);
+  CHECK(err.find(std::to_string(dropped) + " records dropped on device") != std::string::npos);
+}
+
+DEBUG_TEST_MAIN()
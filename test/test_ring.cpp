@@ -0,0 +1,151 @@
+/**
+ * @file test_ring.cpp
+ * @brief DebugRing record semantics and a multi-producer stress test
+ *
+ * Producers write numbered records of varying length while one consumer
+ * pops concurrently; every record must arrive whole, and each producer's
+ * records in order (gap-free unless the policy drops).
+ */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <debug_ring.h>
+#include "debug_test.h"
+
+static const int kProducers = 4;
+static const uint32_t kRecords = 20000;
+
+// Record: producer id, sequence number, then length-dependent filler
+static size_t make_record(uint8_t* buf, uint8_t producer, uint32_t seq) {
+  size_t len = 8 + (seq * 7 + producer) % 90;
+  buf[0] = producer;
+  memcpy(buf + 1, &seq, 4);
+  for (size_t i = 5; i < len; i++) buf[i] = (uint8_t)(producer ^ seq ^ i);
+  return len;
+}
+
+static bool record_intact(const uint8_t* buf, int len, uint8_t* producer, uint32_t* seq) {
+  if (len < 8) return false;
+  *producer = buf[0];
+  memcpy(seq, buf + 1, 4);
+  if (*producer >= kProducers || (size_t)len != 8 + (*seq * 7 + *producer) % 90) return false;
+  for (int i = 5; i < len; i++) {
+    if (buf[i] != (uint8_t)(*producer ^ *seq ^ i)) return false;
+  }
+  return true;
+}
+
+template <size_t N>
+static void stress(DebugOverflowPolicy policy, bool expect_all) {
+  static DebugRing<N> ring;
+  std::atomic<int> running(kProducers);
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; p++) {
+    producers.push_back(std::thread([&, p] {
+      uint8_t buf[128];
+      for (uint32_t seq = 0; seq < kRecords; seq++) {
+        ring.write(buf, make_record(buf, (uint8_t)p, seq), policy);
+      }
+      running--;
+    }));
+  }
+
+  uint32_t next[kProducers] = {0};
+  uint32_t received = 0, torn = 0, out_of_order = 0;
+  uint8_t rec[DebugRing<N>::record_max()];
+  for (;;) {
+    bool done = running.load() == 0;
+    int n;
+    while ((n = ring.pop(rec, sizeof(rec), NULL)) >= 0) {
+      uint8_t p;
+      uint32_t seq;
+      if (!record_intact(rec, n, &p, &seq)) {
+        torn++;
+        continue;
+      }
+      if (seq < next[p] || (expect_all && seq != next[p])) out_of_order++;
+      next[p] = seq + 1;
+      received++;
+    }
+    if (done) break;
+    std::this_thread::yield();
+  }
+  for (size_t t = 0; t < producers.size(); t++) producers[t].join();
+
+  CHECK_EQ(torn, 0);
+  CHECK_EQ(out_of_order, 0);
+  if (expect_all) {
+    CHECK_EQ(received, kProducers * kRecords);
+    CHECK_EQ(ring.dropped(), 0);
+  } else {
+    CHECK(received > 0);
+  }
+  CHECK_EQ(ring.used(), 0);
+}
+
+TEST(write_pop_round_trip) {
+  static DebugRing<256> ring;
+  CHECK_EQ(ring.write((const uint8_t*)"hello", 5, DEBUG_DROP_NEWEST, 42), 5);
+  uint8_t out[64];
+  uint32_t stamp = 0;
+  CHECK_EQ(ring.pop(out, sizeof(out), &stamp), 5);
+  CHECK(memcmp(out, "hello", 5) == 0);
+  CHECK_EQ(stamp, 42);
+  CHECK_EQ(ring.pop(out, sizeof(out), NULL), -1);
+}
+
+TEST(long_write_is_truncated_to_one_record) {
+  static DebugRing<4096> ring;
+  uint8_t data[300];
+  for (size_t i = 0; i < sizeof(data); i++) data[i] = (uint8_t)i;
+  CHECK_EQ(ring.write(data, sizeof(data), DEBUG_DROP_NEWEST), ring.record_max());
+  CHECK_EQ(ring.truncated(), 1);
+  CHECK_EQ(ring.dropped(), sizeof(data) - ring.record_max());
+  uint8_t out[256];
+  CHECK_EQ(ring.pop(out, sizeof(out), NULL), (int)ring.record_max());
+  CHECK(memcmp(out, data, ring.record_max()) == 0);
+  CHECK_EQ(ring.pop(out, sizeof(out), NULL), -1);
+}
+
+static size_t format_line(char* line, size_t size, size_t* cut, const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  size_t n = debug_vformat_line(line, size, fmt, args, cut);
+  va_end(args);
+  return n;
+}
+
+TEST(formatted_line_reports_cut_bytes) {
+  char line[8];
+  size_t cut = 99;
+  CHECK_EQ(format_line(line, sizeof(line), &cut, "%d", 42), 2);
+  CHECK_EQ(cut, 0);
+  CHECK_EQ(format_line(line, sizeof(line), &cut, "%s", "0123456789"), 7);
+  CHECK_EQ(cut, 3);
+  CHECK_STR(line, "0123456");
+  CHECK_EQ(format_line(line, sizeof(line), &cut, "%s", ""), 0);
+  CHECK_EQ(cut, 0);
+
+  static DebugRing<256> ring;
+  ring.discard(3);
+  CHECK_EQ(ring.truncated(), 1);
+  CHECK_EQ(ring.dropped(), 3);
+}
+
+TEST(drop_newest_keeps_whole_records) {
+  static DebugRing<128> ring;  // record_max() 32
+  uint8_t data[32] = {0};
+  size_t accepted = 0;
+  for (int i = 0; i < 10; i++) accepted += ring.write(data, sizeof(data), DEBUG_DROP_NEWEST);
+  CHECK_EQ(accepted % 32, 0);
+  CHECK_EQ(ring.dropped(), 10 * 32 - accepted);
+}
+
+TEST(mpsc_block_delivers_everything_in_order) { stress<1024>(DEBUG_BLOCK, true); }
+
+TEST(mpsc_drop_newest_never_tears) { stress<1024>(DEBUG_DROP_NEWEST, false); }
+
+TEST(mpsc_drop_oldest_never_tears) { stress<1024>(DEBUG_DROP_OLDEST, false); }
+
+DEBUG_TEST_MAIN()
@@ -0,0 +1,107 @@
+/**
+ * @file test_sinks.cpp
+ * @brief DEBUG_SINKS dispatch: per-sink level thresholds, records nobody
+ *        wants left unformatted, and flush() reaching only buffered sinks
+ *
+ * Registration is append-only, so the cases run in order and add sinks
+ * as they go.
+ */
+
+#define DEBUG 1
+#define DEBUG_LEVEL DEBUG_LEVEL_TRACE
+#define DEBUG_SINKS 1
+
+#include <unistd.h>
+#include <debug.h>
+#include "debug_test.h"
+
+static DebugMemorySink<256> warn_sink, error_sink, trace_sink;
+
+// Counts flush() calls
+class FlushCounter : public DebugSink {
+ public:
+  explicit FlushCounter(uint8_t caps) : DebugSink(caps), flushes(0) {}
+  size_t write(const uint8_t*, size_t len) override { return len; }
+  void flush() override { flushes++; }
+  int flushes;
+};
+
+static std::string text(DebugMemorySink<256>& sink) {
+  std::string s(sink.data(), sink.size());
+  sink.clear();
+  return s;
+}
+
+static int evaluated;
+
+static int counted(int v) {
+  evaluated++;
+  return v;
+}
+
+TEST(levels_reach_only_sinks_that_accept_them) {
+  CHECK(debug_sink_add(warn_sink, DEBUG_LEVEL_WARN));
+  CHECK(debug_sink_add(error_sink, DEBUG_LEVEL_ERROR));
+  debug_error("e%d", 1);
+  debug_warn("w%d", 2);
+  CHECK_STR(text(error_sink), "[E] e1\n");
+  CHECK_STR(text(warn_sink), "[E] e1\n[W] w2\n");
+}
+
+TEST(record_no_sink_wants_is_not_formatted) {
+  evaluated = 0;
+  debug_info("i%d", counted(3));
+  debugf("default level %d\n", 4);  // DEBUG_SINK_DEFAULT_LEVEL, above WARN
+  debug_warn("w%d", counted(5));
+  CHECK_EQ(evaluated, 1);
+  CHECK(!debug_sinks().wants(DEBUG_LEVEL_INFO));
+  CHECK_STR(text(warn_sink), "[W] w5\n");
+  CHECK_STR(text(error_sink), "");
+}
+
+TEST(adding_a_lower_threshold_opens_its_levels) {
+  CHECK(debug_sink_add(trace_sink, DEBUG_LEVEL_TRACE));
+  debug_trace("t");
+  debugf("x=%d\n", 7);
+  debug_val("n", 8);
+  debug_error("e");
+  CHECK_STR(text(trace_sink), "[T] t\nx=7\nn=8\n[E] e\n");
+  CHECK_STR(text(warn_sink), "[E] e\n");
+  CHECK_STR(text(error_sink), "[E] e\n");
+}
+
+TEST(flush_reaches_only_buffered_sinks) {
+  static FlushCounter buffered(DEBUG_SINK_BUFFERED), direct(0);
+  CHECK(debug_sink_add(buffered, DEBUG_LEVEL_TRACE));
+  CHECK(debug_sink_add(direct, DEBUG_LEVEL_TRACE));
+  DEBUG_OUT.flush();
+  debug_sinks().at(DEBUG_LEVEL_WARN).flush();
+  CHECK_EQ(buffered.flushes, 2);
+  CHECK_EQ(direct.flushes, 0);
+}
+
+TEST(file_sink_holds_records_until_flush) {
+  char path[] = "/tmp/debug_sink_XXXXXX";
+  int fd = mkstemp(path);
+  static DebugFileSink file(fdopen(fd, "w"), 4096);
+  CHECK(file.caps() & DEBUG_SINK_BUFFERED);
+  CHECK(debug_sink_add(file, DEBUG_LEVEL_WARN));
+  debug_warn("kept %d", 1);
+  debug_info("not for the file");
+  CHECK_EQ(lseek(fd, 0, SEEK_END), 0);  // Still in the stdio buffer
+  DEBUG_OUT.flush();
+  char buf[64] = {0};
+  CHECK_EQ(pread(fd, buf, sizeof(buf) - 1, 0), 11);
+  CHECK_STR(buf, "[W] kept 1\n");
+  unlink(path);
+  text(trace_sink);
+  text(warn_sink);
+  text(error_sink);
+}
+
+TEST(registry_is_bounded) {
+  static DebugMemorySink<16> extra;
+  CHECK(!debug_sink_add(extra, DEBUG_LEVEL_TRACE));  // DEBUG_SINK_MAX (6) already taken
+}
+
+DEBUG_TEST_MAIN()
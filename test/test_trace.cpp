@@ -0,0 +1,190 @@
+/**
+ * @file test_trace.cpp
+ * @brief DEBUG_TRACE dump format, which events survive a wrapped buffer,
+ *        pause/quiesce under concurrent recording, and tools/debug_trace
+ *        alignment of two skewed cores
+ */
+
+#define DEBUG 1
+#define DEBUG_TRACE 1
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <debug.h>
+#include "debug_test.h"
+
+struct TraceCapture {
+  std::string bytes;
+  size_t write(const uint8_t* p, size_t n) {
+    bytes.append((const char*)p, n);
+    return n;
+  }
+};
+
+// Count frames of one kind in a capture
+static int count_frames(const std::string& capture, uint8_t kind) {
+  int n = 0;
+  for (size_t i = 0; i + 3 <= capture.size(); i += 3 + (uint8_t)capture[i + 2]) {
+    if ((uint8_t)capture[i] != DEBUG_FRAME_MARK) return -1;
+    n += (uint8_t)capture[i + 1] == kind;
+  }
+  return n;
+}
+
+TEST(dump_writes_clock_anchor_and_events) {
+  for (int i = 0; i < 3; i++) {
+    DEBUG_SCOPE("span");
+  }
+  debug_trace_dump();
+  std::string out = Serial.output();
+  Serial.clear();
+  CHECK_EQ(count_frames(out, DEBUG_FRAME_TRACE_INFO), 1);
+  CHECK_EQ(count_frames(out, DEBUG_FRAME_TRACE_CLOCK), 1);
+  CHECK_EQ(count_frames(out, DEBUG_FRAME_TRACE_EVENTS), 1);
+  CHECK_EQ(debug_trace_buffer().head.load(), 0);
+}
+
+// Run tools/debug_trace on a capture; returns its stdout, and its stderr
+// summary through `summary`
+static std::string convert(const std::string& capture, std::string* summary) {
+  char in_path[] = "/tmp/debug_trace_XXXXXX";
+  char err_path[] = "/tmp/debug_trace_err_XXXXXX";
+  int fd = mkstemp(in_path);
+  int err = mkstemp(err_path);
+  CHECK(fd >= 0 && err >= 0);
+  CHECK(write(fd, capture.data(), capture.size()) == (ssize_t)capture.size());
+  close(fd);
+  std::string cmd = std::string(DEBUG_TRACE_TOOL) + " " + in_path + " 2>" + err_path;
+  FILE* p = popen(cmd.c_str(), "r");
+  CHECK(p != NULL);
+  std::string json;
+  char buf[256];
+  size_t n;
+  while (p && (n = fread(buf, 1, sizeof(buf), p)) > 0) json.append(buf, n);
+  if (p) CHECK_EQ(pclose(p), 0);
+  n = (size_t)pread(err, buf, sizeof(buf) - 1, 0);
+  buf[n < sizeof(buf) ? n : 0] = 0;
+  if (summary) *summary = buf;
+  close(err);
+  unlink(in_path);
+  unlink(err_path);
+  return json;
+}
+
+// Begin/end pairs with cycles = sequence number, 101 more events than fit:
+// the oldest survivor is the end of a span whose begin was overwritten
+TEST(overfilled_buffer_keeps_the_newest_events) {
+  const uint32_t total = DEBUG_TRACE_EVENTS + 101;
+  for (uint32_t i = 0; i < total; i++) {
+    debug_trace_record(3, i & 1 ? DEBUG_TRACE_END : DEBUG_TRACE_BEGIN, i);
+  }
+  TraceCapture cap;
+  debug_trace_print(cap);
+
+  const size_t per_frame = DEBUG_FRAME_MAX / sizeof(DebugTraceEvent);
+  std::vector<DebugTraceEvent> events;
+  int frames = 0;
+  for (size_t f = 0; f + 3 <= cap.bytes.size(); f += 3 + (uint8_t)cap.bytes[f + 2]) {
+    if ((uint8_t)cap.bytes[f + 1] != DEBUG_FRAME_TRACE_EVENTS) continue;
+    size_t len = (uint8_t)cap.bytes[f + 2];
+    CHECK_EQ(len % 8, 0);  // 8 bytes per event on the wire
+    CHECK(len <= per_frame * 8);
+    for (size_t e = 0; e < len; e += 8) {
+      DebugTraceEvent ev;
+      memcpy(&ev, cap.bytes.data() + f + 3 + e, 8);
+      events.push_back(ev);
+    }
+    frames++;
+  }
+  CHECK_EQ(frames, (DEBUG_TRACE_EVENTS + per_frame - 1) / per_frame);
+  CHECK_EQ(events.size(), DEBUG_TRACE_EVENTS);
+  for (size_t i = 0; i < events.size(); i++) {
+    if (events[i].cycles != total - DEBUG_TRACE_EVENTS + i) {
+      CHECK_EQ(events[i].cycles, total - DEBUG_TRACE_EVENTS + i);
+      break;
+    }
+  }
+  CHECK_EQ(events.front().type, DEBUG_TRACE_END);
+  CHECK_EQ(events.back().type, DEBUG_TRACE_BEGIN);
+
+  // Orphaned end at the front and open begin at the back are dropped
+  std::string summary;
+  convert(cap.bytes, &summary);
+  CHECK_STR(summary, std::to_string(DEBUG_TRACE_EVENTS) + " events, " +
+                         std::to_string(DEBUG_TRACE_EVENTS / 2 - 1) + " spans\n");
+}
+
+TEST(dump_waits_for_in_flight_records) {
+  std::atomic<bool> stop(false);
+  std::vector<std::thread> producers;
+  for (int t = 0; t < 4; t++) {
+    producers.push_back(std::thread([&] {
+      while (!stop.load()) debug_trace_record(7, DEBUG_TRACE_END, debug_cycles());
+    }));
+  }
+  int dumped = 0;
+  for (int i = 0; i < 100; i++) {
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+    TraceCapture cap;
+    debug_trace_print(cap);
+    // Every event in the dump must be one the producers wrote in full
+    for (size_t f = 0; f + 3 <= cap.bytes.size(); f += 3 + (uint8_t)cap.bytes[f + 2]) {
+      if ((uint8_t)cap.bytes[f + 1] != DEBUG_FRAME_TRACE_EVENTS) continue;
+      for (size_t e = 0; e + 8 <= (uint8_t)cap.bytes[f + 2]; e += 8) {
+        DebugTraceEvent ev;
+        memcpy(&ev, cap.bytes.data() + f + 3 + e, 8);
+        CHECK(ev.name == 7 && ev.type == DEBUG_TRACE_END);
+        dumped++;
+      }
+    }
+  }
+  stop = true;
+  for (size_t t = 0; t < producers.size(); t++) producers[t].join();
+  CHECK(dumped > 0);
+  CHECK_EQ(debug_trace_buffer().writers.load(), 0);
+  debug_trace_buffer().head.store(0);
+}
+
+// Two cores whose counters differ by billions of cycles (core 1 wraps):
+// both spans run 200 us, core 1's starts 50 us after core 0's
+TEST(converter_aligns_cores_through_clock_anchors) {
+  TraceCapture cap;
+  uint32_t per_us = 1000;
+  debug_frame_write(cap, DEBUG_FRAME_TRACE_INFO, &per_us, 4);
+  const uint32_t anchor[2] = {5000000u, 0xFFFFFF00u};
+  const uint64_t anchor_us = 1000;
+  for (uint8_t core = 0; core < 2; core++) {
+    uint8_t clock[13] = {core};
+    memcpy(clock + 1, &anchor[core], 4);
+    memcpy(clock + 5, &anchor_us, 8);
+    debug_frame_write(cap, DEBUG_FRAME_TRACE_CLOCK, clock, sizeof(clock));
+  }
+  const uint8_t a[] = {0, 'A'}, b[] = {1, 'B'};
+  debug_frame_write(cap, DEBUG_FRAME_TRACE_NAME, a, 2);
+  debug_frame_write(cap, DEBUG_FRAME_TRACE_NAME, b, 2);
+
+  // Stamp = anchor - (1 ms - time in ns), one cycle per ns
+  struct { uint8_t core, name, type; uint32_t ns; } spec[] = {
+      {0, 0, DEBUG_TRACE_BEGIN, 100000}, {1, 1, DEBUG_TRACE_BEGIN, 150000},
+      {0, 0, DEBUG_TRACE_END, 300000}, {1, 1, DEBUG_TRACE_END, 350000}};
+  DebugTraceEvent events[4];
+  for (int i = 0; i < 4; i++) {
+    events[i].cycles = anchor[spec[i].core] - (1000000u - spec[i].ns);
+    events[i].name = spec[i].name;
+    events[i].task = spec[i].core;
+    events[i].core = spec[i].core;
+    events[i].type = spec[i].type;
+  }
+  debug_frame_write(cap, DEBUG_FRAME_TRACE_EVENTS, events, sizeof(events));
+
+  std::string json = convert(cap.bytes, NULL);
+  CHECK(json.find("{\"name\":\"A\",\"ph\":\"X\",\"ts\":0.000,\"dur\":200.000,\"pid\":0") !=
+        std::string::npos);
+  CHECK(json.find("{\"name\":\"B\",\"ph\":\"X\",\"ts\":50.000,\"dur\":200.000,\"pid\":1") !=
+        std::string::npos);
+}
+
+DEBUG_TEST_MAIN()
@@ -0,0 +1,73 @@
+/**
+ * @file debug_decode.cpp
+ * @brief Host tool: turn a captured serial log with binary debug frames
+ *        back into text
+ *
+ * Build (Linux/macOS):
+ *   g++ -std=c++11 -O2 -Iinclude -o debug_decode tools/debug_decode.cpp
+ *
+ * Usage:
+ *   debug_decode firmware.elf [capture.bin]      # reads stdin without capture
+ *   debug_decode tokens.csv [capture.bin]        # tokenized logs, no ELF needed
+ *   pio device monitor --raw | debug_decode .pio/build/esp32dev/firmware.elf
+ *
+ * The ELF must be the exact image running on the device, since deferred
+ * frames carry raw format-string addresses. Tokenized frames only need the
+ * token database (from the ELF or tools/debug_tokens.cpp).
+ */
+
+#include <stdio.h>
+#include <string>
+#include "debug_decode.h"
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s firmware.elf|tokens.csv [capture.bin]\n", argv[0]);
+    return 2;
+  }
+
+  DebugElfImage image;
+  DebugTokenDatabase tokens;
+  if (image.load(argv[1])) {
+    tokens.load(image);
+  } else if (!tokens.load_csv(argv[1])) {
+    fprintf(stderr, "%s: cannot read ELF or token database '%s'\n", argv[0], argv[1]);
+    return 1;
+  }
+  for (size_t i = 0; i < tokens.collisions().size(); i++) {
+    fprintf(stderr, "%s: warning: token %08x collision, decoding as \"%s\"\n", argv[0],
+            (unsigned)tokens.collisions()[i].token, debug_token_escape(tokens.collisions()[i].kept).c_str());
+  }
+
+  FILE* in = stdin;
+  if (argc > 2 && !(in = fopen(argv[2], "rb"))) {
+    fprintf(stderr, "%s: cannot open '%s'\n", argv[0], argv[2]);
+    return 1;
+  }
+
+  DebugFrameParser parser;
+  std::string out;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+    parser.feed(
+        buf, n, [&](char c) { out += c; },
+        [&](uint8_t kind, const uint8_t* payload, size_t len) {
+          if (kind == DEBUG_FRAME_DEFERRED || kind == DEBUG_FRAME_DEFERRED_LN) {
+            debug_render_deferred(image, kind, payload, len, out);
+          } else if (kind == DEBUG_FRAME_TOKEN || kind == DEBUG_FRAME_TOKEN_LN) {
+            debug_render_token(tokens, kind, payload, len, out);
+          } else {
+            char note[40];
+            snprintf(note, sizeof(note), "<frame kind %u, %u bytes>\n", kind, (unsigned)len);
+            out += note;
+          }
+        });
+    fwrite(out.data(), 1, out.size(), stdout);
+    fflush(stdout);
+    out.clear();
+  }
+
+  if (in != stdin) fclose(in);
+  return 0;
+}
@@ -0,0 +1,220 @@
+/**
+ * @file debug_netrecv.cpp
+ * @brief Host tool: receive DebugNetSink output (debug_net.h) over UDP or TCP
+ *
+ * Build (Linux/macOS):
+ *   g++ -std=c++11 -O2 -Iinclude -o debug_netrecv tools/debug_netrecv.cpp
+ *
+ * Usage:
+ *   debug_netrecv [-t] [-m] port               # text output
+ *   debug_netrecv port | debug_decode firmware.elf   # deferred/tokenized
+ *
+ *   -t  listen for TCP connections instead of UDP datagrams
+ *   -m  prefix each line with the device time "[    12.345] "
+ *
+ * Record bytes go to stdout unchanged. Notes go to stderr: a new device
+ * boot, lost datagrams (sequence gaps), reordered or duplicate datagrams
+ * and records the device dropped before sending. Ctrl-C prints a summary.
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <map>
+#include <string>
+#include "debug_datagram.h"
+
+struct Session {
+  uint32_t next_seq;
+  uint32_t dropped;
+  bool line_start;
+};
+
+struct Totals {
+  uint64_t datagrams;
+  uint64_t records;
+  uint64_t lost;
+  uint64_t late;
+  uint64_t dropped;
+  uint64_t invalid;
+};
+
+static volatile sig_atomic_t stop = 0;
+static bool stamp_lines = false;
+static std::map<uint32_t, Session> sessions;  // By boot id
+static Totals totals;
+
+static void on_signal(int) { stop = 1; }
+
+static void write_record(Session& s, uint32_t ms, const uint8_t* data, size_t len) {
+  if (!stamp_lines) {
+    fwrite(data, 1, len, stdout);
+    return;
+  }
+  for (size_t i = 0; i < len; i++) {
+    if (s.line_start) printf("[%6u.%03u] ", (unsigned)(ms / 1000), (unsigned)(ms % 1000));
+    putchar(data[i]);
+    s.line_start = data[i] == '\n';
+  }
+}
+
+static void handle(const uint8_t* data, size_t len, const std::string& from) {
+  DebugDgramHeader h;
+  if (!debug_dgram_parse_header(data, len, &h)) {
+    totals.invalid++;
+    fprintf(stderr, "[netrecv] %s: not a debug datagram (%u bytes)\n", from.c_str(), (unsigned)len);
+    return;
+  }
+  std::map<uint32_t, Session>::iterator it = sessions.find(h.boot);
+  if (it == sessions.end()) {
+    fprintf(stderr, "[netrecv] %s: boot %08x, starting at seq %u\n", from.c_str(), (unsigned)h.boot,
+            (unsigned)h.seq);
+    Session s = {h.seq, 0, true};
+    it = sessions.insert(std::make_pair(h.boot, s)).first;
+  }
+  Session& s = it->second;
+  if (h.seq != s.next_seq) {
+    int32_t gap = (int32_t)(h.seq - s.next_seq);
+    if (gap > 0) {
+      totals.lost += (uint32_t)gap;
+      fprintf(stderr, "[netrecv] %s: lost %d datagram(s), seq %u..%u\n", from.c_str(), (int)gap,
+              (unsigned)s.next_seq, (unsigned)(h.seq - 1));
+    } else {
+      totals.late++;
+      fprintf(stderr, "[netrecv] %s: late or duplicate datagram seq %u\n", from.c_str(), (unsigned)h.seq);
+    }
+  }
+  if ((int32_t)(h.seq + 1 - s.next_seq) > 0) s.next_seq = h.seq + 1;
+  if (h.dropped != s.dropped) {
+    uint32_t n = h.dropped - s.dropped;
+    totals.dropped += n;
+    fprintf(stderr, "[netrecv] %s: device dropped %u record(s)\n", from.c_str(), (unsigned)n);
+    s.dropped = h.dropped;
+  }
+  totals.datagrams++;
+  if (!debug_dgram_for_each(data, len, [&s](uint32_t ms, const uint8_t* rec, size_t n) {
+        write_record(s, ms, rec, n);
+        totals.records++;
+      })) {
+    totals.invalid++;
+    fprintf(stderr, "[netrecv] %s: truncated datagram seq %u\n", from.c_str(), (unsigned)h.seq);
+  }
+  fflush(stdout);
+}
+
+static std::string peer_name(const sockaddr_in& addr) {
+  char ip[INET_ADDRSTRLEN];
+  inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip));
+  return std::string(ip) + ":" + std::to_string(ntohs(addr.sin_port));
+}
+
+static void receive_udp(int fd) {
+  uint8_t buf[65536];
+  while (!stop) {
+    sockaddr_in from;
+    socklen_t from_len = sizeof(from);
+    ssize_t n = recvfrom(fd, buf, sizeof(buf), 0, (sockaddr*)&from, &from_len);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      perror("recvfrom");
+      return;
+    }
+    handle(buf, (size_t)n, peer_name(from));
+  }
+}
+
+static bool read_full(int fd, uint8_t* out, size_t len) {
+  while (len) {
+    ssize_t n = recv(fd, out, len, 0);
+    if (n <= 0) return false;
+    out += n;
+    len -= (size_t)n;
+  }
+  return true;
+}
+
+static void receive_tcp(int fd) {
+  uint8_t buf[65536];
+  listen(fd, 1);
+  while (!stop) {
+    sockaddr_in from;
+    socklen_t from_len = sizeof(from);
+    int conn = accept(fd, (sockaddr*)&from, &from_len);
+    if (conn < 0) {
+      if (errno == EINTR) continue;
+      perror("accept");
+      return;
+    }
+    std::string name = peer_name(from);
+    fprintf(stderr, "[netrecv] %s: connected\n", name.c_str());
+    uint16_t len;
+    while (!stop && read_full(conn, (uint8_t*)&len, 2) && read_full(conn, buf, len)) {
+      handle(buf, len, name);
+    }
+    fprintf(stderr, "[netrecv] %s: disconnected\n", name.c_str());
+    close(conn);
+  }
+}
+
+int main(int argc, char** argv) {
+  bool tcp = false;
+  int port = 0;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-t")) {
+      tcp = true;
+    } else if (!strcmp(argv[i], "-m")) {
+      stamp_lines = true;
+    } else {
+      port = atoi(argv[i]);
+    }
+  }
+  if (port <= 0 || port > 65535) {
+    fprintf(stderr, "usage: %s [-t] [-m] port\n", argv[0]);
+    return 2;
+  }
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = on_signal;  // No SA_RESTART: blocking calls return EINTR
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+
+  int fd = socket(AF_INET, tcp ? SOCK_STREAM : SOCK_DGRAM, 0);
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  if (!tcp) {
+    int rcvbuf = 1 << 20;  // Ride out bursts while stdout is slow
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+  }
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons((uint16_t)port);
+  if (fd < 0 || bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+    fprintf(stderr, "%s: cannot listen on port %d: %s\n", argv[0], port, strerror(errno));
+    return 1;
+  }
+  fprintf(stderr, "[netrecv] listening on %s port %d\n", tcp ? "TCP" : "UDP", port);
+
+  if (tcp) {
+    receive_tcp(fd);
+  } else {
+    receive_udp(fd);
+  }
+  close(fd);
+
+  fprintf(stderr, "[netrecv] %llu datagrams, %llu records, %llu lost, %llu late, %llu records dropped on device",
+          (unsigned long long)totals.datagrams, (unsigned long long)totals.records,
+          (unsigned long long)totals.lost, (unsigned long long)totals.late,
+          (unsigned long long)totals.dropped);
+  if (totals.invalid) fprintf(stderr, ", %llu invalid", (unsigned long long)totals.invalid);
+  fprintf(stderr, "\n");
+  return 0;
+}
@@ -0,0 +1,48 @@
+/**
+ * @file debug_tokens.cpp
+ * @brief Host tool: extract the token -> format string database from a
+ *        firmware ELF built with DEBUG_TOKENIZE=1
+ *
+ * Build (Linux/macOS):
+ *   g++ -std=c++11 -O2 -Iinclude -o debug_tokens tools/debug_tokens.cpp
+ *
+ * Usage:
+ *   debug_tokens firmware.elf > tokens.csv
+ *
+ * Output is one "token,string" line per literal (token in hex, string
+ * C-escaped). Keep the CSV of every released build so field logs can be
+ * detokenized without the ELF: debug_decode tokens.csv capture.bin
+ *
+ * Fails (exit 1) when two different literals hash to the same token, as
+ * their records could not be told apart; reword one of them.
+ */
+
+#include <stdio.h>
+#include "debug_decode.h"
+
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s firmware.elf > tokens.csv\n", argv[0]);
+    return 2;
+  }
+
+  DebugElfImage image;
+  if (!image.load(argv[1])) {
+    fprintf(stderr, "%s: cannot read ELF '%s'\n", argv[0], argv[1]);
+    return 1;
+  }
+
+  DebugTokenDatabase db;
+  db.load(image);
+  std::map<uint32_t, std::string>::const_iterator it;
+  for (it = db.entries().begin(); it != db.entries().end(); ++it) {
+    printf("%08x,%s\n", (unsigned)it->first, debug_token_escape(it->second).c_str());
+  }
+  fprintf(stderr, "%u tokens\n", (unsigned)db.entries().size());
+  for (size_t i = 0; i < db.collisions().size(); i++) {
+    const DebugTokenDatabase::Collision& c = db.collisions()[i];
+    fprintf(stderr, "%s: token %08x collision: \"%s\" and \"%s\"\n", argv[0], (unsigned)c.token,
+            debug_token_escape(c.kept).c_str(), debug_token_escape(c.other).c_str());
+  }
+  return db.collisions().empty() ? 0 : 1;
+}
@@ -0,0 +1,178 @@
+/**
+ * @file debug_trace.cpp
+ * @brief Host tool: convert a debug_trace_dump() capture into Chrome Trace
+ *        Event JSON (open in https://ui.perfetto.dev or chrome://tracing)
+ *
+ * Build (Linux/macOS):
+ *   g++ -std=c++11 -O2 -Iinclude -o debug_trace tools/debug_trace.cpp
+ *
+ * Usage:
+ *   debug_trace [capture.bin] > trace.json      # reads stdin without capture
+ *
+ * Begin/end events are paired per task and emitted as complete ("X")
+ * events, grouped into one process per CPU core and one thread per task.
+ * Spans whose begin was overwritten in the device buffer are skipped.
+ *
+ * Each core's cycle counter is unwrapped on its own, walking back from
+ * that core's clock anchor, and placed on the shared microsecond timeline
+ * so spans from both cores line up. Captures without anchors fall back to
+ * per-core timelines that each end at the core's last event.
+ */
+
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "debug_decode.h"
+#include "debug_trace.h"
+
+struct OpenSpan {
+  uint8_t name;
+  uint8_t core;
+  int64_t start;
+};
+
+struct CoreClock {
+  uint32_t cycles;
+  uint64_t us;
+};
+
+static std::string json_escape(const std::string& s) {
+  std::string out;
+  for (size_t i = 0; i < s.size(); i++) {
+    unsigned char c = (unsigned char)s[i];
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += (char)c;
+    } else if (c < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      out += buf;
+    } else {
+      out += (char)c;
+    }
+  }
+  return out;
+}
+
+int main(int argc, char** argv) {
+  FILE* in = stdin;
+  if (argc > 2 || (argc == 2 && !(in = fopen(argv[1], "rb")))) {
+    fprintf(stderr, "usage: %s [capture.bin] > trace.json\n", argv[0]);
+    return 2;
+  }
+
+  uint32_t per_us = 240;
+  std::map<uint8_t, std::string> names;
+  std::map<uint8_t, std::string> tasks;
+  std::vector<DebugTraceEvent> events;
+  std::map<uint8_t, CoreClock> clocks;
+
+  DebugFrameParser parser;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+    parser.feed(
+        buf, n, [](char) {},
+        [&](uint8_t kind, const uint8_t* payload, size_t len) {
+          switch (kind) {
+            case DEBUG_FRAME_TRACE_INFO:
+              if (len >= 4) memcpy(&per_us, payload, 4);
+              if (!per_us) per_us = 1;
+              events.clear();  // A new dump starts a new timeline
+              clocks.clear();
+              break;
+            case DEBUG_FRAME_TRACE_CLOCK:
+              if (len >= 13) {
+                CoreClock c;
+                memcpy(&c.cycles, payload + 1, 4);
+                memcpy(&c.us, payload + 5, 8);
+                clocks[payload[0]] = c;
+              }
+              break;
+            case DEBUG_FRAME_TRACE_NAME:
+              if (len) names[payload[0]] = std::string((const char*)payload + 1, len - 1);
+              break;
+            case DEBUG_FRAME_TRACE_TASK:
+              if (len) tasks[payload[0]] = std::string((const char*)payload + 1, len - 1);
+              break;
+            case DEBUG_FRAME_TRACE_EVENTS:
+              for (size_t i = 0; i + sizeof(DebugTraceEvent) <= len; i += sizeof(DebugTraceEvent)) {
+                DebugTraceEvent e;
+                memcpy(&e, payload + i, sizeof(e));
+                events.push_back(e);
+              }
+              break;
+          }
+        });
+  }
+  if (in != stdin) fclose(in);
+
+  // Time of each event in cycles on the shared timeline. Walk each core's
+  // events newest first from its anchor, unwrapping the 32-bit counter
+  // step by step (signed, as stamps are taken just before the slot is
+  // claimed and may be slightly out of order).
+  std::vector<int64_t> when(events.size());
+  std::map<uint8_t, int64_t> now;   // Per core: time of the last event visited
+  std::map<uint8_t, uint32_t> last; // Per core: its cycle stamp
+  for (size_t i = events.size(); i-- > 0;) {
+    const DebugTraceEvent& e = events[i];
+    if (!last.count(e.core)) {
+      std::map<uint8_t, CoreClock>::const_iterator c = clocks.find(e.core);
+      last[e.core] = c != clocks.end() ? c->second.cycles : e.cycles;
+      now[e.core] = c != clocks.end() ? (int64_t)(c->second.us * per_us) : 0;
+    }
+    now[e.core] -= (int64_t)(int32_t)(last[e.core] - e.cycles);
+    last[e.core] = e.cycles;
+    when[i] = now[e.core];
+  }
+  int64_t origin = 0;
+  for (size_t i = 0; i < when.size(); i++) {
+    if (i == 0 || when[i] < origin) origin = when[i];
+  }
+
+  printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  bool first = true;
+  std::map<uint8_t, bool> cores;
+  std::map<uint8_t, std::vector<OpenSpan> > open;  // Per-task span stack
+  size_t spans = 0;
+
+  for (size_t i = 0; i < events.size(); i++) {
+    const DebugTraceEvent& e = events[i];
+    int64_t t = when[i] - origin;
+    cores[e.core] = true;
+
+    std::vector<OpenSpan>& stack = open[e.task];
+    if (e.type == DEBUG_TRACE_BEGIN) {
+      OpenSpan s = {e.name, e.core, t};
+      stack.push_back(s);
+      continue;
+    }
+    if (stack.empty() || stack.back().name != e.name) continue;  // Begin was overwritten
+    OpenSpan s = stack.back();
+    stack.pop_back();
+
+    std::map<uint8_t, std::string>::const_iterator nm = names.find(s.name);
+    printf("%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%u,\"tid\":%u}",
+           first ? "" : ",\n",
+           json_escape(nm != names.end() ? nm->second : "scope " + std::to_string(s.name)).c_str(),
+           (double)s.start / per_us, (double)(t - s.start) / per_us, (unsigned)s.core,
+           (unsigned)e.task);
+    first = false;
+    spans++;
+  }
+
+  // Metadata: name each core's process and each task's thread
+  for (std::map<uint8_t, bool>::const_iterator c = cores.begin(); c != cores.end(); ++c) {
+    printf("%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,\"args\":{\"name\":\"Core %u\"}}",
+           first ? "" : ",\n", (unsigned)c->first, (unsigned)c->first);
+    first = false;
+    for (std::map<uint8_t, std::string>::const_iterator t = tasks.begin(); t != tasks.end(); ++t) {
+      printf(",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+             (unsigned)c->first, (unsigned)t->first, json_escape(t->second).c_str());
+    }
+  }
+  printf("\n]}\n");
+  fprintf(stderr, "%u events, %u spans\n", (unsigned)events.size(), (unsigned)spans);
+  return 0;
+}